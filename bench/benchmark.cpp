@@ -0,0 +1,262 @@
+// Times each stage of getting a log on screen against a generated log, for example
+//   tarpaulin-viewer-bench --events 10000000 --pids 64
+// Every stage prints how long it took, events (or queries) per second and the peak RSS of
+// the process so far.
+#include "trace_generator.h"
+#include "event_store.h"
+#include "graphics_view.h"
+#include "location_stats.h"
+#include "mapped_reader.h"
+#include "phase_log.h"
+#include "process_tree.h"
+#include "timeline_export.h"
+#include "trace_diff.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGraphicsScene>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+static constexpr size_t BATCH = 50000;
+static constexpr size_t HIT_TESTS = 1000000;
+static constexpr size_t FAILURE_JUMPS = 100000;
+
+static double peak_rss_mb() {
+#ifdef Q_OS_UNIX
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef Q_OS_MACOS
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#else
+    return 0.0;
+#endif
+}
+
+class Report {
+public:
+    Report(): out(stdout) {
+        out << QString("%1 %2 %3 %4\n").arg("stage", -14).arg("seconds", 10).arg("per sec", 14).arg("peak MB", 10);
+        out.flush();
+    }
+
+    void start() {
+        timer.start();
+    }
+
+    void stop(const QString& stage, size_t items) {
+        add(stage, timer.nsecsElapsed(), items);
+    }
+
+    // For stages timed by something else
+    void add(const QString& stage, qint64 nsecs, size_t items) {
+        auto seconds = nsecs / 1e9;
+        auto rate = seconds > 0.0 ? items / seconds : 0.0;
+        out << QString("%1 %2 %3 %4\n")
+            .arg(stage, -14)
+            .arg(seconds, 10, 'f', 3)
+            .arg(rate, 14, 'f', 0)
+            .arg(peak_rss_mb(), 10, 'f', 1);
+        out.flush();
+    }
+private:
+    QTextStream out;
+    QElapsedTimer timer;
+};
+
+int main(int argc, char* argv[]) {
+    // The scene stages still need a QApplication but there's no need for a display
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks loading and laying out a generated tarpaulin log");
+    parser.addHelpOption();
+    parser.addOption({"events", "Number of events to generate.", "n", "1000000"});
+    parser.addOption({"pids", "Most processes alive at once in a test binary.", "n", "16"});
+    parser.addOption({"fork-depth", "How deep process trees can get.", "n", "3"});
+    parser.addOption({"marker-rate", "Chance of an event being a marker.", "p", "0.001"});
+    parser.addOption({"failure-rate", "Chance of a process exit failing.", "p", "0.01"});
+    parser.addOption({"seed", "Seed for the generator.", "n", "1"});
+    parser.addOption({"log", "Write the generated log here and keep it.", "path"});
+    parser.addOption({"input", "Benchmark an existing log instead of generating one.", "path"});
+    parser.process(app);
+
+    GeneratorOptions options;
+    options.events = parser.value("events").toULongLong();
+    options.pids = parser.value("pids").toUInt();
+    options.fork_depth = parser.value("fork-depth").toUInt();
+    options.marker_rate = parser.value("marker-rate").toDouble();
+    options.failure_rate = parser.value("failure-rate").toDouble();
+    options.seed = parser.value("seed").toULongLong();
+
+    Report report;
+    QTemporaryFile temporary;
+    QString path = parser.value("input");
+    if(path.isEmpty()) {
+        QFile kept(parser.value("log"));
+        QFile* out = &temporary;
+        if(parser.isSet("log")) {
+            out = &kept;
+            if(!kept.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                std::fprintf(stderr, "Couldn't open %s\n", qPrintable(kept.fileName()));
+                return 1;
+            }
+        } else if(!temporary.open()) {
+            std::fprintf(stderr, "Couldn't create a temporary file\n");
+            return 1;
+        }
+        report.start();
+        if(!generate_trace(options, out)) {
+            std::fprintf(stderr, "Couldn't write %s\n", qPrintable(out->fileName()));
+            return 1;
+        }
+        out->close();
+        report.stop("generate", options.events);
+        path = out->fileName();
+    }
+
+    // Parsing the way trace_loader does minus the cache, which would skip the parse on reruns
+    QFile input(path);
+    if(!input.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "Couldn't open %s\n", qPrintable(path));
+        return 1;
+    }
+    std::vector<EventStore> batches;
+    size_t rows = 0;
+    report.start();
+    {
+        EventStore batch;
+        MappedEventReader reader(&input);
+        auto ok = reader.read([&](EventStore& events) {
+            rows += events.size();
+            if(batch.empty()) {
+                batch = std::move(events);
+            } else {
+                batch.append(events);
+            }
+            if(batch.size() >= BATCH) {
+                batches.push_back(std::move(batch));
+                batch.clear();
+            }
+        });
+        if(!batch.empty()) {
+            batches.push_back(std::move(batch));
+        }
+        if(!ok) {
+            std::fprintf(stderr, "Couldn't parse %s: %s\n", qPrintable(path), qPrintable(reader.error()));
+            return 1;
+        }
+    }
+    report.stop("parse", rows);
+
+    // As location_worker counts them, a batch at a time
+    LocationStats locations;
+    report.start();
+    for(const auto& batch: batches) {
+        locations.add(batch, locations.nodes());
+    }
+    report.stop("locations", rows);
+
+    // As process_worker builds it
+    ProcessTree processes;
+    report.start();
+    for(const auto& batch: batches) {
+        processes.add(batch, processes.nodes());
+    }
+    report.stop("processes", rows);
+
+    // Against a second run missing every thousandth event, the copy isn't timed
+    std::vector<EventStore> edited;
+    for(const auto& batch: batches) {
+        EventStore copy;
+        const auto& string_map = copy.adopt_strings(batch);
+        for(size_t row=0; row<batch.size(); row++) {
+            if(row % 1000 != 999) {
+                copy.append(batch, row, string_map);
+            }
+        }
+        edited.push_back(std::move(copy));
+    }
+    RunSignatures before, after;
+    report.start();
+    for(const auto& batch: batches) {
+        before.add(batch);
+    }
+    for(const auto& batch: edited) {
+        after.add(batch);
+    }
+    auto diff = diff_runs(before, after);
+    report.stop("diff", rows * 2);
+    edited.clear();
+
+    // End to end through the view, as a load does it. Linking, measuring labels and layout
+    // are the views own phases so they're split out of the total as it timed them.
+    PhaseLog phases;
+    QGraphicsScene scene;
+    graphics_view view;
+    view.setScene(&scene);
+    view.resize(1280, 800);
+    view.set_phase_log(&phases);
+    report.start();
+    view.begin_scene();
+    for(const auto& batch: batches) {
+        view.append_events(batch);
+    }
+    view.finish_scene();
+    report.stop("scene", rows);
+    for(auto phase: {"link", "labels", "layout", "finish"}) {
+        report.add(QString("  %1").arg(phase), phases.total(phase), rows);
+    }
+    batches = std::vector<EventStore>();
+
+    // Points spread evenly over the whole timeline
+    const auto& layout = view.timeline_layout();
+    auto bounds = layout.bounds();
+    size_t hits = 0;
+    report.start();
+    for(size_t i=0; i<HIT_TESTS; i++) {
+        auto fx = std::fmod(i * 0.6180339887498949, 1.0);
+        auto fy = std::fmod(i * 0.7548776662466927, 1.0);
+        QPointF pos(bounds.left() + fx * bounds.width(), bounds.top() + fy * bounds.height());
+        hits += layout.node_at(pos).has_value();
+    }
+    report.stop("hit test", HIT_TESTS);
+
+    auto jumps = std::min(FAILURE_JUMPS, view.failure_index().size());
+    report.start();
+    for(size_t i=0; i<jumps; i++) {
+        view.next_failure();
+    }
+    report.stop("next failure", jumps);
+
+    // Reads the log twice itself so it's timed from the file
+    QTemporaryFile svg;
+    if(svg.open()) {
+        svg.close();
+        QString error;
+        report.start();
+        if(!export_svg(path, svg.fileName(), error)) {
+            std::fprintf(stderr, "SVG export failed: %s\n", qPrintable(error));
+            return 1;
+        }
+        report.stop("svg export", rows);
+    }
+
+    QTextStream(stdout) << QString("%1 events, %2 nodes, %3 lanes, %4 failures, %5 hit\n")
+        .arg(rows).arg(layout.size()).arg(layout.lane_count()).arg(view.failure_index().size()).arg(hits);
+    return 0;
+}
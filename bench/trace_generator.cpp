@@ -0,0 +1,165 @@
+#include "trace_generator.h"
+#include <QByteArray>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// splitmix64, the standard library distributions aren't the same everywhere so the
+// generator does its own to keep logs identical across platforms
+class Random {
+public:
+    explicit Random(uint64_t seed): state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t below(uint64_t n) {
+        return n ? next() % n : 0;
+    }
+
+    bool chance(double p) {
+        return static_cast<double>(next() >> 11) * 0x1.0p-53 < p;
+    }
+private:
+    uint64_t state;
+};
+
+struct Process {
+    uint64_t pid;
+    uint32_t depth;
+};
+
+constexpr uint64_t EVENTS_PER_BINARY = 200000;
+constexpr int SOURCE_FILES = 64;
+constexpr int FILE_LINES = 400;
+
+class Writer {
+public:
+    Writer(const GeneratorOptions& options, QIODevice* out): options(options), out(out), random(options.seed) {}
+
+    bool run() {
+        buffer.reserve(FLUSH_SIZE + 4096);
+        buffer += "{\"events\":[";
+        event("{\"ConfigLaunch\":\"bench\"");
+        uint64_t binary = 0;
+        while(written < options.events && ok) {
+            run_binary(binary++);
+        }
+        buffer += "],\"manifest_paths\":[\"/bench/Cargo.toml\"]}\n";
+        flush();
+        return ok;
+    }
+private:
+    static constexpr int FLUSH_SIZE = 1 << 20;
+
+    void event(const char* body) {
+        if(written > 0) {
+            buffer += ",\n";
+        }
+        buffer += body;
+        buffer += ",\"created\":";
+        buffer += QByteArray::number(static_cast<qulonglong>(written));
+        buffer += ".5}";
+        written++;
+        if(buffer.size() >= FLUSH_SIZE) {
+            flush();
+        }
+    }
+
+    void maybe_marker() {
+        if(random.chance(options.marker_rate)) {
+            event("{\"Marker\":null");
+        }
+    }
+
+    void trace(uint64_t pid, const QByteArray& fields) {
+        maybe_marker();
+        QByteArray body = "{\"Trace\":{\"pid\":" + QByteArray::number(static_cast<qulonglong>(pid)) + fields + "}";
+        event(body.constData());
+    }
+
+    void run_binary(uint64_t index) {
+        auto name = QByteArray::number(static_cast<qulonglong>(index));
+        QByteArray launch = "{\"BinaryLaunch\":{\"ty\":\"Tests\",\"path\":\"/bench/target/debug/deps/bench_" + name
+            + "\",\"should_panic\":false,\"cargo_dir\":\"/bench\",\"pkg_name\":\"bench\"}";
+        event(launch.constData());
+        auto budget = std::min(options.events, written + EVENTS_PER_BINARY);
+        std::vector<Process> live;
+        live.push_back({next_pid++, 0});
+        while(written < budget && ok) {
+            auto roll = random.below(100);
+            if(roll < 4 && live.size() < options.pids) {
+                auto& parent = live[random.below(live.size())];
+                if(parent.depth < options.fork_depth) {
+                    Process child{next_pid++, parent.depth + 1};
+                    trace(parent.pid, ",\"child\":" + QByteArray::number(static_cast<qulonglong>(child.pid))
+                        + ",\"signal\":\"SIGTRAP\",\"description\":\"Forked\"");
+                    live.push_back(child);
+                    continue;
+                }
+            }
+            if(roll < 6 && live.size() > 1) {
+                auto i = 1 + random.below(live.size() - 1);
+                finish(live[i].pid);
+                live.erase(live.begin() + static_cast<std::ptrdiff_t>(i));
+                continue;
+            }
+            auto& process = live[random.below(live.size())];
+            auto file = random.below(SOURCE_FILES);
+            auto line = 1 + random.below(FILE_LINES);
+            auto addr = 0x400000 + file * 0x10000 + line * 16;
+            trace(process.pid, ",\"signal\":\"SIGTRAP\",\"addr\":" + QByteArray::number(static_cast<qulonglong>(addr))
+                + ",\"location\":{\"file\":\"/bench/src/module_" + QByteArray::number(static_cast<qulonglong>(file))
+                + ".rs\",\"line\":" + QByteArray::number(static_cast<qulonglong>(line))
+                + "},\"description\":\"Hit address " + QByteArray::number(static_cast<qulonglong>(addr), 16) + "\"");
+        }
+        // Children go first so the root exits last like a real test binary
+        for(auto i=live.size(); i-- > 0;) {
+            finish(live[i].pid);
+        }
+    }
+
+    void finish(uint64_t pid) {
+        if(random.chance(options.failure_rate)) {
+            switch(random.below(3)) {
+            case 0:
+                trace(pid, ",\"return_val\":101,\"description\":\"Exited\"");
+                break;
+            case 1:
+                trace(pid, ",\"signal\":\"SIGSEGV\",\"description\":\"Signalled\"");
+                break;
+            default:
+                trace(pid, ",\"signal\":\"SIGILL\",\"description\":\"Signalled\"");
+                break;
+            }
+        } else {
+            trace(pid, ",\"return_val\":0,\"description\":\"Exited\"");
+        }
+    }
+
+    void flush() {
+        if(ok && out->write(buffer) != buffer.size()) {
+            ok = false;
+        }
+        buffer.clear();
+    }
+
+    const GeneratorOptions& options;
+    QIODevice* out;
+    Random random;
+    QByteArray buffer;
+    uint64_t written = 0;
+    uint64_t next_pid = 1000;
+    bool ok = true;
+};
+
+}
+
+bool generate_trace(const GeneratorOptions& options, QIODevice* out) {
+    return Writer(options, out).run();
+}
@@ -0,0 +1,24 @@
+#ifndef TRACE_GENERATOR_H
+#define TRACE_GENERATOR_H
+
+#include <QIODevice>
+#include <cstdint>
+
+struct GeneratorOptions {
+    uint64_t events = 1000000;
+    // Most processes alive at once in a test binary
+    uint32_t pids = 16;
+    // How many forks deep a process tree can get, 0 means no forks at all
+    uint32_t fork_depth = 3;
+    // Chance of any event being a marker
+    double marker_rate = 0.001;
+    // Chance of a process exit failing, split between error returns and SIGSEGV/SIGILL
+    double failure_rate = 0.01;
+    uint64_t seed = 1;
+};
+
+// Writes a made up tarpaulin event log with roughly options.events events. The same options
+// always give the same bytes, the log is written as it's generated so it can be any size.
+bool generate_trace(const GeneratorOptions& options, QIODevice* out);
+
+#endif // TRACE_GENERATOR_H
@@ -0,0 +1,305 @@
+#include "decompress.h"
+#include <algorithm>
+#include <cstring>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// Sizes of what's read from the source and of the blocks handed to the reader
+static constexpr qint64 INPUT_BLOCK = 1 << 20;
+static constexpr qsizetype OUTPUT_BLOCK = 4 << 20;
+// Blocks decompressed ahead of the reader before the producer waits
+static constexpr size_t AHEAD = 4;
+
+Compression detect_compression(const char* data, qint64 size) {
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    if(size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) {
+        return Compression::gzip;
+    }
+    if(size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd) {
+        return Compression::zstd;
+    }
+    return Compression::none;
+}
+
+bool can_decompress(Compression compression) {
+    switch(compression) {
+    case Compression::none:
+        return true;
+    case Compression::gzip:
+#ifdef HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Compression::zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+QString compression_name(Compression compression) {
+    switch(compression) {
+    case Compression::none:
+        return "uncompressed";
+    case Compression::gzip:
+        return "gzip";
+    case Compression::zstd:
+        return "zstd";
+    }
+    return QString();
+}
+
+decompressing_device::decompressing_device(QIODevice* source, Compression compression):
+    source(source),
+    compression(compression)
+{
+}
+
+decompressing_device::~decompressing_device() {
+    close();
+}
+
+bool decompressing_device::open(OpenMode mode) {
+    if((mode & ReadWrite) != ReadOnly) {
+        setErrorString("Compressed logs can only be read");
+        return false;
+    }
+    if(!can_decompress(compression)) {
+        setErrorString(QString("This build can't read %1 compressed logs").arg(compression_name(compression)));
+        return false;
+    }
+    if(!QIODevice::open(mode)) {
+        return false;
+    }
+    produced_all = false;
+    stopping = false;
+    producer = std::thread(&decompressing_device::produce, this);
+    return true;
+}
+
+void decompressing_device::close() {
+    if(producer.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        room.notify_all();
+        producer.join();
+    }
+    blocks.clear();
+    current.clear();
+    current_pos = 0;
+    if(isOpen()) {
+        QIODevice::close();
+    }
+}
+
+bool decompressing_device::isSequential() const {
+    return true;
+}
+
+qint64 decompressing_device::bytesAvailable() const {
+    std::lock_guard<std::mutex> guard(lock);
+    qint64 available = current.size() - current_pos;
+    for(const auto& block: blocks) {
+        available += block.size();
+    }
+    return available + QIODevice::bytesAvailable();
+}
+
+qint64 decompressing_device::compressed_pos() const {
+    return source_pos.load(std::memory_order_relaxed);
+}
+
+QString decompressing_device::error() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return error_message;
+}
+
+void decompressing_device::set_phase_log(PhaseLog* log) {
+    phases = log;
+}
+
+qint64 decompressing_device::readData(char* data, qint64 max_size) {
+    qint64 copied = 0;
+    while(copied < max_size) {
+        if(current_pos == current.size()) {
+            // Only wait for more when nothing's been read yet, a short read is fine
+            std::unique_lock<std::mutex> guard(lock);
+            if(copied > 0 && blocks.empty()) {
+                break;
+            }
+            ready.wait(guard, [this]() { return !blocks.empty() || produced_all; });
+            if(blocks.empty()) {
+                break;
+            }
+            current = std::move(blocks.front());
+            blocks.pop_front();
+            current_pos = 0;
+            guard.unlock();
+            room.notify_all();
+        }
+        auto n = std::min<qint64>(max_size - copied, current.size() - current_pos);
+        std::memcpy(data + copied, current.constData() + current_pos, static_cast<size_t>(n));
+        current_pos += n;
+        copied += n;
+    }
+    return copied;
+}
+
+qint64 decompressing_device::writeData(const char*, qint64) {
+    return -1;
+}
+
+bool decompressing_device::push(QByteArray block) {
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        room.wait(guard, [this]() { return blocks.size() < AHEAD || stopping; });
+        if(stopping) {
+            return false;
+        }
+        blocks.push_back(std::move(block));
+    }
+    ready.notify_all();
+    return true;
+}
+
+void decompressing_device::fail(const QString& message) {
+    std::lock_guard<std::mutex> guard(lock);
+    error_message = message;
+}
+
+void decompressing_device::produce() {
+    {
+        PhaseTimer timer(phases, "decompress");
+        if(compression == Compression::gzip) {
+            inflate_gzip();
+        } else if(compression == Compression::zstd) {
+            inflate_zstd();
+        }
+        timer.add(source_pos.load(std::memory_order_relaxed));
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        produced_all = true;
+    }
+    ready.notify_all();
+}
+
+void decompressing_device::inflate_gzip() {
+#ifdef HAVE_ZLIB
+    z_stream stream{};
+    // 32 on top of the window bits detects gzip or zlib headers
+    if(inflateInit2(&stream, 15 + 32) != Z_OK) {
+        fail("Couldn't start gzip decompression");
+        return;
+    }
+    QByteArray input(INPUT_BLOCK, Qt::Uninitialized);
+    QByteArray output(OUTPUT_BLOCK, Qt::Uninitialized);
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    bool ok = true;
+    bool in_member = true;
+    // zlib can have more output waiting after filling a block, even with no input left
+    bool full = false;
+    while(ok) {
+        if(stream.avail_in == 0 && !full) {
+            auto n = source->read(input.data(), input.size());
+            if(n <= 0) {
+                if(in_member) {
+                    fail("Compressed log ends part way through");
+                }
+                break;
+            }
+            source_pos += n;
+            stream.next_in = reinterpret_cast<Bytef*>(input.data());
+            stream.avail_in = static_cast<uInt>(n);
+        }
+        if(stream.avail_in > 0) {
+            in_member = true;
+        }
+        auto result = inflate(&stream, Z_NO_FLUSH);
+        if(result == Z_STREAM_END) {
+            // gzip files can be several members one after another, like from cat a.gz b.gz
+            in_member = false;
+            inflateReset(&stream);
+        } else if(result != Z_OK && result != Z_BUF_ERROR) {
+            fail(QString("Corrupt gzip data: %1").arg(stream.msg ? stream.msg : "unknown error"));
+            ok = false;
+        }
+        full = stream.avail_out == 0;
+        if(full || !ok) {
+            output.resize(output.size() - static_cast<qsizetype>(stream.avail_out));
+            if(!output.isEmpty() && !push(std::move(output))) {
+                ok = false;
+            }
+            output = QByteArray(OUTPUT_BLOCK, Qt::Uninitialized);
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+        }
+    }
+    output.resize(output.size() - static_cast<qsizetype>(stream.avail_out));
+    if(!output.isEmpty()) {
+        push(std::move(output));
+    }
+    inflateEnd(&stream);
+#endif
+}
+
+void decompressing_device::inflate_zstd() {
+#ifdef HAVE_ZSTD
+    auto stream = ZSTD_createDStream();
+    if(!stream) {
+        fail("Couldn't start zstd decompression");
+        return;
+    }
+    QByteArray input(INPUT_BLOCK, Qt::Uninitialized);
+    QByteArray output(OUTPUT_BLOCK, Qt::Uninitialized);
+    ZSTD_inBuffer in{input.constData(), 0, 0};
+    ZSTD_outBuffer out{output.data(), static_cast<size_t>(output.size()), 0};
+    bool ok = true;
+    // Zero once a frame's finished and fully flushed, frames can follow each other
+    size_t hint = 1;
+    bool full = false;
+    while(ok) {
+        if(in.pos == in.size && !full) {
+            auto n = source->read(input.data(), input.size());
+            if(n <= 0) {
+                if(hint != 0) {
+                    fail("Compressed log ends part way through");
+                }
+                break;
+            }
+            source_pos += n;
+            in = ZSTD_inBuffer{input.constData(), static_cast<size_t>(n), 0};
+        }
+        hint = ZSTD_decompressStream(stream, &out, &in);
+        if(ZSTD_isError(hint)) {
+            fail(QString("Corrupt zstd data: %1").arg(ZSTD_getErrorName(hint)));
+            ok = false;
+        }
+        full = out.pos == out.size;
+        if(full || !ok) {
+            output.resize(static_cast<qsizetype>(out.pos));
+            if(!output.isEmpty() && !push(std::move(output))) {
+                ok = false;
+            }
+            output = QByteArray(OUTPUT_BLOCK, Qt::Uninitialized);
+            out = ZSTD_outBuffer{output.data(), static_cast<size_t>(output.size()), 0};
+        }
+    }
+    output.resize(static_cast<qsizetype>(out.pos));
+    if(!output.isEmpty()) {
+        push(std::move(output));
+    }
+    ZSTD_freeDStream(stream);
+#endif
+}
@@ -0,0 +1,85 @@
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "phase_log.h"
+
+enum class Compression {
+    none,
+    gzip,
+    zstd
+};
+
+// Goes by the magic bytes at the start of the file rather than the extension
+Compression detect_compression(const char* data, qint64 size);
+
+// Whether this build can read the format, gzip needs zlib and zstd needs libzstd
+bool can_decompress(Compression compression);
+
+QString compression_name(Compression compression);
+
+// Sequential device giving the decompressed contents of another. A thread of its own reads
+// and inflates the source a block at a time so decompression overlaps with whatever's
+// reading this, only a few blocks are ever held and the whole thing never is. The source
+// mustn't be touched by anything else while this is open.
+class decompressing_device: public QIODevice
+{
+public:
+    decompressing_device(QIODevice* source, Compression compression);
+
+    ~decompressing_device() override;
+
+    bool open(OpenMode mode) override;
+
+    void close() override;
+
+    bool isSequential() const override;
+
+    qint64 bytesAvailable() const override;
+
+    // Bytes of the source read so far, for progress against the source's size
+    qint64 compressed_pos() const;
+
+    // Set if the compressed data was damaged or cut short, the decompressed data up to that
+    // point can still be read
+    QString error() const;
+
+    // Decompression is timed into log, set before opening
+    void set_phase_log(PhaseLog* log);
+protected:
+    qint64 readData(char* data, qint64 max_size) override;
+
+    qint64 writeData(const char* data, qint64 max_size) override;
+private:
+    void produce();
+    void inflate_gzip();
+    void inflate_zstd();
+    // Hands a block to the reader, false if it's time to stop
+    bool push(QByteArray block);
+    void fail(const QString& message);
+
+    QIODevice* source;
+    Compression compression;
+    PhaseLog* phases = nullptr;
+    std::thread producer;
+    mutable std::mutex lock;
+    std::condition_variable ready;
+    std::condition_variable room;
+    std::deque<QByteArray> blocks;
+    // The block the reader is part way through and how far it's got
+    QByteArray current;
+    qsizetype current_pos = 0;
+    bool produced_all = false;
+    bool stopping = false;
+    QString error_message;
+    std::atomic<qint64> source_pos{0};
+};
+
+#endif // DECOMPRESS_H
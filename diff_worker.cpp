@@ -0,0 +1,57 @@
+#include "diff_worker.h"
+
+diff_worker::diff_worker(QObject* parent):
+    QObject(parent)
+{
+    qRegisterMetaType<DiffResult>("DiffResult");
+}
+
+void diff_worker::reset(int left, int right) {
+    left_generation = left;
+    right_generation = right;
+    left_run.clear();
+    right_run.clear();
+}
+
+void diff_worker::add_left(int generation, EventBatch events) {
+    if(generation == left_generation && generation >= 0) {
+        left_run.add(*events);
+    }
+}
+
+void diff_worker::add_right(int generation, EventBatch events) {
+    if(generation == right_generation && generation >= 0) {
+        right_run.add(*events);
+    }
+}
+
+void diff_worker::restart_left(int generation) {
+    if(generation == left_generation) {
+        left_run.clear();
+    }
+}
+
+void diff_worker::restart_right(int generation) {
+    if(generation == right_generation) {
+        right_run.clear();
+    }
+}
+
+void diff_worker::reroot_left(int generation, const QString& root) {
+    if(generation == left_generation) {
+        left_run.reroot_files(QDir(root));
+    }
+}
+
+void diff_worker::reroot_right(int generation, const QString& root) {
+    if(generation == right_generation) {
+        right_run.reroot_files(QDir(root));
+    }
+}
+
+void diff_worker::compare(int left, int right) {
+    if(left != left_generation || right != right_generation) {
+        return;
+    }
+    emit compared(left, right, std::make_shared<const TraceDiff>(diff_runs(left_run, right_run)));
+}
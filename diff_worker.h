@@ -0,0 +1,49 @@
+#ifndef DIFF_WORKER_H
+#define DIFF_WORKER_H
+
+#include <QObject>
+#include <QMetaType>
+#include <memory>
+#include "trace_diff.h"
+#include "trace_loader.h"
+
+using DiffResult = std::shared_ptr<const TraceDiff>;
+Q_DECLARE_METATYPE(DiffResult)
+
+// Lives on its own thread and keeps signatures for the two logs being compared as their
+// batches come in from both loaders, then diffs them when asked. Only the two generations
+// from the last reset are kept, everything else is ignored.
+class diff_worker: public QObject
+{
+    Q_OBJECT
+public:
+    explicit diff_worker(QObject* parent = nullptr);
+public slots:
+    // -1 for both stops comparing and frees the signatures
+    void reset(int left, int right);
+
+    void add_left(int generation, EventBatch events);
+
+    void add_right(int generation, EventBatch events);
+
+    // A side's loader started its generation over
+    void restart_left(int generation);
+
+    void restart_right(int generation);
+
+    // A side's loader found its root after the paths it had sent
+    void reroot_left(int generation, const QString& root);
+
+    void reroot_right(int generation, const QString& root);
+
+    void compare(int left, int right);
+signals:
+    void compared(int left, int right, DiffResult diff);
+private:
+    RunSignatures left_run;
+    RunSignatures right_run;
+    int left_generation = -1;
+    int right_generation = -1;
+};
+
+#endif // DIFF_WORKER_H
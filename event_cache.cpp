@@ -0,0 +1,319 @@
+#include "event_cache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+
+static const char MAGIC[8] = {'T', 'P', 'V', 'C', 'A', 'C', 'H', 'E'};
+static const char END_MAGIC[8] = {'T', 'P', 'V', 'E', 'N', 'D', '\0', '\0'};
+// Bump whenever the block layout or anything in EventStore it relies on changes
+static constexpr uint32_t VERSION = 3;
+static constexpr uint32_t BYTE_ORDER = 0x01020304;
+// How much of each end of the log goes in the content hash
+static constexpr qint64 SAMPLE = 1 << 16;
+static constexpr int DEFAULT_BUDGET_MB = 4096;
+
+template<typename T>
+static void put(QByteArray& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static T get(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// Keeps a snapshot mapped for as long as any batch read from it is around
+namespace {
+class Mapping {
+public:
+    explicit Mapping(const QString& path):
+        file(path)
+    {
+    }
+
+    ~Mapping() {
+        if(data) {
+            file.unmap(data);
+        }
+    }
+
+    bool map() {
+        if(file.open(QIODevice::ReadOnly)) {
+            data = file.map(0, file.size());
+        }
+        return data != nullptr;
+    }
+
+    QFile file;
+    uchar* data = nullptr;
+};
+}
+
+// The table is a count, the end offset of every string but the empty one that's always
+// id 0, then all the bytes
+static void write_strings(QByteArray& out, const StringPool& strings) {
+    put(out, static_cast<uint64_t>(strings.size()));
+    uint64_t offset = 0;
+    for(uint32_t i=1; i<strings.size(); i++) {
+        offset += strings.bytes(i).size();
+        put(out, offset);
+    }
+    for(uint32_t i=1; i<strings.size(); i++) {
+        auto bytes = strings.bytes(i);
+        out.append(bytes.data(), static_cast<int>(bytes.size()));
+    }
+}
+
+static bool read_strings(const char* p, const char* end, StringPool& strings) {
+    if(end - p < 8) {
+        return false;
+    }
+    auto count = get<uint64_t>(p);
+    p += 8;
+    if(count == 0 || count > UINT32_MAX || static_cast<uint64_t>(end - p) / 8 < count - 1) {
+        return false;
+    }
+    auto offsets = p;
+    auto bytes = p + (count - 1) * 8;
+    uint64_t start = 0;
+    for(uint64_t i=1; i<count; i++) {
+        auto stop = get<uint64_t>(offsets + (i - 1) * 8);
+        if(stop < start || stop > static_cast<uint64_t>(end - bytes)) {
+            return false;
+        }
+        // Every string is only in there once so they all get their id back
+        if(strings.intern(std::string_view(bytes + start, stop - start)) != i) {
+            return false;
+        }
+        start = stop;
+    }
+    return true;
+}
+
+EventCache::EventCache(const QString& log_path):
+    log(QFileInfo(log_path).absoluteFilePath()),
+    limit(budget())
+{
+    auto dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    auto name = QCryptographicHash::hash(log.toUtf8(), QCryptographicHash::Sha1).toHex();
+    snapshot = QDir(dir).filePath(QString("traces/%1.tpv").arg(QString::fromLatin1(name)));
+}
+
+QString EventCache::path() const {
+    return snapshot;
+}
+
+qint64 EventCache::budget() {
+    bool ok = false;
+    auto mb = qEnvironmentVariableIntValue("TARPAULIN_VIEWER_CACHE_MB", &ok);
+    if(!ok || mb < 0) {
+        mb = DEFAULT_BUDGET_MB;
+    }
+    return static_cast<qint64>(mb) << 20;
+}
+
+void EventCache::prune() const {
+    // Reading a snapshot touches it so newest first is most recently used first
+    QDir dir(QFileInfo(snapshot).absolutePath());
+    auto kept = QFileInfo(snapshot).absoluteFilePath();
+    qint64 total = 0;
+    for(const auto& file: dir.entryInfoList({"*.tpv"}, QDir::Files, QDir::Time)) {
+        total += file.size();
+        if(total > limit && file.absoluteFilePath() != kept && QFile::remove(file.absoluteFilePath())) {
+            total -= file.size();
+        }
+    }
+}
+
+QByteArray EventCache::header() const {
+    QFileInfo info(log);
+    QByteArray out;
+    out.append(MAGIC, sizeof(MAGIC));
+    put(out, VERSION);
+    put(out, BYTE_ORDER);
+    put(out, static_cast<qint64>(info.size()));
+    put(out, static_cast<qint64>(info.lastModified().toMSecsSinceEpoch()));
+    QFile file(log);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if(file.open(QIODevice::ReadOnly)) {
+        hash.addData(file.read(SAMPLE));
+        if(file.size() > SAMPLE && file.seek(std::max<qint64>(SAMPLE, file.size() - SAMPLE))) {
+            hash.addData(file.read(SAMPLE));
+        }
+    }
+    // Sha1 is 20 bytes, padded out to keep the blocks aligned
+    out.append(hash.result().leftJustified(24, '\0'));
+    return out;
+}
+
+EventCache::Result EventCache::read(const EventSink& sink, const CancelCheck& cancelled, const ProgressCallback& progress) {
+    if(limit <= 0) {
+        return Result::missing;
+    }
+    auto mapping = std::make_shared<Mapping>(snapshot);
+    if(!mapping->map()) {
+        return Result::missing;
+    }
+    auto expected = header();
+    auto size = mapping->file.size();
+    if(size < expected.size() + 24) {
+        return Result::missing;
+    }
+    auto begin = reinterpret_cast<const char*>(mapping->data);
+    auto end = begin + size;
+    if(std::memcmp(begin, expected.constData(), expected.size()) != 0 || std::memcmp(end - 8, END_MAGIC, 8) != 0) {
+        return Result::missing;
+    }
+    // Trailer is where the string table starts and the number of blocks
+    auto trailer = end - 24;
+    auto table = get<uint64_t>(trailer);
+    auto block_count = get<uint64_t>(trailer + 8);
+    auto first = begin + expected.size();
+    if(table < static_cast<uint64_t>(expected.size()) || table > static_cast<uint64_t>(trailer - begin)) {
+        qDebug()<<"Snapshot"<<snapshot<<"is damaged";
+        return Result::missing;
+    }
+    auto blocks_end = begin + table;
+
+    // Going over the block sizes is cheap next to decoding them, so a truncated snapshot or
+    // one with the wrong number of blocks falls back to parsing before anything's shown.
+    // So does a bad string table as every block needs it.
+    auto p = first;
+    bool whole = true;
+    for(uint64_t i=0; i<block_count && whole; i++) {
+        whole = EventStore::skip_block(p, blocks_end);
+    }
+    auto snapshot_strings = std::make_shared<StringPool>();
+    if(!whole || p != blocks_end || !read_strings(blocks_end, trailer, *snapshot_strings)) {
+        qDebug()<<"Snapshot"<<snapshot<<"is damaged";
+        return Result::missing;
+    }
+
+    // Each block goes out as soon as it's decoded so the view fills in as it would parsing
+    auto result = Result::read;
+    p = first;
+    uint64_t node_count = 0;
+    EventStore events;
+    for(uint64_t i=0; i<block_count; i++) {
+        if(cancelled && cancelled()) {
+            result = Result::cancelled;
+            break;
+        }
+        bool ok = events.read_block(p, blocks_end, snapshot_strings, mapping);
+        for(size_t row=0; row<events.size() && ok; row++) {
+            if(events.kind(row) != EventKind::marker) {
+                auto parent = events.parent(row);
+                ok = parent == EventStore::NO_PARENT || parent < node_count;
+                node_count++;
+            }
+        }
+        if(!ok) {
+            qDebug()<<"Snapshot"<<snapshot<<"is damaged";
+            result = i == 0 ? Result::missing : Result::damaged;
+            break;
+        }
+        sink(events);
+        if(progress) {
+            progress(p - begin, size);
+        }
+    }
+    if(result == Result::read) {
+        mapping->file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+    return result;
+}
+
+bool EventCache::begin_write() {
+    if(limit <= 0) {
+        return false;
+    }
+    QDir().mkpath(QFileInfo(snapshot).absolutePath());
+    output = std::make_unique<QSaveFile>(snapshot);
+    if(!output->open(QIODevice::WriteOnly)) {
+        output.reset();
+        return false;
+    }
+    blocks = 0;
+    strings = StringPool();
+    files.clear();
+    processes.clear();
+    nodes = 0;
+    output->write(header());
+    return true;
+}
+
+void EventCache::write(const EventStore& events) {
+    if(!output) {
+        return;
+    }
+    // Linked the same way graphics_view would so it doesn't have to when this is read back
+    std::vector<uint32_t> parents(events.size(), UINT32_MAX);
+    for(size_t row=0; row<events.size(); row++) {
+        if(events.kind(row) == EventKind::marker) {
+            continue;
+        }
+        auto parent = processes.add(events, row, nodes++);
+        if(parent != ProcessIndex::NO_PARENT) {
+            parents[row] = static_cast<uint32_t>(parent);
+        }
+    }
+    auto string_map = strings.merge(events.strings());
+    files.resize(strings.size(), false);
+    for(size_t row=0; row<events.size(); row++) {
+        if(events.has(row, EventStore::HAS_LOCATION)) {
+            files[string_map[events.file_id(row)]] = true;
+        }
+    }
+    QByteArray block;
+    events.write_block(block, string_map, parents);
+    output->write(block);
+    blocks++;
+    if(output->pos() > limit) {
+        output->cancelWriting();
+        output.reset();
+    }
+}
+
+void EventCache::reroot_files(const QDir& root) {
+    for(uint32_t id=0; id<files.size(); id++) {
+        if(files[id]) {
+            auto relative = root.relativeFilePath(strings.get(id)).toUtf8();
+            strings.replace(id, std::string_view(relative.constData(), static_cast<size_t>(relative.size())));
+        }
+    }
+}
+
+bool EventCache::commit() {
+    if(!output) {
+        return false;
+    }
+    QByteArray trailer;
+    auto table = static_cast<uint64_t>(output->pos());
+    write_strings(trailer, strings);
+    while(trailer.size() % 8 != 0) {
+        trailer.append('\0');
+    }
+    put(trailer, table);
+    put(trailer, blocks);
+    trailer.append(END_MAGIC, sizeof(END_MAGIC));
+    output->write(trailer);
+    if(output->pos() > limit) {
+        output->cancelWriting();
+        output.reset();
+        return false;
+    }
+    auto committed = output->commit();
+    output.reset();
+    if(committed) {
+        prune();
+    }
+    return committed;
+}
@@ -0,0 +1,79 @@
+#ifndef EVENT_CACHE_H
+#define EVENT_CACHE_H
+
+#include <QByteArray>
+#include <QSaveFile>
+#include <QString>
+#include <memory>
+#include <vector>
+#include "event_reader.h"
+#include "process_index.h"
+#include "string_pool.h"
+
+// Binary snapshots of parsed logs so opening one again skips the JSON entirely. They live
+// in the cache directory under a hash of the logs path, and record the logs size, mtime
+// and a hash of its first and last few KB so a snapshot is never used for a changed log.
+// A snapshot is a header, the event batches as written by EventStore::write_block, one string
+// table for all of them and a trailer holding where the table is and how many batches there
+// are. Batches also keep every events parent so reading them back needs no ProcessIndex, and
+// they're handed over as views into the mapped file rather than copies. Paths are made
+// relative to the project root before they're cached so the root itself isn't kept.
+//
+// Snapshots share a size budget, TARPAULIN_VIEWER_CACHE_MB or 4GB by default, and the least
+// recently used are deleted to stay under it whenever one's committed. A budget of 0 turns
+// the cache off.
+class EventCache {
+public:
+    enum class Result {
+        // Nothing usable and nothing handed over
+        missing,
+        read,
+        // Found to be damaged after some batches were handed over, they have to be dropped
+        damaged,
+        cancelled
+    };
+
+    explicit EventCache(const QString& log_path);
+
+    QString path() const;
+
+    // In bytes, 0 when caching is off
+    static qint64 budget();
+
+    // Maps the snapshot in and hands its batches to sink one at a time as they're decoded,
+    // missing if there isn't one for the log as it is now. The mapping stays until the last
+    // batch, or copy of one, is gone.
+    Result read(const EventSink& sink, const CancelCheck& cancelled, const ProgressCallback& progress);
+
+    // Batches are written as they're parsed but nothing replaces the old snapshot until
+    // commit is called, so a cancelled or broken parse leaves no trace. Neither does one that
+    // grows past the whole budget.
+    bool begin_write();
+
+    void write(const EventStore& events);
+
+    // For batches written before the root was known, makes their files relative to it in the
+    // table that goes out with commit
+    void reroot_files(const QDir& root);
+
+    bool commit();
+private:
+    QByteArray header() const;
+
+    // Deletes the least recently used snapshots until they all fit in the budget
+    void prune() const;
+
+    QString log;
+    QString snapshot;
+    qint64 limit;
+    std::unique_ptr<QSaveFile> output;
+    uint64_t blocks = 0;
+    // The table being written and what links the events in it
+    StringPool strings;
+    // Which ids in strings are files
+    std::vector<bool> files;
+    ProcessIndex processes;
+    uint64_t nodes = 0;
+};
+
+#endif // EVENT_CACHE_H
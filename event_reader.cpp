@@ -0,0 +1,499 @@
+#include "event_reader.h"
+#include <QDebug>
+#include <algorithm>
+
+// Big enough that refills are rare, small enough it doesn't matter next to the events
+static constexpr qint64 READ_CHUNK = 1 << 20;
+// manifest_paths is written after the events, so it should be in the last few KB
+static constexpr qint64 TAIL_PROBE = 1 << 16;
+// How many events are collected before they're handed to the sink
+static constexpr size_t FLUSH_EVENTS = 4096;
+
+QDir choose_root(const QStringList& manifest_paths) {
+    QDir root_path;
+    for(const QString& root: manifest_paths) {
+        auto tmp = QDir(root);
+        if(root_path == QDir::currentPath() || tmp.count() < root_path.count()) {
+            root_path = tmp;
+        }
+    }
+    return root_path;
+}
+
+QStringList parse_manifest(const char* begin, const char* end) {
+    QStringList paths;
+    for_each_element(begin, end, [&](const char* value) -> const char* {
+        QByteArray path;
+        auto next = parse_string(value, end, path);
+        if(next) {
+            paths.append(QString::fromUtf8(path));
+            return next;
+        }
+        return skip_value(value, end);
+    });
+    return paths;
+}
+
+bool probe_manifest(const char* begin, const char* end, QStringList& paths) {
+    if(end - begin > TAIL_PROBE) {
+        begin = end - TAIL_PROBE;
+    }
+    static const char key[] = "\"manifest_paths\"";
+    const char* at = nullptr;
+    for(auto p = std::search(begin, end, key, key + sizeof(key) - 1); p != end; p = std::search(p + 1, end, key, key + sizeof(key) - 1)) {
+        at = p;
+    }
+    if(!at) {
+        return false;
+    }
+    auto p = skip_whitespace(skip_string(at, end), end);
+    if(p == end || *p != ':') {
+        return false;
+    }
+    auto value = skip_whitespace(p + 1, end);
+    auto value_end = skip_value(value, end);
+    // Make sure we've found the key and not something in a description
+    auto after = value_end ? skip_whitespace(value_end, end) : end;
+    if(after == end || (*after != '}' && *after != ',')) {
+        return false;
+    }
+    paths = parse_manifest(value, value_end);
+    return true;
+}
+
+static const char* read_int(const char* value, const char* end, uint32_t& field, uint8_t& present, uint8_t flag) {
+    int64_t v = 0;
+    auto next = parse_int(value, end, v);
+    field = static_cast<uint32_t>(v);
+    present |= flag;
+    return next ? next : skip_value(value, end);
+}
+
+static RunType str_to_run_type(std::string_view tyname) {
+    if(tyname == "Doctests") {
+        return RunType::Doctests;
+    } else if(tyname == "Benchmarks") {
+        return RunType::Benchmarks;
+    } else if(tyname == "Examples") {
+        return RunType::Examples;
+    } else if(tyname == "Lib") {
+        return RunType::Lib;
+    } else if(tyname == "Bins") {
+        return RunType::Bins;
+    } else if(tyname == "AllTargets") {
+        return RunType::AllTargets;
+    }
+    return RunType::Tests;
+}
+
+EventDecoder::EventDecoder(const QString& root):
+    root(root),
+    keep_paths(root.isEmpty())
+{
+}
+
+const char* EventDecoder::read_string(const char* value, const char* end, EventStore& events, uint32_t& id) {
+    std::string_view s;
+    auto next = parse_string_view(value, end, s, scratch);
+    id = events.strings().intern(s);
+    return next ? next : skip_value(value, end);
+}
+
+uint32_t EventDecoder::relative_path(std::string_view path, EventStore& events) {
+    if(keep_paths) {
+        return events.strings().intern(path);
+    }
+    auto raw = raw_paths.intern(path);
+    if(raw >= relative_paths.size()) {
+        relative_paths.resize(raw + 1, NOT_SEEN);
+    }
+    if(relative_paths[raw] == NOT_SEEN) {
+        relative_paths[raw] = paths.intern(root.relativeFilePath(raw_paths.get(raw)));
+    }
+    return events.strings().intern(paths.bytes(relative_paths[raw]));
+}
+
+uint32_t EventDecoder::binary_name(std::string_view path, EventStore& events) {
+    auto raw = raw_paths.intern(path);
+    if(raw >= binary_names.size()) {
+        binary_names.resize(raw + 1, NOT_SEEN);
+    }
+    if(binary_names[raw] == NOT_SEEN) {
+        QString file = root.relativeFilePath(raw_paths.get(raw));
+        if(!file.isEmpty()) {
+            file = file.split("/").last();
+        }
+        binary_names[raw] = paths.intern(file);
+    }
+    return events.strings().intern(paths.bytes(binary_names[raw]));
+}
+
+const char* EventDecoder::decode_trace(const char* p, const char* end, EventStore& events) {
+    TraceRow row;
+    const char* location = nullptr;
+    auto next = for_each_member(p, end, [&](std::string_view key, const char* value) -> const char* {
+        if(is_null(value, end)) {
+            return skip_value(value, end);
+        }
+        if(key == "pid") {
+            return read_int(value, end, row.pid, row.present, EventStore::HAS_PID);
+        } else if(key == "child") {
+            return read_int(value, end, row.child, row.present, EventStore::HAS_CHILD);
+        } else if(key == "signal") {
+            std::string_view name;
+            auto next = parse_string_view(value, end, name, scratch);
+            row.signal = str_to_sig(name);
+            row.present |= EventStore::HAS_SIGNAL;
+            return next ? next : skip_value(value, end);
+        } else if(key == "addr") {
+            auto next = parse_uint(value, end, row.addr);
+            row.present |= EventStore::HAS_ADDR;
+            return next ? next : skip_value(value, end);
+        } else if(key == "location") {
+            location = value;
+        } else if(key == "return_val") {
+            int64_t ret = 0;
+            auto next = parse_int(value, end, ret);
+            row.ret = static_cast<uint64_t>(ret);
+            row.present |= EventStore::HAS_RET;
+            return next ? next : skip_value(value, end);
+        } else if(key == "description") {
+            return read_string(value, end, events, row.description);
+        }
+        return skip_value(value, end);
+    });
+    if(!next) {
+        return nullptr;
+    }
+    if((row.present & EventStore::HAS_ADDR) && location) {
+        // if we have a location we have a file and a line
+        std::string_view file;
+        int64_t line = 0;
+        for_each_member(location, end, [&](std::string_view key, const char* value) -> const char* {
+            if(key == "file") {
+                auto next = parse_string_view(value, end, file, scratch);
+                return next ? next : skip_value(value, end);
+            } else if(key == "line") {
+                auto next = parse_int(value, end, line);
+                return next ? next : skip_value(value, end);
+            }
+            return skip_value(value, end);
+        });
+        row.file = relative_path(file, events);
+        row.line = static_cast<int32_t>(line);
+        row.present |= EventStore::HAS_LOCATION;
+    }
+    events.append(row);
+    return next;
+}
+
+const char* EventDecoder::decode_binary(const char* p, const char* end, EventStore& events) {
+    BinaryRow bin;
+    auto next = for_each_member(p, end, [&](std::string_view key, const char* value) -> const char* {
+        if(key == "path") {
+            std::string_view path;
+            auto next = parse_string_view(value, end, path, scratch);
+            bin.path = binary_name(path, events);
+            return next ? next : skip_value(value, end);
+        } else if(key == "should_panic") {
+            auto next = parse_bool(value, end, bin.should_panic);
+            return next ? next : skip_value(value, end);
+        } else if(key == "ty") {
+            std::string_view tyname;
+            auto next = parse_string_view(value, end, tyname, scratch);
+            bin.ty = str_to_run_type(tyname);
+            return next ? next : skip_value(value, end);
+        } else if(key == "cargo_dir") {
+            uint32_t dir = 0;
+            auto next = read_string(value, end, events, dir);
+            bin.cargo_dir = dir;
+            return next;
+        } else if(key == "pkg_name") {
+            uint32_t name = 0;
+            auto next = read_string(value, end, events, name);
+            bin.pkg_name = name;
+            return next;
+        }
+        return skip_value(value, end);
+    });
+    if(next) {
+        events.append(bin);
+    }
+    return next;
+}
+
+bool EventDecoder::decode(const char* begin, const char* end, EventStore& events) {
+    // Event is either: ConfigLaunch, BinaryLaunch, Trace or Marker
+    auto next = for_each_member(begin, end, [&](std::string_view key, const char* value) -> const char* {
+        if(key == "ConfigLaunch") {
+            uint32_t name = 0;
+            auto next = read_string(value, end, events, name);
+            events.append_config(name);
+            return next;
+        } else if(key == "BinaryLaunch") {
+            return decode_binary(value, end, events);
+        } else if(key == "Trace") {
+            return decode_trace(value, end, events);
+        } else if(key == "Marker") {
+            events.append_marker();
+        }
+        return skip_value(value, end);
+    });
+    return next != nullptr;
+}
+
+EventReader::EventReader(QIODevice* device):
+    device(device)
+{
+}
+
+bool EventReader::truncated() const {
+    return is_truncated;
+}
+
+QString EventReader::error() const {
+    return error_message;
+}
+
+QDir EventReader::root() const {
+    return root_dir;
+}
+
+void EventReader::set_root(const QDir& root) {
+    root_dir = root;
+    have_manifest = true;
+}
+
+size_t EventReader::events_read() const {
+    return event_count;
+}
+
+void EventReader::set_progress(ProgressCallback callback) {
+    progress = std::move(callback);
+}
+
+void EventReader::set_cancel(CancelCheck check) {
+    cancelled = std::move(check);
+}
+
+bool EventReader::rooted_late() const {
+    return late_root;
+}
+
+bool EventReader::read(const EventSink& sink) {
+    if(!device->isSequential() && !have_manifest) {
+        find_manifest();
+    }
+    auto complete = parse(sink);
+    flush(sink);
+    // Without any manifest the paths go relative to the same default root a mapped read uses
+    if(kept_paths && !have_manifest) {
+        late_root = true;
+    }
+    return complete || is_truncated;
+}
+
+void EventReader::flush(const EventSink& sink) {
+    if(!decoded.empty()) {
+        event_count += decoded.size();
+        sink(decoded);
+        decoded.clear();
+    }
+}
+
+bool EventReader::fill() {
+    if(pos > 0 && pos >= buffer.size() / 2) {
+        buffer.remove(0, pos);
+        pos = 0;
+    }
+    auto old_size = buffer.size();
+    buffer.resize(old_size + READ_CHUNK);
+    auto n = device->read(buffer.data() + old_size, READ_CHUNK);
+    buffer.resize(old_size + std::max<qint64>(n, 0));
+    if(progress && n > 0) {
+        progress(device->pos(), device->isSequential() ? 0 : device->size());
+    }
+    return n > 0;
+}
+
+bool EventReader::skip_ws() {
+    while(true) {
+        auto begin = buffer.constData() + pos;
+        auto p = skip_whitespace(begin, buffer.constData() + buffer.size());
+        pos += p - begin;
+        if(pos < buffer.size()) {
+            return true;
+        }
+        if(!fill()) {
+            return false;
+        }
+    }
+}
+
+bool EventReader::expect(char c) {
+    if(!skip_ws()) {
+        return stop(Scan::partial);
+    }
+    if(buffer.at(pos) != c) {
+        return stop(Scan::invalid);
+    }
+    pos++;
+    return true;
+}
+
+Scan EventReader::next_value(qsizetype& value_end) {
+    while(true) {
+        auto begin = buffer.constData() + pos;
+        auto p = begin;
+        auto result = scan_value(p, buffer.constData() + buffer.size());
+        if(result == Scan::ok) {
+            value_end = pos + (p - begin);
+            return result;
+        }
+        // Refilling can move the buffer so everything is recomputed from pos
+        if(result == Scan::invalid || !fill()) {
+            return result;
+        }
+    }
+}
+
+bool EventReader::stop(Scan result) {
+    if(result == Scan::partial) {
+        is_truncated = true;
+        error_message = QString("Log ends part way through, %1 events recovered").arg(event_count);
+    } else if(error_message.isEmpty()) {
+        error_message = QString("Invalid JSON after %1 events").arg(event_count);
+    }
+    return false;
+}
+
+void EventReader::set_manifest(const char* begin, const char* end) {
+    root_dir = choose_root(parse_manifest(begin, end));
+    have_manifest = true;
+}
+
+bool EventReader::probe_tail() {
+    auto size = device->size();
+    auto from = std::max<qint64>(0, size - TAIL_PROBE);
+    if(!device->seek(from)) {
+        return false;
+    }
+    QByteArray tail = device->read(size - from);
+    QStringList paths;
+    if(!probe_manifest(tail.constData(), tail.constData() + tail.size(), paths)) {
+        return false;
+    }
+    root_dir = choose_root(paths);
+    have_manifest = true;
+    return true;
+}
+
+void EventReader::find_manifest() {
+    // Anywhere else it's found as the log's read, paths read before it are kept as they are
+    auto start = device->pos();
+    probe_tail();
+    device->seek(start);
+}
+
+bool EventReader::parse(const EventSink& sink) {
+    if(!expect('{')) {
+        return false;
+    }
+    if(!skip_ws()) {
+        return stop(Scan::partial);
+    }
+    if(buffer.at(pos) == '}') {
+        pos++;
+        return true;
+    }
+    while(true) {
+        qsizetype value_end = 0;
+        if(!skip_ws()) {
+            return stop(Scan::partial);
+        }
+        auto result = next_value(value_end);
+        if(result != Scan::ok) {
+            return stop(result);
+        }
+        QByteArray key;
+        if(!parse_string(buffer.constData() + pos, buffer.constData() + value_end, key)) {
+            return stop(Scan::invalid);
+        }
+        pos = value_end;
+        if(!expect(':')) {
+            return false;
+        }
+        if(key == "events") {
+            if(!read_events(sink)) {
+                return false;
+            }
+        } else {
+            if(!skip_ws()) {
+                return stop(Scan::partial);
+            }
+            result = next_value(value_end);
+            if(result != Scan::ok) {
+                return stop(result);
+            }
+            if(key == "manifest_paths" && !have_manifest) {
+                set_manifest(buffer.constData() + pos, buffer.constData() + value_end);
+                late_root = kept_paths;
+            }
+            pos = value_end;
+        }
+        if(!skip_ws()) {
+            return stop(Scan::partial);
+        }
+        auto c = buffer.at(pos++);
+        if(c == '}') {
+            return true;
+        } else if(c != ',') {
+            return stop(Scan::invalid);
+        }
+    }
+}
+
+bool EventReader::read_events(const EventSink& sink) {
+    if(!expect('[')) {
+        return false;
+    }
+    if(!skip_ws()) {
+        return stop(Scan::partial);
+    }
+    if(buffer.at(pos) == ']') {
+        pos++;
+        return true;
+    }
+    kept_paths = kept_paths || !have_manifest;
+    EventDecoder decoder(have_manifest ? root_dir.path() : QString());
+    while(true) {
+        qsizetype value_end = 0;
+        if(!skip_ws()) {
+            return stop(Scan::partial);
+        }
+        auto result = next_value(value_end);
+        if(result != Scan::ok) {
+            return stop(result);
+        }
+        if(cancelled && cancelled()) {
+            error_message = "Cancelled";
+            return false;
+        }
+        if(!decoder.decode(buffer.constData() + pos, buffer.constData() + value_end, decoded)) {
+            qDebug()<<"Skipping malformed event after"<<event_count + decoded.size()<<"events";
+        }
+        if(decoded.size() >= FLUSH_EVENTS) {
+            flush(sink);
+        }
+        pos = value_end;
+        if(!skip_ws()) {
+            return stop(Scan::partial);
+        }
+        auto c = buffer.at(pos++);
+        if(c == ']') {
+            return true;
+        } else if(c != ',') {
+            return stop(Scan::invalid);
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef EVENT_READER_H
+#define EVENT_READER_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QIODevice>
+#include <QStringList>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "event_store.h"
+#include "json_scan.h"
+
+// Gets handed newly decoded events as they're read. It's free to move them out, the
+// store is cleared once it returns.
+using EventSink = std::function<void(EventStore& events)>;
+// Called with bytes done and total bytes, total is 0 if it isn't known
+using ProgressCallback = std::function<void(qint64, qint64)>;
+using CancelCheck = std::function<bool()>;
+
+// Picks the project root file paths are shown relative to from the logs manifest_paths
+QDir choose_root(const QStringList& manifest_paths);
+
+QStringList parse_manifest(const char* begin, const char* end);
+
+// Looks for manifest_paths in the last few KB of a log, where tarpaulin puts it
+bool probe_manifest(const char* begin, const char* end, QStringList& paths);
+
+// Decodes elements of the events array into a store. Strings are interned straight from
+// the input and each distinct path is only made relative to the root once. Without a root
+// paths are kept as they're written, for EventStore::reroot_files once it's known.
+class EventDecoder {
+public:
+    explicit EventDecoder(const QString& root = QString());
+
+    // [begin, end) has to hold the whole element. Returns false if it's not valid JSON.
+    bool decode(const char* begin, const char* end, EventStore& events);
+private:
+    static constexpr uint32_t NOT_SEEN = UINT32_MAX;
+
+    const char* decode_trace(const char* p, const char* end, EventStore& events);
+    const char* decode_binary(const char* p, const char* end, EventStore& events);
+    const char* read_string(const char* value, const char* end, EventStore& events, uint32_t& id);
+    uint32_t relative_path(std::string_view path, EventStore& events);
+    uint32_t binary_name(std::string_view path, EventStore& events);
+
+    QDir root;
+    bool keep_paths;
+    // Paths as they appear in the log, indexes into the two vectors below which hold ids
+    // in paths. Kept apart from the stores pool as that's replaced on every flush.
+    StringPool raw_paths;
+    StringPool paths;
+    std::vector<uint32_t> relative_paths;
+    std::vector<uint32_t> binary_names;
+    QByteArray scratch;
+};
+
+// Streams a tarpaulin event log pulling the entries of the events array out one at a
+// time, so only the current element and the decoded events are ever held in memory.
+// If the log was cut short all the events before the damaged one are still returned.
+// manifest_paths usually comes after the events, seekable devices have their tail checked
+// for it first but otherwise events are decoded with their paths as written until it's seen.
+class EventReader {
+public:
+    explicit EventReader(QIODevice* device);
+
+    // Returns false if the log couldn't be read at all, a truncated log still returns true
+    bool read(const EventSink& sink);
+
+    bool truncated() const;
+
+    QString error() const;
+
+    QDir root() const;
+
+    // The root only turned up after some events were handed over, their paths are as the
+    // log has them and want EventStore::reroot_files
+    bool rooted_late() const;
+
+    // For when the root's already known, a sequential device can't be searched for it
+    void set_root(const QDir& root);
+
+    size_t events_read() const;
+
+    void set_progress(ProgressCallback callback);
+
+    void set_cancel(CancelCheck check);
+private:
+    bool parse(const EventSink& sink);
+    bool read_events(const EventSink& sink);
+    void find_manifest();
+    bool probe_tail();
+    void set_manifest(const char* begin, const char* end);
+
+    void flush(const EventSink& sink);
+    bool fill();
+    bool skip_ws();
+    bool expect(char c);
+    Scan next_value(qsizetype& value_end);
+    bool stop(Scan result);
+
+    QIODevice* device;
+    QByteArray buffer;
+    qsizetype pos = 0;
+    bool have_manifest = false;
+    // Events were decoded before there was a root
+    bool kept_paths = false;
+    bool late_root = false;
+    bool is_truncated = false;
+    QString error_message;
+    QDir root_dir;
+    size_t event_count = 0;
+    EventStore decoded;
+    ProgressCallback progress;
+    CancelCheck cancelled;
+};
+
+#endif // EVENT_READER_H
@@ -0,0 +1,618 @@
+#include "event_store.h"
+#include <cstring>
+
+size_t EventStore::size() const {
+    return kinds.size();
+}
+
+bool EventStore::empty() const {
+    return kinds.empty();
+}
+
+void EventStore::clear() {
+    *this = EventStore();
+}
+
+void EventStore::reserve(size_t n) {
+    kinds.reserve(n);
+    present.reserve(n);
+    pids.reserve(n);
+    children.reserve(n);
+    signal_values.reserve(n);
+    addrs.reserve(n);
+    rets.reserve(n);
+    lines.reserve(n);
+    file_ids.reserve(n);
+    description_ids.reserve(n);
+    payloads.reserve(n);
+}
+
+StringPool& EventStore::strings() {
+    // Anything else still sharing the pool keeps it as it is
+    if(pool.use_count() > 1) {
+        pool = std::make_shared<StringPool>(*pool);
+    }
+    return *pool;
+}
+
+const StringPool& EventStore::strings() const {
+    return *pool;
+}
+
+void EventStore::append_empty(EventKind kind, uint32_t payload) {
+    kinds.push_back(kind);
+    present.push_back(0);
+    pids.push_back(0);
+    children.push_back(0);
+    signal_values.push_back(0);
+    addrs.push_back(0);
+    rets.push_back(0);
+    lines.push_back(0);
+    file_ids.push_back(0);
+    description_ids.push_back(0);
+    payloads.push_back(payload);
+}
+
+void EventStore::append_config(uint32_t name) {
+    append_empty(EventKind::config, static_cast<uint32_t>(configs.size()));
+    configs.push_back(name);
+}
+
+void EventStore::append(const BinaryRow& bin) {
+    append_empty(EventKind::binary, static_cast<uint32_t>(binaries.size()));
+    binaries.push_back(bin);
+}
+
+void EventStore::append(const TraceRow& trace) {
+    kinds.push_back(EventKind::trace);
+    present.push_back(trace.present);
+    pids.push_back(trace.pid);
+    children.push_back(trace.child);
+    signal_values.push_back(static_cast<uint8_t>(trace.signal));
+    addrs.push_back(trace.addr);
+    rets.push_back(trace.ret);
+    lines.push_back(trace.line);
+    file_ids.push_back(trace.file);
+    description_ids.push_back(trace.description);
+    payloads.push_back(0);
+}
+
+void EventStore::append_marker() {
+    append_empty(EventKind::marker, 0);
+}
+
+const std::vector<uint32_t>& EventStore::adopt_strings(const EventStore& other) {
+    // Pools only ever grow so a mapping for the same one is good for as much as it covers
+    if(adopted_from.lock() != other.pool || adopted_ids.size() != other.pool->size()) {
+        adopted_ids = strings().merge(*other.pool);
+        adopted_from = other.pool;
+    }
+    return adopted_ids;
+}
+
+void EventStore::append(const EventStore& other, size_t row, const std::vector<uint32_t>& string_map) {
+    switch(other.kinds[row]) {
+    case EventKind::config:
+        append_config(string_map[other.configs[other.payloads[row]]]);
+        break;
+    case EventKind::binary: {
+        auto bin = other.binaries[other.payloads[row]];
+        bin.path = string_map[bin.path];
+        if(bin.cargo_dir) {
+            bin.cargo_dir = string_map[*bin.cargo_dir];
+        }
+        if(bin.pkg_name) {
+            bin.pkg_name = string_map[*bin.pkg_name];
+        }
+        append(bin);
+        break;
+    }
+    case EventKind::marker:
+        append_marker();
+        break;
+    case EventKind::trace:
+        kinds.push_back(EventKind::trace);
+        present.push_back(other.present[row]);
+        pids.push_back(other.pids[row]);
+        children.push_back(other.children[row]);
+        signal_values.push_back(other.signal_values[row]);
+        addrs.push_back(other.addrs[row]);
+        rets.push_back(other.rets[row]);
+        lines.push_back(other.lines[row]);
+        file_ids.push_back(string_map[other.file_ids[row]]);
+        description_ids.push_back(string_map[other.description_ids[row]]);
+        payloads.push_back(0);
+        break;
+    }
+}
+
+void EventStore::append(const EventStore& other) {
+    if(empty()) {
+        *this = other;
+        return;
+    }
+    auto first = kinds.size();
+    auto first_binary = binaries.size();
+    auto config_offset = static_cast<uint32_t>(configs.size());
+    auto binary_offset = static_cast<uint32_t>(first_binary);
+    const auto& string_map = adopt_strings(other);
+    kinds.append(other.kinds);
+    present.append(other.present);
+    pids.append(other.pids);
+    children.append(other.children);
+    signal_values.append(other.signal_values);
+    addrs.append(other.addrs);
+    rets.append(other.rets);
+    lines.append(other.lines);
+    file_ids.append(other.file_ids);
+    description_ids.append(other.description_ids);
+    payloads.append(other.payloads);
+    for(auto name: other.configs) {
+        configs.push_back(string_map[name]);
+    }
+    binaries.insert(binaries.end(), other.binaries.begin(), other.binaries.end());
+    for(auto i=first_binary; i<binaries.size(); i++) {
+        auto& bin = binaries[i];
+        bin.path = string_map[bin.path];
+        if(bin.cargo_dir) {
+            bin.cargo_dir = string_map[*bin.cargo_dir];
+        }
+        if(bin.pkg_name) {
+            bin.pkg_name = string_map[*bin.pkg_name];
+        }
+    }
+    for(auto i=first; i<kinds.size(); i++) {
+        file_ids[i] = string_map[file_ids[i]];
+        description_ids[i] = string_map[description_ids[i]];
+        if(kinds[i] == EventKind::config) {
+            payloads[i] += config_offset;
+        } else if(kinds[i] == EventKind::binary) {
+            payloads[i] += binary_offset;
+        }
+    }
+}
+
+EventKind EventStore::kind(size_t i) const {
+    return kinds[i];
+}
+
+bool EventStore::has(size_t i, uint8_t field) const {
+    return (present[i] & field) != 0;
+}
+
+std::optional<uint64_t> EventStore::pid(size_t i) const {
+    if(has(i, HAS_PID)) {
+        return pids[i];
+    }
+    return std::nullopt;
+}
+
+std::optional<uint64_t> EventStore::child(size_t i) const {
+    if(has(i, HAS_CHILD)) {
+        return children[i];
+    }
+    return std::nullopt;
+}
+
+std::optional<Signal> EventStore::signal(size_t i) const {
+    if(has(i, HAS_SIGNAL)) {
+        return static_cast<Signal>(signal_values[i]);
+    }
+    return std::nullopt;
+}
+
+std::optional<uint64_t> EventStore::addr(size_t i) const {
+    if(has(i, HAS_ADDR)) {
+        return addrs[i];
+    }
+    return std::nullopt;
+}
+
+std::optional<uint64_t> EventStore::ret(size_t i) const {
+    if(has(i, HAS_RET)) {
+        return rets[i];
+    }
+    return std::nullopt;
+}
+
+std::optional<QString> EventStore::file(size_t i) const {
+    if(has(i, HAS_LOCATION)) {
+        return pool->get(file_ids[i]);
+    }
+    return std::nullopt;
+}
+
+std::optional<int> EventStore::line(size_t i) const {
+    if(has(i, HAS_LOCATION)) {
+        return lines[i];
+    }
+    return std::nullopt;
+}
+
+const QString& EventStore::description(size_t i) const {
+    return pool->get(description_ids[i]);
+}
+
+uint32_t EventStore::file_id(size_t i) const {
+    return file_ids[i];
+}
+
+uint32_t EventStore::description_id(size_t i) const {
+    return description_ids[i];
+}
+
+Config EventStore::config(size_t i) const {
+    return Config { pool->get(configs[payloads[i]]) };
+}
+
+TestBinary EventStore::binary(size_t i) const {
+    const auto& row = binaries[payloads[i]];
+    TestBinary bin;
+    bin.path = pool->get(row.path);
+    bin.ty = row.ty;
+    if(row.cargo_dir) {
+        bin.cargo_dir = pool->get(*row.cargo_dir);
+    }
+    if(row.pkg_name) {
+        bin.pkg_name = pool->get(*row.pkg_name);
+    }
+    bin.should_panic = row.should_panic;
+    return bin;
+}
+
+TraceEvent EventStore::trace(size_t i) const {
+    TraceEvent event;
+    event.pid = pid(i);
+    event.child = child(i);
+    event.signal = signal(i);
+    event.addr = addr(i);
+    event.ret = ret(i);
+    event.file = file(i);
+    event.line = line(i);
+    event.description = description(i);
+    return event;
+}
+
+QString EventStore::label(size_t i) const {
+    LabelPart parts[MAX_LABEL_PARTS];
+    auto count = label_parts(i, parts);
+    QString label;
+    for(size_t p=0; p<count; p++) {
+        if(p > 0) {
+            label.append('\n');
+        }
+        label.append(part_text(parts[p]));
+    }
+    return label;
+}
+
+size_t EventStore::label_parts(size_t i, LabelPart* parts) const {
+    switch(kinds[i]) {
+    case EventKind::config:
+        parts[0] = LabelPart{LabelField::text, configs[payloads[i]]};
+        return 1;
+    case EventKind::binary:
+        parts[0] = LabelPart{LabelField::text, binaries[payloads[i]].path};
+        return 1;
+    case EventKind::trace:
+        break;
+    default:
+        return 0;
+    }
+    // Same lines in the same order as TraceEvent::to_string
+    size_t count = 0;
+    if(has(i, HAS_PID)) {
+        parts[count++] = LabelPart{LabelField::pid, pids[i]};
+    }
+    if(has(i, HAS_CHILD)) {
+        parts[count++] = LabelPart{LabelField::child, children[i]};
+    }
+    if(has(i, HAS_SIGNAL) && static_cast<Signal>(signal_values[i]) != Signal::unknown) {
+        parts[count++] = LabelPart{LabelField::signal, signal_values[i]};
+    }
+    if(has(i, HAS_ADDR)) {
+        parts[count++] = LabelPart{LabelField::addr, addrs[i]};
+    }
+    if(has(i, HAS_LOCATION)) {
+        parts[count++] = LabelPart{LabelField::location, static_cast<uint64_t>(file_ids[i]) << 32 | static_cast<uint32_t>(lines[i])};
+    }
+    if(has(i, HAS_RET)) {
+        parts[count++] = LabelPart{LabelField::ret, rets[i]};
+    }
+    parts[count++] = LabelPart{LabelField::text, description_ids[i]};
+    return count;
+}
+
+QString EventStore::part_text(const LabelPart& part) const {
+    switch(part.field) {
+    case LabelField::text:
+        return pool->get(static_cast<uint32_t>(part.value));
+    case LabelField::pid:
+        return QString("pid: %1").arg(static_cast<int>(part.value));
+    case LabelField::child:
+        return QString("child: %1").arg(static_cast<int>(part.value));
+    case LabelField::signal:
+        return sig_to_str(static_cast<Signal>(part.value));
+    case LabelField::addr:
+        return QString("addr: %1").arg(part.value);
+    case LabelField::location:
+        return QString("%1:%2").arg(pool->get(static_cast<uint32_t>(part.value >> 32))).arg(static_cast<int32_t>(part.value));
+    case LabelField::ret:
+        return QString("return: %1").arg(static_cast<int>(part.value));
+    }
+    return QString();
+}
+
+void EventStore::reroot_files(const QDir& root) {
+    auto& names = strings();
+    std::vector<bool> done(names.size(), false);
+    for(size_t i=0; i<kinds.size(); i++) {
+        auto id = file_ids[i];
+        if(!has(i, HAS_LOCATION) || done[id]) {
+            continue;
+        }
+        done[id] = true;
+        auto relative = root.relativeFilePath(names.get(id)).toUtf8();
+        names.replace(id, std::string_view(relative.constData(), static_cast<size_t>(relative.size())));
+    }
+}
+
+bool EventStore::has_parents() const {
+    return !parents.empty() && parents.size() == kinds.size();
+}
+
+size_t EventStore::parent(size_t i) const {
+    return parents[i] == UINT32_MAX ? NO_PARENT : parents[i];
+}
+
+bool EventStore::is_end_node(size_t i) const {
+    if(kinds[i] == EventKind::trace) {
+        return has(i, HAS_RET);
+    }
+    return true;
+}
+
+bool EventStore::is_bad(size_t i) const {
+    if(kinds[i] != EventKind::trace) {
+        return false;
+    }
+    if(has(i, HAS_RET) && rets[i] != 0) {
+        return true;
+    }
+    if(has(i, HAS_SIGNAL)) {
+        auto s = static_cast<Signal>(signal_values[i]);
+        return s == Signal::sigsegv || s == Signal::sigill;
+    }
+    return false;
+}
+
+QColor EventStore::colour(size_t i) const {
+    return node_colours()[colour_index(i)];
+}
+
+size_t EventStore::colour_index(size_t i) const {
+    if(kinds[i] == EventKind::trace) {
+        return trace_colour_index(signal(i), has(i, HAS_RET));
+    } else if(kinds[i] == EventKind::binary) {
+        return binary_colour_index(binaries[payloads[i]].ty);
+    }
+    return node_colours().size() - 1;
+}
+
+// Sections are padded so every column starts 8 byte aligned in a mapped file
+static void pad(QByteArray& out) {
+    while(out.size() % 8 != 0) {
+        out.append('\0');
+    }
+}
+
+template<typename T>
+static void put(QByteArray& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static void put(QByteArray& out, const T* column, size_t n) {
+    out.append(reinterpret_cast<const char*>(column), static_cast<int>(n * sizeof(T)));
+}
+
+template<typename T>
+static void put(QByteArray& out, const std::vector<T>& column) {
+    put(out, column.data(), column.size());
+}
+
+template<typename T>
+static void put(QByteArray& out, const Column<T>& column) {
+    put(out, column.data(), column.size());
+}
+
+template<typename T>
+static bool get(const char*& p, const char* end, T& value) {
+    if(static_cast<size_t>(end - p) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+template<typename T>
+static bool get(const char*& p, const char* end, std::vector<T>& column, uint64_t n) {
+    if(static_cast<uint64_t>(end - p) / sizeof(T) < n) {
+        return false;
+    }
+    column.resize(n);
+    std::memcpy(column.data(), p, n * sizeof(T));
+    p += n * sizeof(T);
+    return true;
+}
+
+// Blocks keep every column aligned so they can be used where they are
+template<typename T>
+static bool view(const char*& p, const char* end, Column<T>& column, uint64_t n) {
+    if(static_cast<uint64_t>(end - p) / sizeof(T) < n || reinterpret_cast<uintptr_t>(p) % alignof(T) != 0) {
+        return false;
+    }
+    column.view_of(reinterpret_cast<const T*>(p), n);
+    p += n * sizeof(T);
+    return true;
+}
+
+static bool skip_pad(const char*& p, const char* begin, const char* end) {
+    auto offset = (p - begin) % 8;
+    if(offset != 0) {
+        if(end - p < 8 - offset) {
+            return false;
+        }
+        p += 8 - offset;
+    }
+    return true;
+}
+
+static bool skip(const char*& p, const char* end, uint64_t n, size_t size) {
+    if(static_cast<uint64_t>(end - p) / size < n) {
+        return false;
+    }
+    p += n * size;
+    return true;
+}
+
+static constexpr uint32_t NONE = UINT32_MAX;
+static constexpr uint8_t NO_TYPE = UINT8_MAX;
+
+void EventStore::write_block(QByteArray& out, const std::vector<uint32_t>& string_map, const std::vector<uint32_t>& parent_nodes) const {
+    uint64_t rows = kinds.size();
+    uint64_t config_count = configs.size();
+    uint64_t binary_count = binaries.size();
+    put(out, rows);
+    put(out, config_count);
+    put(out, binary_count);
+    put(out, kinds);
+    put(out, present);
+    put(out, signal_values);
+    pad(out);
+    put(out, addrs);
+    put(out, rets);
+    put(out, pids);
+    put(out, children);
+    put(out, lines);
+    std::vector<uint32_t> mapped(rows);
+    for(size_t i=0; i<rows; i++) {
+        mapped[i] = string_map[file_ids[i]];
+    }
+    put(out, mapped);
+    for(size_t i=0; i<rows; i++) {
+        mapped[i] = string_map[description_ids[i]];
+    }
+    put(out, mapped);
+    put(out, payloads);
+    put(out, parent_nodes);
+    for(auto name: configs) {
+        put(out, string_map[name]);
+    }
+    std::vector<uint32_t> paths, cargo_dirs, pkg_names;
+    std::vector<uint8_t> types, should_panic;
+    for(const auto& bin: binaries) {
+        paths.push_back(string_map[bin.path]);
+        cargo_dirs.push_back(bin.cargo_dir ? string_map[*bin.cargo_dir] : NONE);
+        pkg_names.push_back(bin.pkg_name ? string_map[*bin.pkg_name] : NONE);
+        types.push_back(bin.ty ? static_cast<uint8_t>(*bin.ty) : NO_TYPE);
+        should_panic.push_back(bin.should_panic ? 1 : 0);
+    }
+    put(out, paths);
+    put(out, cargo_dirs);
+    put(out, pkg_names);
+    put(out, types);
+    put(out, should_panic);
+    pad(out);
+}
+
+bool EventStore::skip_block(const char*& p, const char* end) {
+    auto begin = p;
+    uint64_t rows = 0, config_count = 0, binary_count = 0;
+    if(!get(p, end, rows) || !get(p, end, config_count) || !get(p, end, binary_count)) {
+        return false;
+    }
+    if(rows > UINT32_MAX || config_count > UINT32_MAX || binary_count > UINT32_MAX) {
+        return false;
+    }
+    // Kinds, presence and signals, then addrs and rets, then the seven 32 bit columns
+    return skip(p, end, rows, 3) && skip_pad(p, begin, end) && skip(p, end, rows, 2 * sizeof(uint64_t) + 7 * sizeof(uint32_t))
+        && skip(p, end, config_count, sizeof(uint32_t)) && skip(p, end, binary_count, 3 * sizeof(uint32_t) + 2)
+        && skip_pad(p, begin, end);
+}
+
+bool EventStore::read_block(const char*& p, const char* end, std::shared_ptr<StringPool> strings, std::shared_ptr<const void> mapping) {
+    clear();
+    pool = std::move(strings);
+    backing = std::move(mapping);
+    auto begin = p;
+    uint64_t rows = 0, config_count = 0, binary_count = 0;
+    if(!get(p, end, rows) || !get(p, end, config_count) || !get(p, end, binary_count)) {
+        return false;
+    }
+    if(rows > UINT32_MAX || config_count > UINT32_MAX || binary_count > UINT32_MAX) {
+        return false;
+    }
+    static_assert(sizeof(EventKind) == 1, "kinds are stored a byte each");
+    if(!view(p, end, kinds, rows) || !view(p, end, present, rows) || !view(p, end, signal_values, rows) || !skip_pad(p, begin, end)) {
+        return false;
+    }
+    for(size_t i=0; i<rows; i++) {
+        // Signals index the colour table so they're as bad as an unknown kind
+        if(static_cast<uint8_t>(kinds[i]) > static_cast<uint8_t>(EventKind::marker) || signal_values[i] >= static_cast<uint8_t>(Signal::_length)) {
+            return false;
+        }
+    }
+    if(!view(p, end, addrs, rows) || !view(p, end, rets, rows) || !view(p, end, pids, rows) || !view(p, end, children, rows)
+            || !view(p, end, lines, rows) || !view(p, end, file_ids, rows) || !view(p, end, description_ids, rows)
+            || !view(p, end, payloads, rows) || !view(p, end, parents, rows) || !view(p, end, configs, config_count)) {
+        return false;
+    }
+    std::vector<uint32_t> paths, cargo_dirs, pkg_names;
+    std::vector<uint8_t> types, should_panic;
+    if(!get(p, end, paths, binary_count) || !get(p, end, cargo_dirs, binary_count) || !get(p, end, pkg_names, binary_count)
+            || !get(p, end, types, binary_count) || !get(p, end, should_panic, binary_count) || !skip_pad(p, begin, end)) {
+        return false;
+    }
+    binaries.resize(binary_count);
+    for(size_t i=0; i<binary_count; i++) {
+        auto& bin = binaries[i];
+        bin.path = paths[i];
+        if(cargo_dirs[i] != NONE) {
+            bin.cargo_dir = cargo_dirs[i];
+        }
+        if(pkg_names[i] != NONE) {
+            bin.pkg_name = pkg_names[i];
+        }
+        if(types[i] != NO_TYPE) {
+            if(types[i] >= static_cast<uint8_t>(RunType::_length)) {
+                return false;
+            }
+            bin.ty = static_cast<RunType>(types[i]);
+        }
+        bin.should_panic = should_panic[i] != 0;
+    }
+    // Anything pointing outside the snapshot means it's damaged. Parents are checked by the
+    // reader as only it knows how many nodes came before.
+    uint64_t string_count = pool->size();
+    for(size_t i=0; i<rows; i++) {
+        if(file_ids[i] >= string_count || description_ids[i] >= string_count) {
+            return false;
+        }
+        if((kinds[i] == EventKind::config && payloads[i] >= config_count) || (kinds[i] == EventKind::binary && payloads[i] >= binary_count)) {
+            return false;
+        }
+    }
+    for(auto name: configs) {
+        if(name >= string_count) {
+            return false;
+        }
+    }
+    for(const auto& bin: binaries) {
+        if(bin.path >= string_count || bin.cargo_dir.value_or(0) >= string_count || bin.pkg_name.value_or(0) >= string_count) {
+            return false;
+        }
+    }
+    return true;
+}
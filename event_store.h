@@ -0,0 +1,281 @@
+#ifndef EVENT_STORE_H
+#define EVENT_STORE_H
+
+#include <QByteArray>
+#include <QColor>
+#include <QDir>
+#include <QString>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "string_pool.h"
+#include "types.h"
+
+enum class EventKind: uint8_t {
+    config,
+    binary,
+    trace,
+    marker
+};
+
+// A trace event as the parser fills it in, strings are ids in the stores pool
+struct TraceRow {
+    uint8_t present = 0;
+    uint32_t pid = 0;
+    uint32_t child = 0;
+    Signal signal = Signal::unknown;
+    uint64_t addr = 0;
+    uint64_t ret = 0;
+    int32_t line = 0;
+    uint32_t file = 0;
+    uint32_t description = 0;
+};
+
+struct BinaryRow {
+    uint32_t path = 0;
+    std::optional<RunType> ty;
+    std::optional<uint32_t> cargo_dir;
+    std::optional<uint32_t> pkg_name;
+    bool should_panic = false;
+};
+
+// What a part of an event's label is made of. Labels repeat far more a part at a time than
+// whole, so parts are what get measured and cached. value is a string id for text, the file
+// id above the line for a location, the number itself otherwise.
+enum class LabelField: uint8_t {
+    text,
+    pid,
+    child,
+    signal,
+    addr,
+    location,
+    ret
+};
+
+struct LabelPart {
+    LabelField field;
+    uint64_t value;
+
+    bool operator==(const LabelPart& other) const {
+        return field == other.field && value == other.value;
+    }
+};
+
+struct LabelPartHash {
+    size_t operator()(const LabelPart& part) const {
+        return std::hash<uint64_t>()(part.value * 8 + static_cast<uint64_t>(part.field));
+    }
+};
+
+// A column that either owns its values or views them where they already are, in a mapped
+// snapshot. A view is copied out into values of its own the first time it's changed.
+template<typename T>
+class Column {
+public:
+    size_t size() const {
+        return view ? view_size : values.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    const T* data() const {
+        return view ? view : values.data();
+    }
+
+    const T* begin() const {
+        return data();
+    }
+
+    const T* end() const {
+        return data() + size();
+    }
+
+    const T& operator[](size_t i) const {
+        return data()[i];
+    }
+
+    T& operator[](size_t i) {
+        own();
+        return values[i];
+    }
+
+    void push_back(const T& value) {
+        own();
+        values.push_back(value);
+    }
+
+    void append(const Column& other) {
+        own();
+        values.insert(values.end(), other.begin(), other.end());
+    }
+
+    void reserve(size_t n) {
+        own();
+        values.reserve(n);
+    }
+
+    // Whatever first points at has to outlive the column and every copy of it
+    void view_of(const T* first, size_t n) {
+        values.clear();
+        view = first;
+        view_size = n;
+    }
+private:
+    void own() {
+        if(view) {
+            values.assign(view, view + view_size);
+            view = nullptr;
+            view_size = 0;
+        }
+    }
+
+    std::vector<T> values;
+    const T* view = nullptr;
+    size_t view_size = 0;
+};
+
+// Events stored a column per field rather than one heap allocated variant each. The
+// optional trace fields share a byte of presence bits per event, configs and binaries are
+// rare enough that they're kept whole in side tables indexed from the payload column.
+// Every string is an id into the stores StringPool, which copies of a store share until one
+// of them adds to it.
+class EventStore {
+public:
+    static constexpr uint8_t HAS_PID = 1 << 0;
+    static constexpr uint8_t HAS_CHILD = 1 << 1;
+    static constexpr uint8_t HAS_SIGNAL = 1 << 2;
+    static constexpr uint8_t HAS_ADDR = 1 << 3;
+    static constexpr uint8_t HAS_RET = 1 << 4;
+    static constexpr uint8_t HAS_LOCATION = 1 << 5;
+    static constexpr size_t MAX_LABEL_PARTS = 7;
+    static constexpr size_t NO_PARENT = SIZE_MAX;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    void clear();
+
+    void reserve(size_t n);
+
+    StringPool& strings();
+
+    const StringPool& strings() const;
+
+    void append_config(uint32_t name);
+
+    void append(const BinaryRow& bin);
+
+    void append(const TraceRow& trace);
+
+    void append_marker();
+
+    // Pulls in the strings of other, the result is what append needs to copy rows over. Stores
+    // that share their strings, like the batches of one snapshot, are only merged once.
+    const std::vector<uint32_t>& adopt_strings(const EventStore& other);
+
+    void append(const EventStore& other, size_t row, const std::vector<uint32_t>& string_map);
+
+    void append(const EventStore& other);
+
+    EventKind kind(size_t i) const;
+
+    bool has(size_t i, uint8_t field) const;
+
+    std::optional<uint64_t> pid(size_t i) const;
+
+    std::optional<uint64_t> child(size_t i) const;
+
+    std::optional<Signal> signal(size_t i) const;
+
+    std::optional<uint64_t> addr(size_t i) const;
+
+    std::optional<uint64_t> ret(size_t i) const;
+
+    std::optional<QString> file(size_t i) const;
+
+    std::optional<int> line(size_t i) const;
+
+    const QString& description(size_t i) const;
+
+    uint32_t file_id(size_t i) const;
+
+    uint32_t description_id(size_t i) const;
+
+    Config config(size_t i) const;
+
+    TestBinary binary(size_t i) const;
+
+    // Rebuilds the full event, for the odd place that wants everything at once
+    TraceEvent trace(size_t i) const;
+
+    // Text shown for the event on the timeline, its parts a line apart
+    QString label(size_t i) const;
+
+    // Fills parts with what label(i) is made of top to bottom, returns how many there are
+    size_t label_parts(size_t i, LabelPart* parts) const;
+
+    // Text parts can run over more than one line, the rest are always one
+    QString part_text(const LabelPart& part) const;
+
+    bool is_end_node(size_t i) const;
+
+    bool is_bad(size_t i) const;
+
+    QColor colour(size_t i) const;
+
+    // Index of colour(i) in node_colours
+    size_t colour_index(size_t i) const;
+
+    // Makes the file of every location relative to root, for paths that were kept as they
+    // were written because the root wasn't known yet
+    void reroot_files(const QDir& root);
+
+    // Only stores read back from a snapshot know their parents without a ProcessIndex
+    bool has_parents() const;
+
+    // Parent node as ProcessIndex would have found it counting every event but markers from
+    // the start of the log, NO_PARENT for none
+    size_t parent(size_t i) const;
+
+    // Raw columns for the snapshot cache, host byte order. Strings are written as ids in one
+    // table for the whole snapshot that string_map takes ours to, parents are a node each.
+    void write_block(QByteArray& out, const std::vector<uint32_t>& string_map, const std::vector<uint32_t>& parents) const;
+
+    // Replaces the store with a block from write_block, p is moved past it. Columns aren't
+    // copied out, they're viewed where they are and backing keeps them there. strings is
+    // the snapshot's table and is shared rather than copied as well.
+    bool read_block(const char*& p, const char* end, std::shared_ptr<StringPool> strings, std::shared_ptr<const void> backing);
+
+    // Moves p past a block from write_block going only by its counts, false if it wouldn't
+    // fit before end. Nothing inside it is checked.
+    static bool skip_block(const char*& p, const char* end);
+private:
+    void append_empty(EventKind kind, uint32_t payload);
+
+    std::shared_ptr<StringPool> pool = std::make_shared<StringPool>();
+    std::shared_ptr<const void> backing;
+    Column<EventKind> kinds;
+    Column<uint8_t> present;
+    Column<uint32_t> pids;
+    Column<uint32_t> children;
+    Column<uint8_t> signal_values;
+    Column<uint64_t> addrs;
+    Column<uint64_t> rets;
+    Column<int32_t> lines;
+    Column<uint32_t> file_ids;
+    Column<uint32_t> description_ids;
+    Column<uint32_t> payloads;
+    Column<uint32_t> configs;
+    Column<uint32_t> parents;
+    std::vector<BinaryRow> binaries;
+    // Last pool adopt_strings merged and what it came out as
+    std::weak_ptr<const StringPool> adopted_from;
+    std::vector<uint32_t> adopted_ids;
+};
+
+#endif // EVENT_STORE_H
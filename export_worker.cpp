@@ -0,0 +1,21 @@
+#include "export_worker.h"
+#include "timeline_export.h"
+
+static constexpr int TILE_PIXELS = 1024;
+
+export_worker::export_worker(QObject* parent):
+    QObject(parent)
+{
+}
+
+void export_worker::write_svg(const QString& log, const QString& path) {
+    QString error;
+    auto ok = export_svg(log, path, error);
+    emit finished(path, ok, error);
+}
+
+void export_worker::write_png(const QString& log, const QString& directory, qreal scale) {
+    QString error;
+    auto ok = export_png_tiles(log, directory, scale, TILE_PIXELS, error);
+    emit finished(directory, ok, error);
+}
@@ -0,0 +1,23 @@
+#ifndef EXPORT_WORKER_H
+#define EXPORT_WORKER_H
+
+#include <QObject>
+#include <QString>
+
+// Lives on its own thread and exports straight from the log on disk rather than from what's
+// loaded, so the view carries on as normal and nothing more is kept in memory
+class export_worker: public QObject
+{
+    Q_OBJECT
+public:
+    explicit export_worker(QObject* parent = nullptr);
+public slots:
+    void write_svg(const QString& log, const QString& path);
+
+    // scale is pixels per scene unit, normally whatever the view is zoomed to
+    void write_png(const QString& log, const QString& directory, qreal scale);
+signals:
+    void finished(const QString& target, bool success, const QString& message);
+};
+
+#endif // EXPORT_WORKER_H
@@ -0,0 +1,103 @@
+#include "failure_index.h"
+#include <algorithm>
+
+QString failure_kind_name(FailureKind kind) {
+    switch(kind) {
+    case FailureKind::nonzero_return:
+        return "Non-zero return";
+    case FailureKind::sigsegv:
+        return "SIGSEGV";
+    case FailureKind::sigill:
+        return "SIGILL";
+    case FailureKind::unexpected_panic:
+        return "Unexpected panic";
+    default:
+        return QString();
+    }
+}
+
+void FailureIndex::clear() {
+    *this = FailureIndex();
+}
+
+static void insert_sorted(std::vector<uint32_t>& nodes, uint32_t node) {
+    // Almost always goes on the end, only binaries get flagged after later events
+    if(nodes.empty() || nodes.back() < node) {
+        nodes.push_back(node);
+        return;
+    }
+    auto at = std::lower_bound(nodes.begin(), nodes.end(), node);
+    if(at == nodes.end() || *at != node) {
+        nodes.insert(at, node);
+    }
+}
+
+void FailureIndex::insert(size_t node, FailureKind kind) {
+    auto id = static_cast<uint32_t>(node);
+    insert_sorted(all, id);
+    insert_sorted(by_kind[static_cast<size_t>(kind)], id);
+}
+
+void FailureIndex::add(const EventStore& events, size_t index) {
+    add(events, index, index);
+}
+
+void FailureIndex::add(const EventStore& events, size_t row, size_t node) {
+    auto kind = events.kind(row);
+    if(kind == EventKind::binary) {
+        current_binary = node;
+        binary_should_panic = events.binary(row).should_panic;
+        binary_failed = false;
+        return;
+    } else if(kind != EventKind::trace) {
+        return;
+    }
+    auto ret = events.ret(row);
+    if(ret && *ret != 0) {
+        insert(node, FailureKind::nonzero_return);
+        if(current_binary && !binary_should_panic && !binary_failed) {
+            binary_failed = true;
+            insert(*current_binary, FailureKind::unexpected_panic);
+        }
+    }
+    if(auto sig = events.signal(row)) {
+        if(*sig == Signal::sigsegv) {
+            insert(node, FailureKind::sigsegv);
+        } else if(*sig == Signal::sigill) {
+            insert(node, FailureKind::sigill);
+        }
+    }
+}
+
+size_t FailureIndex::size() const {
+    return all.size();
+}
+
+size_t FailureIndex::count(FailureKind kind) const {
+    return by_kind[static_cast<size_t>(kind)].size();
+}
+
+const std::vector<uint32_t>& FailureIndex::nodes(std::optional<FailureKind> kind) const {
+    if(kind) {
+        return by_kind[static_cast<size_t>(*kind)];
+    }
+    return all;
+}
+
+std::optional<size_t> FailureIndex::next(size_t node, std::optional<FailureKind> kind) const {
+    const auto& list = nodes(kind);
+    auto at = std::lower_bound(list.begin(), list.end(), node);
+    if(at == list.end()) {
+        return std::nullopt;
+    }
+    return *at;
+}
+
+std::optional<size_t> FailureIndex::previous(size_t node, std::optional<FailureKind> kind) const {
+    const auto& list = nodes(kind);
+    auto at = std::lower_bound(list.begin(), list.end(), node);
+    if(at == list.begin()) {
+        return std::nullopt;
+    }
+    return *(at - 1);
+}
@@ -0,0 +1,58 @@
+#ifndef FAILURE_INDEX_H
+#define FAILURE_INDEX_H
+
+#include <QString>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "event_store.h"
+
+enum class FailureKind: uint8_t {
+    nonzero_return,
+    sigsegv,
+    sigill,
+    // A test binary that wasn't meant to panic had a process exit with an error
+    unexpected_panic,
+    _length
+};
+
+QString failure_kind_name(FailureKind kind);
+
+// Every failure in a trace, kept sorted by node index which is also the order they're laid
+// out in, so the next or previous one from anywhere is a binary search. Built up as events
+// are appended.
+class FailureIndex {
+public:
+    static constexpr size_t KINDS = static_cast<size_t>(FailureKind::_length);
+
+    void clear();
+
+    // Events must be added in order
+    void add(const EventStore& events, size_t index);
+
+    // Row in events, node over the whole trace, for when events is only the latest batch
+    void add(const EventStore& events, size_t row, size_t node);
+
+    size_t size() const;
+
+    size_t count(FailureKind kind) const;
+
+    // First failure at or after node, only looking at one kind if given
+    std::optional<size_t> next(size_t node, std::optional<FailureKind> kind = std::nullopt) const;
+
+    // Last failure before node
+    std::optional<size_t> previous(size_t node, std::optional<FailureKind> kind = std::nullopt) const;
+
+    const std::vector<uint32_t>& nodes(std::optional<FailureKind> kind = std::nullopt) const;
+private:
+    void insert(size_t node, FailureKind kind);
+
+    std::vector<uint32_t> all;
+    std::array<std::vector<uint32_t>, KINDS> by_kind;
+    std::optional<size_t> current_binary;
+    bool binary_should_panic = false;
+    bool binary_failed = false;
+};
+
+#endif // FAILURE_INDEX_H
@@ -2,21 +2,24 @@
 #include <QScrollBar>
 #include <QTouchEvent>
 #include <QDebug>
-#include <QGraphicsTextItem>
-#include <QFontMetrics>
+#include <QGraphicsScene>
+#include <QMouseEvent>
+#include <QContextMenuEvent>
+#include <QMenu>
+#include <QPaintEvent>
 #include <QFont>
-#include <set>
-#include <queue>
 #include <map>
+#include <algorithm>
 
-bool node_compare(const std::shared_ptr<Node>& a, const std::shared_ptr<Node>& b) {
-    return a->event_index > b->event_index;
-}
+// Around 500 tiles, a few screens' worth at each of the last few zoom levels
+static constexpr size_t TILE_BUDGET = 128 * 1024 * 1024;
 
 graphics_view::graphics_view(QWidget *parent):
-    QGraphicsView(parent)
+    QGraphicsView(parent),
+    tiles(TILE_BUDGET),
+    tile_source(std::make_unique<tile_renderer>(events, layout))
 {
-
+    connect(tile_source.get(), &tile_renderer::rendered, this, &graphics_view::tile_rendered);
 }
 
 void graphics_view::apply_zoom(qreal amount) {
@@ -35,226 +38,269 @@ void graphics_view::reset() {
 }
 
 void graphics_view::layout_scene() {
-    using node_queue = std::priority_queue<std::shared_ptr<Node>, std::vector<std::shared_ptr<Node>>, decltype(&node_compare)>;
-    if(nodes.empty()) {
+    if(laid_out == events.size()) {
         return;
     }
-    QGraphicsScene* s = scene();
-    std::map<int, qreal> pid_heights;
-    qreal MARGIN = 10.0;
-    qreal xpos = MARGIN;
-    std::vector<qreal> x_gridlines;
-    node_queue queue(node_compare);
-    queue.push(nodes.front());
-    int last_index = -1;
-    qreal lane_height = MARGIN*2.0 + 50.0;
-    for(const auto& node: nodes) {
-        qreal candidate = node->view->boundingRect().height() + MARGIN*2.0;
-        if(candidate > lane_height) {
-            lane_height = candidate;
+    // Labels are measured first so their time shows up apart from the layout's
+    {
+        PhaseTimer timer(phases, "labels");
+        timer.add(static_cast<qint64>(events.size() - laid_out));
+        label_sizes.clear();
+        for(auto node=laid_out; node<events.size(); node++) {
+            label_sizes.push_back(labels.size(events, node));
         }
     }
-    qDebug()<<"Lane height: "<<lane_height;
-    auto meta_y = 3.0*MARGIN+lane_height;
-    std::vector<qreal> x_positions;
-    while(!queue.empty()) {
-        x_positions.push_back(xpos);
-        std::shared_ptr<Node> node = queue.top();
-        event_indexes[node->view] = node->event_index;
-        queue.pop();
-        auto pid_opt = get_pid(node->event);
-        if(node->event_index != last_index + 1) {
-            qDebug()<<"Index assumption has broken! "<<node->event_index<<":"<<last_index+1;
-            break;
-        }
-
-        auto rect = node->view->boundingRect();
-        auto brush = QBrush(node->colour);
-        if(auto trace = std::get_if<TraceEvent>(node->event.get())) {
-            if(!pid_opt) {
-                node->view->setX(xpos);
-                x_gridlines.push_back(xpos + rect.width()/2.0);
-                node->view->setY(meta_y);
-            } else {
-                auto pid = pid_opt.value();
-                if(pid_heights.find(pid) == pid_heights.end()) {
-                    // Work out height and insert
-                    pid_heights[pid] = pid_heights.size() * -lane_height;
-                }
-                auto ypos = pid_heights[pid];
-                node->view->setY(ypos);
-                node->view->setX(xpos);
-                auto rect = s->addRect(node->view->sceneBoundingRect(), QPen(), brush);
-                if(trace->is_bad()) {
-                    rect->setBrush(QColor(255, 0, 0, 90));
-                    bad_nodes.push_back(node);
-                }
-                // EDGES
-                if(auto parent = node->parent.lock()) {
-
-                    auto left_connector = node->view->sceneBoundingRect().topLeft();
-                    auto parent_rect = parent->view->sceneBoundingRect();
-                    auto right_connector = parent_rect.topRight();
-                    s->addLine({left_connector, right_connector});
-                }
-            }
+    PhaseTimer timer(phases, "layout");
+    timer.add(static_cast<qint64>(events.size() - laid_out));
+    auto first = laid_out;
+    for(; laid_out<events.size(); laid_out++) {
+        auto node = laid_out;
+        auto size = label_sizes[node - first];
+        auto pid = events.pid(node);
+        failures.add(events, node);
+        if(events.kind(node) == EventKind::trace && pid) {
+            layout.add(size.width(), size.height(), pid, parents[node], events.is_bad(node));
         } else {
-            node->view->setX(xpos);
-            x_gridlines.push_back(xpos + rect.width()/2.0);
-            node->view->setY(meta_y);
-        }
-        xpos += rect.width() + MARGIN;
-        last_index = node->event_index;
-        for(const auto& child: node->children) {
-            if(auto node = child.lock()) {
-                queue.push(node);
-            }
+            layout.add(size.width(), size.height(), std::nullopt, TimelineLayout::NO_EDGE, false);
         }
     }
+    timeline->layout_changed();
+    // Lanes move down as they get taller
+    highlight_selected();
+}
 
-    for(size_t index: markers) {
-        auto x = x_positions[index] - MARGIN/2.0;
-        auto parent_rect = s->sceneRect();
-        auto top_connector = parent_rect.topRight();
-        top_connector.setX(x);
-        auto bottom_connector = parent_rect.bottomRight();
-        bottom_connector.setX(top_connector.x());
+bool graphics_view::showing_end() const {
+    auto visible = mapToScene(viewport()->rect()).boundingRect();
+    return visible.right() >= layout.bounds().right();
+}
 
-        QPen marker_pen;
-        marker_pen.setStyle(Qt::DashLine);
-        marker_pen.setColor(QColor(0, 0, 0, 200));
+void graphics_view::scroll_to_end() {
+    auto visible = mapToScene(viewport()->rect()).boundingRect();
+    centerOn(layout.bounds().right() - visible.width() / 2.0, visible.center().y());
+}
 
-        s->addLine({top_connector, bottom_connector}, marker_pen);
+void graphics_view::begin_scene() {
+    stop_tiles();
+    tiles_wanted = false;
+    QGraphicsScene* s = scene();
+    s->clear();
+    selected_node = std::nullopt;
+    events.clear();
+    parents.clear();
+    first_children.clear();
+    last_children.clear();
+    next_siblings.clear();
+    failures.clear();
+    search_results.reset();
+    diff.reset();
+    live_processes.clear();
+    laid_out = 0;
+    layout.clear();
+    labels.set_font(render_font);
+    labels.forget_strings();
+    timeline = new timeline_item(events, layout, labels);
+    timeline->set_tiles(&tiles, tile_source.get());
+    s->addItem(timeline);
+    selection_outline = s->addRect(QRectF(), QPen(Qt::red));
+    selection_outline->setZValue(1);
+    selection_outline->hide();
+}
+
+void graphics_view::start_tiles() {
+    tile_source->start(labels.font(), viewport()->devicePixelRatioF());
+}
+
+void graphics_view::stop_tiles() {
+    // Rendering threads read the layout so they have to be stopped before it changes
+    tile_source->stop();
+    tiles.clear();
+}
+
+void graphics_view::tile_rendered(TileKey key, QImage image, int version) {
+    if(version != tile_source->version() || !timeline) {
+        return;
     }
+    tiles.insert(key, std::move(image));
+    timeline->update(key.rect());
+}
 
-    update();
+void graphics_view::link_node(size_t node, size_t parent) {
+    parents[node] = static_cast<uint32_t>(parent);
+    if(first_children[parent] == NO_NODE) {
+        first_children[parent] = static_cast<uint32_t>(node);
+    } else {
+        next_siblings[last_children[parent]] = static_cast<uint32_t>(node);
+    }
+    last_children[parent] = static_cast<uint32_t>(node);
 }
 
-void graphics_view::create_scene(const std::vector<std::shared_ptr<Event>>& events) {
-    QGraphicsScene* s = scene();
-    s->clear();
-    markers.clear();
-    nodes.clear();
-    event_indexes.clear();
-    QFontMetrics fm(render_font);
-    std::set<uint64_t> pid_set;
-    pid_set.insert(0);
-    size_t index = 0;
-    for(const auto& event: events) {
-        if(!event) {
+void graphics_view::append_events(const EventStore& batch) {
+    if(tile_source->running()) {
+        stop_tiles();
+    }
+    {
+        PhaseTimer timer(phases, "link");
+        timer.add(static_cast<qint64>(batch.size()));
+        link_events(batch);
+    }
+    layout_scene();
+}
+
+void graphics_view::link_events(const EventStore& batch) {
+    const auto& string_map = events.adopt_strings(batch);
+    // Batches from a snapshot were linked when it was written
+    auto linked = batch.has_parents();
+    for(size_t row=0; row<batch.size(); row++) {
+        auto index = events.size();
+        if(batch.kind(row) == EventKind::marker) {
+            layout.add_marker(index);
             continue;
         }
-        auto colour = get_node_colour(event);
-        if (is_marker(event)) {
-            markers.insert(index);
-            continue;
-        } else if(auto conf = std::get_if<Config>(event.get())) {
-            auto text_box = s->addText(conf->name, render_font);
-            text_box->setZValue(1);
-            auto node = std::make_shared<Node>(index, text_box, event);
-            node->colour = colour;
-            if(!nodes.empty()) {
-                node->parent = nodes.back();
-                nodes.back()->children.push_back(node);
-            }
-            nodes.push_back(node);
-        } else if(auto bin = std::get_if<TestBinary>(event.get())) {
-            auto text_box = s->addText(bin->path, render_font);
-            text_box->setZValue(1);
-            auto node = std::make_shared<Node>(index, text_box, event);
-            node->colour = colour;
-            if(!nodes.empty()) {
-                node->parent = nodes.back();
-                nodes.back()->children.push_back(node);
-            }
-            nodes.push_back(node);
-        } else if(auto trace = std::get_if<TraceEvent>(event.get())) {
-            auto contents = trace->to_string();
-            auto text_box = s->addText(contents, render_font);
-            text_box->setZValue(1);
-            auto node = std::make_shared<Node>(index, text_box, event);
-            node->colour = colour;
-            pid_set.insert(trace->pid.value_or(0));
-            for(auto it=nodes.rbegin(); it!=nodes.rend(); ++it) {
-                auto pid = get_pid((*it)->event);
-                auto child = get_child((*it)->event);
-                // So this trace is either a child of another trace or a continuation of a running thread
-                // Assuming each trace can only have one parent but can have multiple children - might be incorrect for tests that use wait syscall
-                if(!is_end_node((*it)->event) && ((pid && trace->pid == pid) || (child && trace->pid == child) )) {
-                    (*it)->children.push_back(node);
-                    node->parent = *it;
-                    break;
-                }
-            }
-            if(!nodes.empty() && !node->parent.lock()) {
-                node->parent = nodes.back();
-                nodes.back()->children.push_back(node);
-            }
-            nodes.push_back(node);
-        } else {
-            qDebug()<<"Unexpected event type";
+        events.append(batch, row, string_map);
+        parents.push_back(NO_NODE);
+        first_children.push_back(NO_NODE);
+        last_children.push_back(NO_NODE);
+        next_siblings.push_back(NO_NODE);
+        auto parent = linked ? batch.parent(row) : live_processes.add(events, index);
+        if(parent != ProcessIndex::NO_PARENT) {
+            link_node(index, parent);
+        }
+        if(index > 0 && parents[index] == NO_NODE) {
+            link_node(index, index - 1);
         }
-        pid_count = pid_set.size();
-        index += 1;
     }
-    layout_scene();
+}
+
+void graphics_view::reroot_files(const QDir& root) {
+    // Boxes keep the width they were measured at, the shorter paths still fit
+    if(tile_source->running()) {
+        stop_tiles();
+    }
+    events.reroot_files(root);
+    labels.forget_strings();
+    if(timeline) {
+        timeline->update();
+    }
+}
+
+void graphics_view::finish_scene() {
+    {
+        PhaseTimer timer(phases, "finish");
+        layout.finish();
+        timeline->layout_changed();
+    }
+    // Nothing moves from here on unless lanes change so it's worth keeping what's drawn
+    tiles_wanted = true;
+    start_tiles();
+    if(phases) {
+        phases->counter("nodes", static_cast<qint64>(laid_out));
+        phases->counter("lanes", static_cast<qint64>(layout.lane_count()));
+        phases->counter("failures", static_cast<qint64>(failures.size()));
+    }
+}
+
+void graphics_view::create_scene(const EventStore& events) {
+    begin_scene();
+    append_events(events);
+    finish_scene();
 }
 
 void graphics_view::deselect() {
-    if(selected_node && !nodes.empty()) {
-        auto value = selected_node.value();
-        auto centre = nodes[value]->view->sceneBoundingRect().center().toPoint();
-        auto old_items = items(mapFromScene(centre));
-        for(auto& item: old_items) {
-            // This is the outline... Change the color ideallly
-            QGraphicsRectItem* rect = qgraphicsitem_cast<QGraphicsRectItem*>(item);
-            if(rect) {
-                rect->setPen(QPen(Qt::black));
-            }
-        }
+    if(selection_outline) {
+        selection_outline->hide();
     }
     selected_node = std::nullopt;
 }
 
 void graphics_view::highlight_selected() {
-    if(selected_node && !nodes.empty()) {
-        auto value = selected_node.value();
-        auto centre = nodes[value]->view->sceneBoundingRect().center().toPoint();
-        auto old_items = items(mapFromScene(centre));
-        for(auto& item: old_items) {
-            // This is the outline... Change the color ideallly
-            QGraphicsRectItem* rect = qgraphicsitem_cast<QGraphicsRectItem*>(item);
-            if(rect) {
-                rect->setPen(QPen(Qt::red));
-            }
-        }
+    // Nodes without an outline don't get highlighted
+    if(selected_node && selection_outline && layout.lane(*selected_node) != TimelineLayout::NO_LANE && layout.node_visible(*selected_node)) {
+        selection_outline->setRect(layout.rect(*selected_node));
+        selection_outline->show();
     }
 }
 
 void graphics_view::mousePressEvent(QMouseEvent *event) {
-    auto graphics_items = items(event->pos());
     deselect();
-    for(auto& item: graphics_items) {
-        if(event_indexes.find(item) != event_indexes.end()) {
-            selected_node = event_indexes[item];
+    selected_node = layout.node_at(mapToScene(event->pos()));
+    highlight_selected();
+    emit_selected();
+}
+
+void graphics_view::paintEvent(QPaintEvent *event) {
+    // Moved to a screen with a different pixel ratio, the tiles so far would come out blurry
+    if(tile_source->running() && tile_source->pixel_ratio() != viewport()->devicePixelRatioF()) {
+        stop_tiles();
+        start_tiles();
+    }
+    QGraphicsView::paintEvent(event);
+}
+
+void graphics_view::contextMenuEvent(QContextMenuEvent *event) {
+    auto lane = layout.lane_at(mapToScene(event->pos()).y());
+    QMenu menu(this);
+    if(lane) {
+        auto l = *lane;
+        auto pid = QString::number(layout.lane_pid(l));
+        auto set_mode = [this, l](LaneMode mode, bool subtree) {
+            stop_tiles();
+            layout.set_lane_mode(l, mode, subtree);
+            lanes_changed();
+        };
+        if(layout.lane_mode(l) == LaneMode::collapsed) {
+            menu.addAction(QString("Expand pid %1").arg(pid), this, [=]() { set_mode(LaneMode::shown, false); });
+            menu.addAction(QString("Expand pid %1 and its children").arg(pid), this, [=]() { set_mode(LaneMode::shown, true); });
         } else {
-            // This is the outline... Change the color ideallly
-            QGraphicsRectItem* rect = qgraphicsitem_cast<QGraphicsRectItem*>(item);
-            if(rect) {
-                rect->setPen(QPen(Qt::red));
-            }
+            menu.addAction(QString("Collapse pid %1").arg(pid), this, [=]() { set_mode(LaneMode::collapsed, false); });
+            menu.addAction(QString("Collapse pid %1 and its children").arg(pid), this, [=]() { set_mode(LaneMode::collapsed, true); });
         }
+        menu.addAction(QString("Hide pid %1").arg(pid), this, [=]() { set_mode(LaneMode::hidden, false); });
+        menu.addAction(QString("Hide pid %1 and its children").arg(pid), this, [=]() { set_mode(LaneMode::hidden, true); });
+        menu.addAction(QString("Solo pid %1").arg(pid), this, [this, l]() {
+            stop_tiles();
+            layout.solo(l, false);
+            lanes_changed();
+        });
+        menu.addAction(QString("Solo pid %1 and its children").arg(pid), this, [this, l]() {
+            stop_tiles();
+            layout.solo(l, true);
+            lanes_changed();
+        });
+        menu.addSeparator();
+    }
+    menu.addAction("Show all lanes", this, [this]() {
+        stop_tiles();
+        layout.show_all();
+        lanes_changed();
+    });
+    menu.exec(event->globalPos());
+}
+
+void graphics_view::lanes_changed() {
+    if(tiles_wanted) {
+        start_tiles();
     }
+    timeline->layout_changed();
+    // Rows move so the scene has to be repainted rather than just what's changed size
+    timeline->update();
+    if(selected_node && !layout.node_visible(*selected_node)) {
+        deselect();
+    }
+    highlight_selected();
 }
 
 // Todo be less lazy with move_left move_right
 
 void graphics_view::move_left() {
     if(auto index = selected_node) {
-        if(*index > 0 && !nodes.empty()) {
+        auto node = *index;
+        while(node > 0 && !layout.node_visible(node - 1)) {
+            node--;
+        }
+        if(node > 0 && laid_out > 0) {
             deselect();
-            selected_node = *index - 1;
-            centerOn(nodes[*index-1]->view);
+            selected_node = node - 1;
+            centerOn(layout.rect(node - 1).center());
             highlight_selected();
         }
     } else {
@@ -265,10 +311,14 @@ void graphics_view::move_left() {
 
 void graphics_view::move_right() {
     if(auto index = selected_node) {
-        if(*index + 1 < nodes.size()) {
+        auto node = *index + 1;
+        while(node < laid_out && !layout.node_visible(node)) {
+            node++;
+        }
+        if(node < laid_out) {
             deselect();
-            selected_node = *index + 1;
-            centerOn(nodes[*index+1]->view);
+            selected_node = node;
+            centerOn(layout.rect(node).center());
             highlight_selected();
         }
     } else {
@@ -279,13 +329,17 @@ void graphics_view::move_right() {
 
 void graphics_view::move_pid_left() {
     if(auto index = selected_node) {
-        auto node = nodes[*index];
+        auto node = *index;
         deselect();
-        if(auto parent = node->parent.lock()) {
-            selected_node = parent->event_index;
+        auto parent = parents[node];
+        while(parent != NO_NODE && !layout.node_visible(parent)) {
+            parent = parents[parent];
+        }
+        if(parent != NO_NODE) {
+            selected_node = parent;
         }
         if(auto index = selected_node) {
-            centerOn(nodes[*index]->view);
+            centerOn(layout.rect(*index).center());
         }
         highlight_selected();
         update();
@@ -294,28 +348,29 @@ void graphics_view::move_pid_left() {
 
 void graphics_view::move_pid_right() {
     if(auto index = selected_node) {
-        auto node = nodes[*index];
+        auto node = *index;
         deselect();
-        auto pid = get_pid(node->event);
+        auto pid = events.pid(node);
         std::optional<size_t> new_index = std::nullopt;
-        for(const auto& child_ref: node->children) {
-            if(auto child = child_ref.lock()) {
-                auto child_pid = get_pid(node->event);
-                if(child_pid == pid) {
-                    new_index = child->event_index;
-                    break;
-                } else if(auto current = new_index) {
-                    if(child->event_index < *current) {
-                        new_index = child->event_index;
-                    }
-                } else {
-                    new_index = child->event_index;
+        for(auto child=first_children[node]; child!=NO_NODE; child=next_siblings[child]) {
+            if(!layout.node_visible(child)) {
+                continue;
+            }
+            auto child_pid = events.pid(child);
+            if(child_pid == pid) {
+                new_index = child;
+                break;
+            } else if(auto current = new_index) {
+                if(child < *current) {
+                    new_index = child;
                 }
+            } else {
+                new_index = child;
             }
         }
         selected_node = new_index;
         if(auto index = selected_node) {
-            centerOn(nodes[*index]->view);
+            centerOn(layout.rect(*index).center());
         }
         highlight_selected();
         update();
@@ -323,27 +378,149 @@ void graphics_view::move_pid_right() {
 }
 
 
+void graphics_view::select_node(size_t node) {
+    deselect();
+    selected_node = node;
+    centerOn(layout.rect(node).center());
+    highlight_selected();
+}
+
 void graphics_view::next_failure() {
-    std::shared_ptr<Node> first;
-    qDebug()<<"Bad nodes "<<bad_nodes.size();
-    for(int i=0; i<bad_nodes.size(); i++) {
-        if(auto node = bad_nodes[i].lock()) {
-            if(!first) {
-                first = node;
-            }
-            // Check if x positon is beyond the current view if so jump to it
-            auto current_centre = mapToScene(rect().center());
-            auto node_pos = node->view->scenePos();
-            if(node_pos.x() > current_centre.x()) {
-
-                deselect();
-                selected_node = node->event_index;
-                centerOn(node->view);
-                highlight_selected();
-            }
-        } else {
-            bad_nodes.erase(bad_nodes.begin() + i);
-            i--;
+    // Go from the selection if there is one otherwise from the middle of the view
+    std::optional<size_t> node;
+    if(selected_node) {
+        node = failures.next(*selected_node + 1, failure_filter);
+    } else {
+        node = failures.next(layout.node_from(mapToScene(rect().center()).x()), failure_filter);
+    }
+    while(node && *node < laid_out && !layout.node_visible(*node)) {
+        node = failures.next(*node + 1, failure_filter);
+    }
+    if(node && *node < laid_out) {
+        select_node(*node);
+    }
+}
+
+void graphics_view::previous_failure() {
+    std::optional<size_t> node;
+    if(selected_node) {
+        node = failures.previous(*selected_node, failure_filter);
+    } else {
+        node = failures.previous(layout.node_from(mapToScene(rect().center()).x()), failure_filter);
+    }
+    while(node && !layout.node_visible(*node)) {
+        node = failures.previous(*node, failure_filter);
+    }
+    if(node) {
+        select_node(*node);
+    }
+}
+
+void graphics_view::first_match() {
+    if(!search_results) {
+        return;
+    }
+    for(auto node: *search_results) {
+        if(node >= laid_out) {
+            break;
+        }
+        if(layout.node_visible(node)) {
+            select_node(node);
+            return;
+        }
+    }
+}
+
+void graphics_view::next_match() {
+    if(search_results) {
+        next_in(*search_results);
+    }
+}
+
+void graphics_view::previous_match() {
+    if(search_results) {
+        previous_in(*search_results);
+    }
+}
+
+void graphics_view::next_difference() {
+    if(auto side = diff_side()) {
+        next_in(side->differences);
+        emit_selected();
+    }
+}
+
+void graphics_view::previous_difference() {
+    if(auto side = diff_side()) {
+        previous_in(side->differences);
+        emit_selected();
+    }
+}
+
+void graphics_view::next_in(const std::vector<uint32_t>& nodes) {
+    auto from = selected_node ? *selected_node + 1 : layout.node_from(mapToScene(rect().center()).x());
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), from);
+    while(it != nodes.end() && *it < laid_out && !layout.node_visible(*it)) {
+        ++it;
+    }
+    if(it != nodes.end() && *it < laid_out) {
+        select_node(*it);
+    }
+}
+
+void graphics_view::previous_in(const std::vector<uint32_t>& nodes) {
+    auto from = selected_node ? *selected_node : layout.node_from(mapToScene(rect().center()).x());
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), std::min(from, laid_out));
+    while(it != nodes.begin()) {
+        --it;
+        if(layout.node_visible(*it)) {
+            select_node(*it);
+            return;
         }
     }
 }
+
+void graphics_view::emit_selected() {
+    emit node_selected(selected_node ? static_cast<qint64>(*selected_node) : -1);
+}
+
+void graphics_view::show_node(size_t node) {
+    if(node < laid_out) {
+        select_node(node);
+    }
+}
+
+void graphics_view::set_diff(std::shared_ptr<const TraceDiff> result, bool right, QColor only_here) {
+    diff = std::move(result);
+    diff_right = right;
+    if(timeline) {
+        timeline->set_diff(diff_side(), only_here);
+    }
+}
+
+const DiffSide* graphics_view::diff_side() const {
+    if(!diff) {
+        return nullptr;
+    }
+    return diff_right ? &diff->right : &diff->left;
+}
+
+void graphics_view::set_search_results(std::shared_ptr<const std::vector<uint32_t>> nodes) {
+    search_results = std::move(nodes);
+}
+
+void graphics_view::set_failure_filter(std::optional<FailureKind> kind) {
+    failure_filter = kind;
+}
+
+void graphics_view::set_phase_log(PhaseLog* log) {
+    phases = log;
+}
+
+const FailureIndex& graphics_view::failure_index() const {
+    return failures;
+}
+
+const TimelineLayout& graphics_view::timeline_layout() const {
+    return layout;
+}
@@ -2,28 +2,26 @@
 #define GRAPHICS_VIEW_H
 
 #include <QGraphicsView>
+#include <QGraphicsItem>
 #include <QFont>
-#include <set>
+#include <map>
 #include <memory>
 #include <vector>
-#include "types.h"
+#include "event_store.h"
+#include "failure_index.h"
+#include "label_cache.h"
+#include "phase_log.h"
+#include "process_index.h"
+#include "tile_cache.h"
+#include "tile_renderer.h"
+#include "timeline_item.h"
+#include "timeline_layout.h"
+#include "trace_diff.h"
 #include <optional>
 
 
-struct Node {
-    Node(size_t index, QGraphicsItem* item, std::shared_ptr<Event> event):
-        event_index(index),
-        view(item),
-        event(event)
-    {
-    }
-    size_t event_index;
-    QGraphicsItem* view;
-    std::shared_ptr<Event> event;
-    std::vector<std::weak_ptr<Node>> children;
-    std::weak_ptr<Node> parent;
-    QColor colour;
-};
+// Marks a missing parent, child or sibling in the node link columns
+constexpr uint32_t NO_NODE = UINT32_MAX;
 
 class graphics_view: public QGraphicsView
 {
@@ -35,9 +33,50 @@ public:
 
     void pan(qreal dx, qreal dy);
 
-    void create_scene(const std::vector<std::shared_ptr<Event>>& events);
+    void create_scene(const EventStore& events);
+
+    // Scenes can also be built up a batch at a time while a log is still loading
+    void begin_scene();
+
+    void append_events(const EventStore& batch);
+
+    void finish_scene();
 
     void layout_scene();
+
+    // Paths so far were as the log had them, see trace_loader::root_found
+    void reroot_files(const QDir& root);
+
+    // Whether the right end of the timeline is in view
+    bool showing_end() const;
+
+    void scroll_to_end();
+
+    const FailureIndex& failure_index() const;
+
+    const TimelineLayout& timeline_layout() const;
+
+    // Failure jumps only stop at this kind, or any failure if it's empty
+    void set_failure_filter(std::optional<FailureKind> kind);
+
+    // Nodes next_match and previous_match go between, in order
+    void set_search_results(std::shared_ptr<const std::vector<uint32_t>> nodes);
+
+    // Linking and layout are timed into log if it's set
+    void set_phase_log(PhaseLog* log);
+
+    // Marks what differs from another run, this view showing the right or the left side.
+    // Nodes only in this run are marked in only_here. A null diff stops marking.
+    void set_diff(std::shared_ptr<const TraceDiff> result, bool right, QColor only_here);
+
+    // Side of the diff this view shows, null when not comparing
+    const DiffSide* diff_side() const;
+
+    // Selects and centres on a node if it's been laid out
+    void show_node(size_t node);
+signals:
+    // Selection changed by the user, -1 when nothing is selected
+    void node_selected(qint64 node);
 public slots:
     void reset();
 
@@ -52,18 +91,65 @@ public slots:
     void deselect();
 
     void next_failure();
+
+    void previous_failure();
+
+    void first_match();
+
+    void next_match();
+
+    void previous_match();
+
+    void next_difference();
+
+    void previous_difference();
 protected:
     void highlight_selected();
+    void select_node(size_t node);
+    void link_node(size_t node, size_t parent);
+    void link_events(const EventStore& batch);
     void mousePressEvent(QMouseEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    // After lanes are hidden, collapsed or shown
+    void lanes_changed();
+    void next_in(const std::vector<uint32_t>& nodes);
+    void previous_in(const std::vector<uint32_t>& nodes);
+    void emit_selected();
+    void start_tiles();
+    void stop_tiles();
+    void tile_rendered(TileKey key, QImage image, int version);
 
 
     std::optional<size_t> selected_node;
-    size_t pid_count = 0;
-    std::vector<std::shared_ptr<Node>> nodes;
-    std::set<size_t> markers;
-    std::map<QGraphicsItem*, size_t> event_indexes;
+    // One row per node, markers aren't nodes so they only go in the layout
+    EventStore events;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> first_children;
+    std::vector<uint32_t> last_children;
+    std::vector<uint32_t> next_siblings;
+    ProcessIndex live_processes;
     QFont render_font;
-    std::vector<std::weak_ptr<Node>> bad_nodes;
+    LabelCache labels;
+    FailureIndex failures;
+    std::optional<FailureKind> failure_filter;
+    std::shared_ptr<const std::vector<uint32_t>> search_results;
+    std::shared_ptr<const TraceDiff> diff;
+    bool diff_right = false;
+
+    // Layout state is kept between batches so new events only extend the timeline
+    TimelineLayout layout;
+    timeline_item* timeline = nullptr;
+    // Moved to whichever node is selected rather than recolouring anything
+    QGraphicsRectItem* selection_outline = nullptr;
+    size_t laid_out = 0;
+    std::vector<QSizeF> label_sizes;
+    PhaseLog* phases = nullptr;
+    // Declared after everything the renderer reads so it's destroyed first
+    TileCache tiles;
+    std::unique_ptr<tile_renderer> tile_source;
+    // Set once a scene is finished, tiles go back to being drawn after lanes change
+    bool tiles_wanted = false;
 };
 
 #endif // GRAPHICS_VIEW_H
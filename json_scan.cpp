@@ -0,0 +1,302 @@
+#include "json_scan.h"
+#include <cstring>
+#include <cstdlib>
+#include <string>
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static bool is_delimiter(char c) {
+    return is_space(c) || c == ',' || c == ']' || c == '}';
+}
+
+const char* skip_whitespace(const char* p, const char* end) {
+    while(p != end && is_space(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+const char* skip_string(const char* p, const char* end) {
+    ++p;
+    while(p < end) {
+        auto quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+        if(!quote) {
+            return nullptr;
+        }
+        // An odd number of backslashes before the quote means it's escaped
+        size_t slashes = 0;
+        for(auto back = quote - 1; back >= p && *back == '\\'; --back) {
+            slashes++;
+        }
+        if(slashes % 2 == 0) {
+            return quote + 1;
+        }
+        p = quote + 1;
+    }
+    return nullptr;
+}
+
+Scan scan_value(const char*& p, const char* end) {
+    auto c = skip_whitespace(p, end);
+    if(c == end) {
+        return Scan::partial;
+    }
+    if(*c == '"') {
+        auto e = skip_string(c, end);
+        if(!e) {
+            return Scan::partial;
+        }
+        p = e;
+        return Scan::ok;
+    } else if(*c != '{' && *c != '[') {
+        if(!std::strchr("-0123456789tfn", *c)) {
+            return Scan::invalid;
+        }
+        while(c != end && !is_delimiter(*c)) {
+            ++c;
+        }
+        // A number could carry on into the next block of input
+        if(c == end) {
+            return Scan::partial;
+        }
+        p = c;
+        return Scan::ok;
+    }
+    int depth = 0;
+    while(c != end) {
+        switch(*c) {
+        case '"': {
+            auto e = skip_string(c, end);
+            if(!e) {
+                return Scan::partial;
+            }
+            c = e;
+            continue;
+        }
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case '}':
+        case ']':
+            depth--;
+            if(depth == 0) {
+                p = c + 1;
+                return Scan::ok;
+            }
+            break;
+        default:
+            break;
+        }
+        ++c;
+    }
+    return Scan::partial;
+}
+
+const char* skip_value(const char* p, const char* end) {
+    if(scan_value(p, end) == Scan::ok) {
+        return p;
+    }
+    // Scalars at the very end of the range are complete as far as the caller is concerned
+    auto c = skip_whitespace(p, end);
+    if(c != end && *c != '"' && *c != '{' && *c != '[' && std::strchr("-0123456789tfn", *c)) {
+        return end;
+    }
+    return nullptr;
+}
+
+static int hex_value(char c) {
+    if(c >= '0' && c <= '9') {
+        return c - '0';
+    } else if(c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if(c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static const char* parse_hex4(const char* p, const char* end, uint32_t& out) {
+    if(end - p < 4) {
+        return nullptr;
+    }
+    out = 0;
+    for(int i=0; i<4; i++) {
+        auto v = hex_value(p[i]);
+        if(v < 0) {
+            return nullptr;
+        }
+        out = (out << 4) | static_cast<uint32_t>(v);
+    }
+    return p + 4;
+}
+
+static void append_utf8(QByteArray& out, uint32_t cp) {
+    if(cp < 0x80) {
+        out.append(static_cast<char>(cp));
+    } else if(cp < 0x800) {
+        out.append(static_cast<char>(0xC0 | (cp >> 6)));
+        out.append(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if(cp < 0x10000) {
+        out.append(static_cast<char>(0xE0 | (cp >> 12)));
+        out.append(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.append(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.append(static_cast<char>(0xF0 | (cp >> 18)));
+        out.append(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.append(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.append(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+const char* parse_string(const char* p, const char* end, QByteArray& out) {
+    out.clear();
+    p = skip_whitespace(p, end);
+    if(p == end || *p != '"') {
+        return nullptr;
+    }
+    auto close = skip_string(p, end);
+    if(!close) {
+        return nullptr;
+    }
+    auto begin = p + 1;
+    auto stop = close - 1;
+    if(!std::memchr(begin, '\\', stop - begin)) {
+        out.append(begin, static_cast<int>(stop - begin));
+        return close;
+    }
+    out.reserve(static_cast<int>(stop - begin));
+    for(auto c = begin; c < stop; ++c) {
+        if(*c != '\\') {
+            out.append(*c);
+            continue;
+        }
+        if(++c == stop) {
+            return nullptr;
+        }
+        switch(*c) {
+        case '"': out.append('"'); break;
+        case '\\': out.append('\\'); break;
+        case '/': out.append('/'); break;
+        case 'b': out.append('\b'); break;
+        case 'f': out.append('\f'); break;
+        case 'n': out.append('\n'); break;
+        case 'r': out.append('\r'); break;
+        case 't': out.append('\t'); break;
+        case 'u': {
+            uint32_t cp = 0;
+            auto next = parse_hex4(c + 1, stop, cp);
+            if(!next) {
+                return nullptr;
+            }
+            c = next - 1;
+            if(cp >= 0xD800 && cp < 0xDC00 && stop - next >= 6 && next[0] == '\\' && next[1] == 'u') {
+                uint32_t low = 0;
+                auto after = parse_hex4(next + 2, stop, low);
+                if(after && low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    c = after - 1;
+                }
+            }
+            append_utf8(out, cp);
+            break;
+        }
+        default:
+            return nullptr;
+        }
+    }
+    return close;
+}
+
+const char* parse_string_view(const char* p, const char* end, std::string_view& out, QByteArray& scratch) {
+    p = skip_whitespace(p, end);
+    if(p == end || *p != '"') {
+        return nullptr;
+    }
+    auto close = skip_string(p, end);
+    if(!close) {
+        return nullptr;
+    }
+    auto begin = p + 1;
+    auto stop = close - 1;
+    if(!std::memchr(begin, '\\', stop - begin)) {
+        out = std::string_view(begin, stop - begin);
+        return close;
+    }
+    if(!parse_string(p, end, scratch)) {
+        return nullptr;
+    }
+    out = std::string_view(scratch.constData(), scratch.size());
+    return close;
+}
+
+const char* parse_int(const char* p, const char* end, int64_t& out) {
+    p = skip_whitespace(p, end);
+    bool negative = false;
+    if(p != end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    uint64_t value = 0;
+    auto start = p;
+    while(p != end && *p >= '0' && *p <= '9') {
+        value = value * 10 + static_cast<uint64_t>(*p - '0');
+        ++p;
+    }
+    if(p == start) {
+        return nullptr;
+    }
+    if(p != end && (*p == '.' || *p == 'e' || *p == 'E')) {
+        // Rare enough to not bother doing it by hand
+        auto number_end = p;
+        while(number_end != end && !is_delimiter(*number_end)) {
+            ++number_end;
+        }
+        std::string text(start - (negative ? 1 : 0), number_end);
+        out = static_cast<int64_t>(std::strtod(text.c_str(), nullptr));
+        return number_end;
+    }
+    out = negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+    return p;
+}
+
+const char* parse_uint(const char* p, const char* end, uint64_t& out) {
+    int64_t value = 0;
+    p = skip_whitespace(p, end);
+    if(p != end && *p != '-') {
+        // Go direct so we don't lose the top bit on big addresses
+        uint64_t result = 0;
+        auto start = p;
+        while(p != end && *p >= '0' && *p <= '9') {
+            result = result * 10 + static_cast<uint64_t>(*p - '0');
+            ++p;
+        }
+        if(p != start && (p == end || is_delimiter(*p))) {
+            out = result;
+            return p;
+        }
+        p = start;
+    }
+    p = parse_int(p, end, value);
+    out = static_cast<uint64_t>(value);
+    return p;
+}
+
+const char* parse_bool(const char* p, const char* end, bool& out) {
+    p = skip_whitespace(p, end);
+    if(end - p >= 4 && std::memcmp(p, "true", 4) == 0) {
+        out = true;
+        return p + 4;
+    } else if(end - p >= 5 && std::memcmp(p, "false", 5) == 0) {
+        out = false;
+        return p + 5;
+    }
+    return nullptr;
+}
+
+bool is_null(const char* p, const char* end) {
+    p = skip_whitespace(p, end);
+    return end - p >= 4 && std::memcmp(p, "null", 4) == 0;
+}
@@ -0,0 +1,111 @@
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <QByteArray>
+#include <cstdint>
+#include <string_view>
+
+// Small pull-style helpers for walking UTF-8 JSON held in a [p, end) byte range without
+// building a DOM. Functions take the current position and return the position just past
+// whatever they consumed, or nullptr if the input is malformed or ends too early.
+
+enum class Scan {
+    ok,
+    partial,
+    invalid
+};
+
+const char* skip_whitespace(const char* p, const char* end);
+
+// p must point at the opening quote
+const char* skip_string(const char* p, const char* end);
+
+// Finds the end of the next value, on success p is moved past it. Returns partial if the
+// range ends before the value does so streaming readers know to fetch more input.
+Scan scan_value(const char*& p, const char* end);
+
+const char* skip_value(const char* p, const char* end);
+
+const char* parse_string(const char* p, const char* end, QByteArray& out);
+
+// Like parse_string but out points straight into the input unless the string has escapes,
+// then it's unescaped into scratch and out points there instead
+const char* parse_string_view(const char* p, const char* end, std::string_view& out, QByteArray& scratch);
+
+const char* parse_int(const char* p, const char* end, int64_t& out);
+
+const char* parse_uint(const char* p, const char* end, uint64_t& out);
+
+const char* parse_bool(const char* p, const char* end, bool& out);
+
+bool is_null(const char* p, const char* end);
+
+template<typename F>
+const char* for_each_member(const char* p, const char* end, F&& f) {
+    p = skip_whitespace(p, end);
+    if(p == end || *p != '{') {
+        return nullptr;
+    }
+    p = skip_whitespace(p + 1, end);
+    if(p != end && *p == '}') {
+        return p + 1;
+    }
+    while(p != end) {
+        if(*p != '"') {
+            return nullptr;
+        }
+        auto key_end = skip_string(p, end);
+        if(!key_end) {
+            return nullptr;
+        }
+        std::string_view key(p + 1, key_end - p - 2);
+        p = skip_whitespace(key_end, end);
+        if(p == end || *p != ':') {
+            return nullptr;
+        }
+        p = f(key, skip_whitespace(p + 1, end));
+        if(!p) {
+            return nullptr;
+        }
+        p = skip_whitespace(p, end);
+        if(p == end) {
+            return nullptr;
+        } else if(*p == '}') {
+            return p + 1;
+        } else if(*p != ',') {
+            return nullptr;
+        }
+        p = skip_whitespace(p + 1, end);
+    }
+    return nullptr;
+}
+
+template<typename F>
+const char* for_each_element(const char* p, const char* end, F&& f) {
+    p = skip_whitespace(p, end);
+    if(p == end || *p != '[') {
+        return nullptr;
+    }
+    p = skip_whitespace(p + 1, end);
+    if(p != end && *p == ']') {
+        return p + 1;
+    }
+    while(p != end) {
+        p = f(p);
+        if(!p) {
+            return nullptr;
+        }
+        p = skip_whitespace(p, end);
+        if(p == end) {
+            return nullptr;
+        } else if(*p == ']') {
+            return p + 1;
+        } else if(*p != ',') {
+            return nullptr;
+        }
+        p = skip_whitespace(p + 1, end);
+    }
+    return nullptr;
+}
+
+#endif // JSON_SCAN_H
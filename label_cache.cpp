@@ -0,0 +1,132 @@
+#include "label_cache.h"
+#include <algorithm>
+
+// Plenty for the lines on screen at once, a full cache only drops what's gone unused
+static constexpr size_t MAX_WIDTHS = 1 << 18;
+static constexpr size_t MAX_TEXTS = 1 << 12;
+
+LabelCache::LabelCache(const QFont& font):
+    label_font(font),
+    label_metrics(font),
+    widths(MAX_WIDTHS),
+    texts(MAX_TEXTS),
+    part_sizes(MAX_WIDTHS),
+    part_texts(MAX_TEXTS)
+{
+}
+
+void LabelCache::set_font(const QFont& font) {
+    if(font == label_font) {
+        return;
+    }
+    label_font = font;
+    label_metrics = QFontMetricsF(font);
+    widths.clear();
+    texts.clear();
+    forget_strings();
+}
+
+void LabelCache::forget_strings() {
+    part_sizes.clear();
+    part_texts.clear();
+}
+
+const QFont& LabelCache::font() const {
+    return label_font;
+}
+
+const QFontMetricsF& LabelCache::metrics() const {
+    return label_metrics;
+}
+
+qreal LabelCache::width(const QString& line) {
+    if(auto existing = widths.find(line)) {
+        return *existing;
+    }
+    return widths.insert(line, label_metrics.horizontalAdvance(line));
+}
+
+QStaticText LabelCache::shape(const QString& line) const {
+    QStaticText text(line);
+    text.setTextFormat(Qt::PlainText);
+    text.setPerformanceHint(QStaticText::AggressiveCaching);
+    text.prepare(QTransform(), label_font);
+    return text;
+}
+
+const QStaticText& LabelCache::shaped(const QString& line) {
+    if(auto existing = texts.find(line)) {
+        return *existing;
+    }
+    return texts.insert(line, shape(line));
+}
+
+const LabelCache::PartSize& LabelCache::part_size(const EventStore& events, const LabelPart& part) {
+    if(auto existing = part_sizes.find(part)) {
+        return *existing;
+    }
+    PartSize size{0.0, 0};
+    for(const auto& line: events.part_text(part).split('\n')) {
+        size.width = std::max(size.width, label_metrics.horizontalAdvance(line));
+        size.lines++;
+    }
+    return part_sizes.insert(part, size);
+}
+
+const std::vector<QStaticText>& LabelCache::shaped_part(const EventStore& events, const LabelPart& part) {
+    if(auto existing = part_texts.find(part)) {
+        return *existing;
+    }
+    std::vector<QStaticText> lines;
+    for(const auto& line: events.part_text(part).split('\n')) {
+        lines.push_back(shape(line));
+    }
+    return part_texts.insert(part, std::move(lines));
+}
+
+QSizeF LabelCache::size(const QString& label) {
+    qreal widest = 0.0;
+    int lines = 0;
+    for(const auto& line: label.split('\n')) {
+        widest = std::max(widest, width(line));
+        lines++;
+    }
+    return QSizeF(widest + 2.0*TEXT_MARGIN, lines * label_metrics.lineSpacing() + 2.0*TEXT_MARGIN);
+}
+
+QSizeF LabelCache::size(const EventStore& events, size_t i) {
+    LabelPart parts[EventStore::MAX_LABEL_PARTS];
+    auto count = events.label_parts(i, parts);
+    qreal widest = 0.0;
+    int lines = 0;
+    for(size_t p=0; p<count; p++) {
+        const auto& size = part_size(events, parts[p]);
+        widest = std::max(widest, size.width);
+        lines += size.lines;
+    }
+    return QSizeF(widest + 2.0*TEXT_MARGIN, lines * label_metrics.lineSpacing() + 2.0*TEXT_MARGIN);
+}
+
+void LabelCache::draw(QPainter* painter, const QRectF& box, const QString& label) {
+    QPointF pos(box.left() + TEXT_MARGIN, box.top() + TEXT_MARGIN);
+    for(const auto& line: label.split('\n')) {
+        if(!line.isEmpty()) {
+            painter->drawStaticText(pos, shaped(line));
+        }
+        pos.ry() += label_metrics.lineSpacing();
+    }
+}
+
+void LabelCache::draw(QPainter* painter, const QRectF& box, const EventStore& events, size_t i) {
+    LabelPart parts[EventStore::MAX_LABEL_PARTS];
+    auto count = events.label_parts(i, parts);
+    QPointF pos(box.left() + TEXT_MARGIN, box.top() + TEXT_MARGIN);
+    for(size_t p=0; p<count; p++) {
+        for(const auto& line: shaped_part(events, parts[p])) {
+            if(!line.text().isEmpty()) {
+                painter->drawStaticText(pos, line);
+            }
+            pos.ry() += label_metrics.lineSpacing();
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef LABEL_CACHE_H
+#define LABEL_CACHE_H
+
+#include <QFont>
+#include <QFontMetricsF>
+#include <QHash>
+#include <QPainter>
+#include <QStaticText>
+#include <QString>
+#include <unordered_map>
+#include <vector>
+#include "event_store.h"
+
+// A map that holds at most limit entries in two generations. When the newer one fills up the
+// older is dropped and the newer takes its place, anything found in the older is moved back
+// up. So filling up only throws out what hasn't been used since the last time it did.
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class AgingCache {
+public:
+    explicit AgingCache(size_t limit):
+        limit(limit)
+    {
+    }
+
+    const Value* find(const Key& key) {
+        auto found = recent.find(key);
+        if(found != recent.end()) {
+            return &found->second;
+        }
+        auto old = older.find(key);
+        if(old == older.end()) {
+            return nullptr;
+        }
+        auto value = std::move(old->second);
+        older.erase(old);
+        return &insert(key, std::move(value));
+    }
+
+    const Value& insert(const Key& key, Value value) {
+        if(recent.size() >= limit / 2) {
+            older = std::move(recent);
+            recent.clear();
+        }
+        return recent.insert_or_assign(key, std::move(value)).first->second;
+    }
+
+    void clear() {
+        recent.clear();
+        older.clear();
+    }
+private:
+    size_t limit;
+    std::unordered_map<Key, Value, Hash> recent;
+    std::unordered_map<Key, Value, Hash> older;
+};
+
+// Pre-shaped text for event labels in one font. Labels are built from parts that repeat a
+// lot (descriptions, file:line, pids) so it's parts that get cached. Events are looked up by
+// what their parts are made of so their labels are never built, plain strings a line at a
+// time. Widths are kept for far more than shaped text as they're much smaller.
+class LabelCache {
+public:
+    // Gap between an outline and its label
+    static constexpr qreal TEXT_MARGIN = 4.0;
+
+    explicit LabelCache(const QFont& font = QFont());
+
+    // Throws everything away if the font actually changes
+    void set_font(const QFont& font);
+
+    // Text parts are string ids, once the store they came from is cleared they'd be wrong
+    void forget_strings();
+
+    const QFont& font() const;
+
+    const QFontMetricsF& metrics() const;
+
+    // Size of the box a label is drawn in, margin included
+    QSizeF size(const QString& label);
+
+    QSizeF size(const EventStore& events, size_t i);
+
+    // Draws a label inside a box from size
+    void draw(QPainter* painter, const QRectF& box, const QString& label);
+
+    void draw(QPainter* painter, const QRectF& box, const EventStore& events, size_t i);
+private:
+    struct PartSize {
+        qreal width;
+        int lines;
+    };
+
+    struct StringHash {
+        size_t operator()(const QString& s) const {
+            return qHash(s);
+        }
+    };
+
+    qreal width(const QString& line);
+    const QStaticText& shaped(const QString& line);
+    const PartSize& part_size(const EventStore& events, const LabelPart& part);
+    const std::vector<QStaticText>& shaped_part(const EventStore& events, const LabelPart& part);
+    QStaticText shape(const QString& line) const;
+
+    QFont label_font;
+    QFontMetricsF label_metrics;
+    AgingCache<QString, qreal, StringHash> widths;
+    AgingCache<QString, QStaticText, StringHash> texts;
+    AgingCache<LabelPart, PartSize, LabelPartHash> part_sizes;
+    AgingCache<LabelPart, std::vector<QStaticText>, LabelPartHash> part_texts;
+};
+
+#endif // LABEL_CACHE_H
@@ -0,0 +1,227 @@
+#include "location_panel.h"
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QSplitter>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+static constexpr int HEATMAP_WIDTH = 24;
+
+// Yellow for the odd hit through to red for the most, on a log scale since a few lines in
+// a loop usually dwarf everything else
+static QColor heat_colour(uint64_t hits, uint64_t most) {
+    if(hits == 0 || most == 0) {
+        return QColor(230, 230, 230);
+    }
+    auto t = std::log1p(static_cast<double>(hits)) / std::log1p(static_cast<double>(most));
+    return QColor::fromHsv(static_cast<int>((1.0 - t) * 60.0), 80 + static_cast<int>(t * 175.0), 255);
+}
+
+static void number_item(QTreeWidgetItem* item, int column, qulonglong value) {
+    // Numbers rather than text so the columns sort properly
+    item->setData(column, Qt::DisplayRole, value);
+    item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+}
+
+line_heatmap::line_heatmap(QWidget* parent):
+    QWidget(parent)
+{
+    setMinimumWidth(HEATMAP_WIDTH);
+    setMaximumWidth(HEATMAP_WIDTH);
+    setToolTip("Hits per line, click to jump to a line");
+}
+
+QSize line_heatmap::sizeHint() const {
+    return QSize(HEATMAP_WIDTH, 200);
+}
+
+void line_heatmap::set_lines(std::vector<std::pair<int, uint64_t>> hits) {
+    lines = std::move(hits);
+    most_hits = 0;
+    for(const auto& line: lines) {
+        most_hits = std::max(most_hits, line.second);
+    }
+    update();
+}
+
+int line_heatmap::last_line() const {
+    return lines.empty() ? 1 : std::max(lines.back().first, 1);
+}
+
+void line_heatmap::paintEvent(QPaintEvent*) {
+    QPainter painter(this);
+    auto rows = std::max(height(), 1);
+    painter.fillRect(rect(), heat_colour(0, 0));
+    // Several lines can share a pixel row, the row shows the hottest of them
+    std::vector<uint64_t> row_hits(rows, 0);
+    auto total = static_cast<double>(last_line());
+    for(const auto& line: lines) {
+        auto row = std::clamp(static_cast<int>((line.first - 1) / total * rows), 0, rows - 1);
+        row_hits[row] = std::max(row_hits[row], line.second);
+    }
+    // Short files get taller bands rather than a line per pixel
+    auto band = std::max(1, static_cast<int>(rows / total));
+    for(int row=0; row<rows; row++) {
+        if(row_hits[row] > 0) {
+            painter.fillRect(0, row, width(), band, heat_colour(row_hits[row], most_hits));
+        }
+    }
+}
+
+void line_heatmap::mousePressEvent(QMouseEvent* event) {
+    if(lines.empty() || event->button() != Qt::LeftButton) {
+        return;
+    }
+    auto target = static_cast<int>(event->pos().y() / static_cast<double>(std::max(height(), 1)) * last_line()) + 1;
+    auto it = std::lower_bound(lines.begin(), lines.end(), target, [](const std::pair<int, uint64_t>& line, int value) {
+        return line.first < value;
+    });
+    if(it == lines.end() || (it != lines.begin() && target - std::prev(it)->first < it->first - target)) {
+        --it;
+    }
+    emit line_clicked(it->first);
+}
+
+location_panel::location_panel(QWidget* parent):
+    QWidget(parent)
+{
+    files = new QTreeWidget(this);
+    files->setRootIsDecorated(false);
+    files->setUniformRowHeights(true);
+    files->setHeaderLabels({"File", "Hits", "Lines", "Pids", "First", "Last"});
+    files->setSortingEnabled(true);
+    files->sortByColumn(1, Qt::DescendingOrder);
+
+    heatmap = new line_heatmap(this);
+    lines = new QTreeWidget(this);
+    lines->setRootIsDecorated(false);
+    lines->setUniformRowHeights(true);
+    lines->setHeaderLabels({"Line", "Hits", "Pids", "First", "Last"});
+    lines->setSortingEnabled(true);
+    lines->sortByColumn(0, Qt::AscendingOrder);
+
+    auto file_lines = new QWidget(this);
+    auto file_layout = new QHBoxLayout(file_lines);
+    file_layout->setContentsMargins(0, 0, 0, 0);
+    file_layout->addWidget(heatmap);
+    file_layout->addWidget(lines);
+
+    auto splitter = new QSplitter(Qt::Vertical, this);
+    splitter->addWidget(files);
+    splitter->addWidget(file_lines);
+    auto layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(splitter);
+
+    connect(files, &QTreeWidget::currentItemChanged, this, [this](QTreeWidgetItem* item) {
+        selected_file = item ? item->text(0) : QString();
+        show_lines();
+    });
+    connect(lines, &QTreeWidget::itemClicked, this, [this](QTreeWidgetItem* item) {
+        emit line_activated(selected_file, item->data(0, Qt::DisplayRole).toInt());
+    });
+    connect(heatmap, &line_heatmap::line_clicked, this, [this](int line) {
+        select_line(line);
+        emit line_activated(selected_file, line);
+    });
+}
+
+void location_panel::clear() {
+    stats.reset();
+    selected_file.clear();
+    lines_file.reset();
+    file_items.clear();
+    line_items.clear();
+    files->clear();
+    lines->clear();
+    heatmap->set_lines({});
+}
+
+void location_panel::set_stats(LocationSnapshot snapshot) {
+    stats = std::move(snapshot);
+    show_files();
+}
+
+void location_panel::show_files() {
+    files->setUpdatesEnabled(false);
+    files->setSortingEnabled(false);
+    for(const auto& [id, hits]: stats->files()) {
+        auto& item = file_items[id];
+        if(!item) {
+            item = new QTreeWidgetItem(files);
+        }
+        // Names only change when the paths are made relative
+        const auto& name = stats->strings().get(id);
+        if(item->text(0) != name) {
+            item->setText(0, name);
+            item->setToolTip(0, name);
+        }
+        number_item(item, 1, hits.hits);
+        number_item(item, 2, stats->line_count(id));
+        number_item(item, 3, hits.pids.size());
+        number_item(item, 4, hits.first);
+        number_item(item, 5, hits.last);
+    }
+    files->setSortingEnabled(true);
+    files->setUpdatesEnabled(true);
+    if(auto current = files->currentItem()) {
+        selected_file = current->text(0);
+    }
+    show_lines();
+}
+
+void location_panel::show_lines() {
+    std::optional<uint32_t> id;
+    if(stats && !selected_file.isEmpty()) {
+        auto utf8 = selected_file.toUtf8();
+        id = stats->strings().find(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())));
+    }
+    lines->setUpdatesEnabled(false);
+    lines->setSortingEnabled(false);
+    if(id != lines_file) {
+        lines_file = id;
+        line_items.clear();
+        lines->clear();
+    }
+    std::vector<std::pair<int, uint64_t>> heat;
+    if(id) {
+        auto file_lines = stats->lines(*id);
+        uint64_t most = 0;
+        for(const auto& line: file_lines) {
+            most = std::max(most, line.second->hits);
+        }
+        for(const auto& [line, hits]: file_lines) {
+            auto& item = line_items[line];
+            if(!item) {
+                item = new QTreeWidgetItem(lines);
+                number_item(item, 0, static_cast<qulonglong>(std::max(line, 0)));
+            }
+            number_item(item, 1, hits->hits);
+            number_item(item, 2, hits->pids.size());
+            number_item(item, 3, hits->first);
+            number_item(item, 4, hits->last);
+            item->setBackground(1, heat_colour(hits->hits, most));
+            heat.emplace_back(line, hits->hits);
+        }
+    }
+    lines->setSortingEnabled(true);
+    lines->setUpdatesEnabled(true);
+    heatmap->set_lines(std::move(heat));
+}
+
+void location_panel::select_line(int line) {
+    for(int i=0; i<lines->topLevelItemCount(); i++) {
+        auto item = lines->topLevelItem(i);
+        if(item->data(0, Qt::DisplayRole).toInt() == line) {
+            lines->setCurrentItem(item);
+            lines->scrollToItem(item);
+            return;
+        }
+    }
+}
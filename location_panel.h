@@ -0,0 +1,70 @@
+#ifndef LOCATION_PANEL_H
+#define LOCATION_PANEL_H
+
+#include <QTreeWidget>
+#include <QWidget>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "location_worker.h"
+
+// Every line of one file top to bottom squashed into the widgets height, coloured by how
+// often it was hit. Lines that were never hit are left grey.
+class line_heatmap: public QWidget
+{
+    Q_OBJECT
+public:
+    explicit line_heatmap(QWidget* parent = nullptr);
+
+    // Line numbers and hits, in line order
+    void set_lines(std::vector<std::pair<int, uint64_t>> hits);
+
+    QSize sizeHint() const override;
+signals:
+    // The hit line nearest to the click
+    void line_clicked(int line);
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+private:
+    int last_line() const;
+
+    std::vector<std::pair<int, uint64_t>> lines;
+    uint64_t most_hits = 0;
+};
+
+// Source location hit counts, files in a sortable table and the lines of whichever file is
+// selected under it next to their heatmap
+class location_panel: public QWidget
+{
+    Q_OBJECT
+public:
+    explicit location_panel(QWidget* parent = nullptr);
+
+    void set_stats(LocationSnapshot stats);
+
+    void clear();
+signals:
+    void line_activated(const QString& file, int line);
+private:
+    void show_files();
+    void show_lines();
+    void select_line(int line);
+
+    LocationSnapshot stats;
+    QTreeWidget* files;
+    line_heatmap* heatmap;
+    QTreeWidget* lines;
+    QString selected_file;
+    // Rows are kept and updated where they are from one snapshot to the next, file ids don't
+    // change within a load
+    std::unordered_map<uint32_t, QTreeWidgetItem*> file_items;
+    std::map<int, QTreeWidgetItem*> line_items;
+    // File the lines table is showing
+    std::optional<uint32_t> lines_file;
+};
+
+#endif // LOCATION_PANEL_H
@@ -0,0 +1,235 @@
+#include "location_stats.h"
+#include <QThread>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+
+// Splitting less than this between threads costs more than it saves
+static constexpr size_t MIN_ROWS_PER_THREAD = 16384;
+static constexpr int MAX_THREADS = 16;
+
+static uint64_t location_key(uint32_t file, int line) {
+    return static_cast<uint64_t>(file) << 32 | static_cast<uint32_t>(line);
+}
+
+static void add_pid(std::vector<uint32_t>& pids, uint32_t pid) {
+    // Runs of events from the same process are the common case
+    if(!pids.empty() && pids.back() == pid) {
+        return;
+    }
+    auto it = std::lower_bound(pids.begin(), pids.end(), pid);
+    if(it == pids.end() || *it != pid) {
+        pids.insert(it, pid);
+    }
+}
+
+void LocationHits::add(uint32_t node, uint32_t pid) {
+    hits++;
+    first = std::min(first, node);
+    last = std::max(last, node);
+    add_pid(pids, pid);
+}
+
+void LocationHits::merge(const LocationHits& other) {
+    hits += other.hits;
+    first = std::min(first, other.first);
+    last = std::max(last, other.last);
+    // Within a batch a line is usually only hit by a process or two
+    if(other.pids.size() <= 8) {
+        for(auto pid: other.pids) {
+            add_pid(pids, pid);
+        }
+    } else {
+        std::vector<uint32_t> merged;
+        merged.reserve(pids.size() + other.pids.size());
+        std::set_union(pids.begin(), pids.end(), other.pids.begin(), other.pids.end(), std::back_inserter(merged));
+        pids = std::move(merged);
+    }
+}
+
+namespace {
+// What one thread counted over its share of a batch. Files are still ids in the batch's pool
+// and nodes are counted from the start of the share.
+struct PartialStats {
+    // Slots into hits, which stay small and together where the map's nodes wouldn't
+    std::unordered_map<uint64_t, uint32_t> slots;
+    std::vector<uint64_t> keys;
+    std::vector<LocationHits> hits;
+    std::vector<std::vector<uint32_t>> slot_nodes;
+    std::unordered_map<uint32_t, LocationHits> files;
+    uint32_t nodes = 0;
+};
+}
+
+static void count_rows(const EventStore& batch, size_t begin, size_t end, PartialStats& out) {
+    // Loops hit the same line over and over so the last one is worth remembering
+    uint64_t last_key = UINT64_MAX;
+    uint32_t last_slot = 0;
+    LocationHits* file = nullptr;
+    for(auto row=begin; row<end; row++) {
+        auto kind = batch.kind(row);
+        if(kind == EventKind::marker) {
+            continue;
+        }
+        auto node = out.nodes++;
+        if(kind != EventKind::trace || !batch.has(row, EventStore::HAS_LOCATION)) {
+            continue;
+        }
+        auto key = location_key(batch.file_id(row), *batch.line(row));
+        if(key != last_key) {
+            auto slot = out.slots.find(key);
+            if(slot == out.slots.end()) {
+                slot = out.slots.emplace(key, static_cast<uint32_t>(out.hits.size())).first;
+                out.keys.push_back(key);
+                out.hits.emplace_back();
+                out.slot_nodes.emplace_back();
+            }
+            if(key >> 32 != last_key >> 32) {
+                file = &out.files[static_cast<uint32_t>(key >> 32)];
+            }
+            last_key = key;
+            last_slot = slot->second;
+        }
+        auto pid = static_cast<uint32_t>(batch.pid(row).value_or(0));
+        out.hits[last_slot].add(node, pid);
+        out.slot_nodes[last_slot].push_back(node);
+        file->add(node, pid);
+    }
+}
+
+void LocationStats::clear() {
+    *this = LocationStats();
+}
+
+void LocationStats::add(const EventStore& batch, size_t first_node) {
+    auto threads = static_cast<size_t>(std::clamp(QThread::idealThreadCount(), 1, MAX_THREADS));
+    auto parts = std::clamp<size_t>(batch.size() / MIN_ROWS_PER_THREAD, 1, threads);
+    std::vector<PartialStats> partials(parts);
+    auto bounds = [&](size_t part) {
+        return batch.size() * part / parts;
+    };
+    if(parts == 1) {
+        count_rows(batch, 0, batch.size(), partials[0]);
+    } else {
+        std::vector<std::thread> workers;
+        for(size_t part=0; part<parts; part++) {
+            workers.emplace_back(count_rows, std::cref(batch), bounds(part), bounds(part + 1), std::ref(partials[part]));
+        }
+        for(auto& worker: workers) {
+            worker.join();
+        }
+    }
+
+    // Merging is per distinct line rather than per event so it stays cheap on one thread
+    std::unordered_map<uint32_t, uint32_t> file_ids;
+    auto file_id = [&](uint32_t batch_file) {
+        auto id = file_ids.find(batch_file);
+        if(id == file_ids.end()) {
+            id = file_ids.emplace(batch_file, file_names.intern(batch.strings().bytes(batch_file))).first;
+        }
+        return id->second;
+    };
+    auto base = first_node;
+    for(auto& partial: partials) {
+        for(auto& [batch_file, hits]: partial.files) {
+            hits.first += static_cast<uint32_t>(base);
+            hits.last += static_cast<uint32_t>(base);
+            file_hits[file_id(batch_file)].merge(hits);
+        }
+        for(size_t slot=0; slot<partial.keys.size(); slot++) {
+            auto key = partial.keys[slot];
+            auto& hits = partial.hits[slot];
+            auto file = file_id(static_cast<uint32_t>(key >> 32));
+            hits.first += static_cast<uint32_t>(base);
+            hits.last += static_cast<uint32_t>(base);
+            auto line_key = location_key(file, static_cast<int>(static_cast<uint32_t>(key)));
+            auto line = line_slots.find(line_key);
+            uint32_t merged;
+            if(line != line_slots.end()) {
+                merged = line->second;
+                line_hits[merged].merge(hits);
+            } else {
+                merged = static_cast<uint32_t>(line_hits.size());
+                line_slots.emplace(line_key, merged);
+                line_keys.push_back(line_key);
+                line_hits.push_back(std::move(hits));
+                line_nodes.emplace_back();
+                file_lines[file].push_back(merged);
+            }
+            // Shares and batches come in order so the nodes stay sorted
+            auto& into = line_nodes[merged];
+            for(auto node: partial.slot_nodes[slot]) {
+                into.push_back(node + static_cast<uint32_t>(base));
+            }
+        }
+        base += partial.nodes;
+    }
+    node_count = base;
+}
+
+size_t LocationStats::nodes() const {
+    return node_count;
+}
+
+const StringPool& LocationStats::strings() const {
+    return file_names;
+}
+
+const std::map<uint32_t, LocationHits>& LocationStats::files() const {
+    return file_hits;
+}
+
+void LocationStats::reroot_files(const QDir& root) {
+    for(uint32_t id=1; id<file_names.size(); id++) {
+        auto relative = root.relativeFilePath(file_names.get(id)).toUtf8();
+        file_names.replace(id, std::string_view(relative.constData(), static_cast<size_t>(relative.size())));
+    }
+}
+
+size_t LocationStats::line_count(uint32_t file) const {
+    auto slots = file_lines.find(file);
+    return slots != file_lines.end() ? slots->second.size() : 0;
+}
+
+std::vector<uint32_t> LocationStats::nodes_at(const QString& file, int line) const {
+    auto utf8 = file.toUtf8();
+    auto id = file_names.find(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())));
+    if(!id) {
+        return {};
+    }
+    auto slot = line_slots.find(location_key(*id, line));
+    if(slot == line_slots.end() || slot->second >= line_nodes.size()) {
+        return {};
+    }
+    return line_nodes[slot->second];
+}
+
+LocationStats LocationStats::counts() const {
+    LocationStats copy;
+    copy.file_names = file_names;
+    copy.line_slots = line_slots;
+    copy.line_keys = line_keys;
+    copy.line_hits = line_hits;
+    copy.file_lines = file_lines;
+    copy.file_hits = file_hits;
+    copy.node_count = node_count;
+    return copy;
+}
+
+std::vector<std::pair<int, const LocationHits*>> LocationStats::lines(uint32_t file) const {
+    std::vector<std::pair<int, const LocationHits*>> result;
+    auto slots = file_lines.find(file);
+    if(slots == file_lines.end()) {
+        return result;
+    }
+    result.reserve(slots->second.size());
+    for(auto slot: slots->second) {
+        result.emplace_back(static_cast<int>(static_cast<uint32_t>(line_keys[slot])), &line_hits[slot]);
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+    return result;
+}
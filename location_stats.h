@@ -0,0 +1,72 @@
+#ifndef LOCATION_STATS_H
+#define LOCATION_STATS_H
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "event_store.h"
+#include "string_pool.h"
+
+// Hits on a source line, or on every line of a file
+struct LocationHits {
+    uint64_t hits = 0;
+    // First and last node with the location
+    uint32_t first = UINT32_MAX;
+    uint32_t last = 0;
+    // Sorted and without repeats
+    std::vector<uint32_t> pids;
+
+    void add(uint32_t node, uint32_t pid);
+
+    void merge(const LocationHits& other);
+};
+
+// Hit counts per file and per line of every trace event with a location. Built up a batch at
+// a time with nodes numbered the way graphics_view numbers them, big batches are split
+// between threads which each count into their own table before it's merged in.
+class LocationStats {
+public:
+    void clear();
+
+    // Rows are nodes from first_node on, markers aren't nodes so they're skipped
+    void add(const EventStore& batch, size_t first_node);
+
+    // Nodes seen so far, which is where the next batch starts
+    size_t nodes() const;
+
+    // File names, files() and lines() are keyed by ids in here
+    const StringPool& strings() const;
+
+    const std::map<uint32_t, LocationHits>& files() const;
+
+    // Every line of a file that was hit, in line order
+    std::vector<std::pair<int, const LocationHits*>> lines(uint32_t file) const;
+
+    // How many lines of a file were hit, without building lines(file)
+    size_t line_count(uint32_t file) const;
+
+    // Nodes with the location in order, empty if it was never hit
+    std::vector<uint32_t> nodes_at(const QString& file, int line) const;
+
+    // Everything but the nodes of each line, for snapshots that only show counts. nodes_at
+    // finds nothing in the copy.
+    LocationStats counts() const;
+
+    // Makes every file name relative to root, ids stay the same
+    void reroot_files(const QDir& root);
+private:
+    StringPool file_names;
+    // Keys have the file id in the high half and the line in the low half, each key gets a
+    // slot in line_hits and every file keeps a list of its slots
+    std::unordered_map<uint64_t, uint32_t> line_slots;
+    std::vector<uint64_t> line_keys;
+    std::vector<LocationHits> line_hits;
+    // Nodes of each slot, these are by far the biggest part so counts() leaves them out
+    std::vector<std::vector<uint32_t>> line_nodes;
+    std::map<uint32_t, std::vector<uint32_t>> file_lines;
+    std::map<uint32_t, LocationHits> file_hits;
+    size_t node_count = 0;
+};
+
+#endif // LOCATION_STATS_H
@@ -0,0 +1,52 @@
+#include "location_worker.h"
+
+static constexpr int PUBLISH_INTERVAL_MS = 500;
+
+location_worker::location_worker(QObject* parent):
+    QObject(parent)
+{
+    qRegisterMetaType<LocationSnapshot>("LocationSnapshot");
+    // Parented so it moves to the worker's thread along with it
+    publish_timer = new QTimer(this);
+    publish_timer->setSingleShot(true);
+    publish_timer->setInterval(PUBLISH_INTERVAL_MS);
+    connect(publish_timer, &QTimer::timeout, this, &location_worker::publish);
+}
+
+void location_worker::reset(int generation) {
+    current = generation;
+    stats.clear();
+    publish_timer->stop();
+}
+
+void location_worker::add(int generation, EventBatch events) {
+    if(generation != current) {
+        return;
+    }
+    stats.add(*events, stats.nodes());
+    if(!publish_timer->isActive()) {
+        publish_timer->start();
+    }
+}
+
+void location_worker::reroot(int generation, const QString& root) {
+    if(generation != current) {
+        return;
+    }
+    stats.reroot_files(QDir(root));
+    if(!publish_timer->isActive()) {
+        publish_timer->start();
+    }
+}
+
+void location_worker::find(int generation, const QString& file, int line, int request) {
+    if(generation != current) {
+        emit found(request, file, line, std::make_shared<const std::vector<uint32_t>>());
+        return;
+    }
+    emit found(request, file, line, std::make_shared<const std::vector<uint32_t>>(stats.nodes_at(file, line)));
+}
+
+void location_worker::publish() {
+    emit updated(current, std::make_shared<const LocationStats>(stats.counts()));
+}
@@ -0,0 +1,46 @@
+#ifndef LOCATION_WORKER_H
+#define LOCATION_WORKER_H
+
+#include <QObject>
+#include <QMetaType>
+#include <QTimer>
+#include <memory>
+#include "location_stats.h"
+#include "search_worker.h"
+#include "trace_loader.h"
+
+// A copy of the stats as they were, shared so queued connections don't copy them again
+using LocationSnapshot = std::shared_ptr<const LocationStats>;
+Q_DECLARE_METATYPE(LocationSnapshot)
+
+// Lives on its own thread and counts source locations from the same batches the view gets.
+// Snapshots go out at most a couple of times a second while a log is loading rather than
+// after every batch, copying them isn't free. They only have the counts, which nodes are
+// at a location is asked for here like a search.
+class location_worker: public QObject
+{
+    Q_OBJECT
+public:
+    explicit location_worker(QObject* parent = nullptr);
+public slots:
+    // Throws the stats away, batches from any other generation are ignored from now on
+    void reset(int generation);
+
+    void add(int generation, EventBatch events);
+
+    void reroot(int generation, const QString& root);
+
+    void find(int generation, const QString& file, int line, int request);
+signals:
+    void updated(int generation, LocationSnapshot stats);
+
+    void found(int request, const QString& file, int line, SearchResults nodes);
+private:
+    void publish();
+
+    LocationStats stats;
+    QTimer* publish_timer;
+    int current = -1;
+};
+
+#endif // LOCATION_WORKER_H
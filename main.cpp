@@ -1,9 +1,25 @@
 #include "tarpaulinviewer.h"
+#include "trace_summary.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QGuiApplication>
 
 int main(int argc, char *argv[])
 {
+    // Command line tools run without a display so mustn't create a QApplication
+    if(wants_cli(argc, argv)) {
+        // Exports still need fonts, the offscreen platform has them without a display
+        if(cli_draws(argc, argv)) {
+            if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+                qputenv("QT_QPA_PLATFORM", "offscreen");
+            }
+            QGuiApplication a(argc, argv);
+            return run_cli(a.arguments());
+        }
+        QCoreApplication a(argc, argv);
+        return run_cli(a.arguments());
+    }
     QApplication a(argc, argv);
     TarpaulinViewer w;
     w.show();
@@ -0,0 +1,404 @@
+#include "mapped_reader.h"
+#include <QDebug>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Not worth the thread overhead for less than this
+static constexpr qint64 MIN_CHUNK = 4 << 20;
+static constexpr int MAX_THREADS = 16;
+// The first chunk is kept small so there's something to show straight away
+static constexpr qint64 FIRST_CHUNK = 1 << 20;
+// Chunks are capped so huge logs don't need huge chunks decoded in memory at once
+static constexpr qint64 MAX_CHUNK = 64 << 20;
+// How many chunks can be decoded ahead of the sink, per thread
+static constexpr size_t AHEAD = 2;
+
+struct EventChunk {
+    EventChunk(const char* start, const char* limit):
+        start(start),
+        limit(limit)
+    {
+    }
+    // start is a guess at the first element, decoding carries on to the first element at or
+    // past limit and records where that was in stop
+    const char* start;
+    const char* limit;
+    const char* stop = nullptr;
+    Scan result = Scan::ok;
+    bool array_end = false;
+    bool done = false;
+    EventStore events;
+};
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Looks for something shaped like the gap between two elements "},{"" from p onwards. This
+// can be fooled by a description containing it, so chunks are checked against each other
+// before their events are used.
+static const char* next_boundary(const char* p, const char* begin, const char* end) {
+    while(p < end) {
+        auto brace = static_cast<const char*>(std::memchr(p, '{', end - p));
+        if(!brace) {
+            return end;
+        }
+        auto next = skip_whitespace(brace + 1, end);
+        auto back = brace;
+        while(back > begin && is_space(back[-1])) {
+            --back;
+        }
+        if(next != end && *next == '"' && back > begin && back[-1] == ',') {
+            --back;
+            while(back > begin && is_space(back[-1])) {
+                --back;
+            }
+            if(back > begin && back[-1] == '}') {
+                return brace;
+            }
+        }
+        p = brace + 1;
+    }
+    return end;
+}
+
+static void decode_chunk(EventChunk& chunk, const char* end, const QString& root, const std::atomic<bool>& stopping, PhaseLog* phases) {
+    PhaseTimer timer(phases, "decode");
+    // QDir caches lazily so it can't be shared between threads, even for const use
+    EventDecoder decoder(root);
+    auto p = chunk.start;
+    while(!stopping) {
+        auto value_end = p;
+        chunk.result = scan_value(value_end, end);
+        if(chunk.result != Scan::ok) {
+            break;
+        }
+        if(!decoder.decode(p, value_end, chunk.events)) {
+            qDebug()<<"Skipping malformed event at byte"<<(p - chunk.start);
+        }
+        p = skip_whitespace(value_end, end);
+        if(p == end) {
+            chunk.result = Scan::partial;
+            break;
+        } else if(*p == ']') {
+            chunk.array_end = true;
+            break;
+        } else if(*p != ',') {
+            chunk.result = Scan::invalid;
+            break;
+        }
+        p = skip_whitespace(p + 1, end);
+        if(p >= chunk.limit) {
+            break;
+        }
+    }
+    chunk.stop = p;
+    timer.add(static_cast<qint64>(chunk.events.size()));
+}
+
+MappedEventReader::MappedEventReader(QFile* file):
+    file(file)
+{
+}
+
+bool MappedEventReader::truncated() const {
+    return is_truncated;
+}
+
+QString MappedEventReader::error() const {
+    return error_message;
+}
+
+QDir MappedEventReader::root() const {
+    return root_dir;
+}
+
+bool MappedEventReader::rooted_late() const {
+    return late_root;
+}
+
+void MappedEventReader::set_root(const QDir& root) {
+    root_dir = root;
+    have_root = true;
+}
+
+size_t MappedEventReader::events_read() const {
+    return event_count;
+}
+
+void MappedEventReader::set_progress(ProgressCallback callback) {
+    progress = std::move(callback);
+}
+
+void MappedEventReader::set_cancel(CancelCheck check) {
+    cancelled = std::move(check);
+}
+
+void MappedEventReader::set_phase_log(PhaseLog* log) {
+    phases = log;
+}
+
+bool MappedEventReader::read(const EventSink& sink) {
+    char magic[4];
+    auto compression = detect_compression(magic, file->peek(magic, sizeof(magic)));
+    if(compression != Compression::none) {
+        return read_compressed(compression, sink);
+    }
+    auto size = file->size();
+    uchar* data = nullptr;
+    {
+        PhaseTimer timer(phases, "map");
+        data = size > 0 ? file->map(0, size) : nullptr;
+    }
+    if(!data) {
+        return read_stream(file, sink);
+    }
+    auto begin = reinterpret_cast<const char*>(data);
+    auto result = read_mapped(begin, begin + size, sink);
+    file->unmap(data);
+    return result || is_truncated;
+}
+
+bool MappedEventReader::read_stream(QIODevice* device, const EventSink& sink) {
+    // Reading and decoding are interleaved here so they can't be timed apart
+    PhaseTimer timer(phases, "stream decode");
+    EventReader reader(device);
+    if(have_root) {
+        reader.set_root(root_dir);
+    }
+    reader.set_progress(progress);
+    reader.set_cancel(cancelled);
+    auto result = reader.read(sink);
+    is_truncated = reader.truncated();
+    error_message = reader.error();
+    root_dir = reader.root();
+    late_root = reader.rooted_late();
+    event_count = reader.events_read();
+    return result;
+}
+
+bool MappedEventReader::read_compressed(Compression compression, const EventSink& sink) {
+    decompressing_device device(file, compression);
+    device.set_phase_log(phases);
+    if(!device.open(QIODevice::ReadOnly)) {
+        error_message = device.errorString();
+        return false;
+    }
+    // Progress goes by how much of the compressed file has been read, the decompressed size
+    // isn't known up front
+    auto total = file->size();
+    auto reported = progress;
+    progress = [&device, total, reported](qint64, qint64) {
+        if(reported) {
+            reported(device.compressed_pos(), total);
+        }
+    };
+    auto result = read_stream(&device, sink);
+    progress = reported;
+    // Damaged compressed data looks like a log that stops early, say why
+    auto damage = device.error();
+    if(!damage.isEmpty() && (is_truncated || !result)) {
+        error_message = QString("%1, %2").arg(damage, error_message);
+    }
+    return result;
+}
+
+bool MappedEventReader::read_mapped(const char* begin, const char* end, const EventSink& sink) {
+    // Finding the events array and where to split it
+    std::optional<PhaseTimer> split_timer(std::in_place, phases, "split");
+    QStringList paths;
+    bool have_manifest = have_root || probe_manifest(begin, end, paths);
+
+    // Find the events array, only skipping over it if the manifest is still missing
+    const char* events = nullptr;
+    auto p = skip_whitespace(begin, end);
+    if(p == end || *p != '{') {
+        error_message = "Not a tarpaulin event log";
+        return false;
+    }
+    p = skip_whitespace(p + 1, end);
+    while(p != end && *p == '"') {
+        auto key_end = skip_string(p, end);
+        if(!key_end) {
+            break;
+        }
+        std::string_view key(p + 1, key_end - p - 2);
+        p = skip_whitespace(key_end, end);
+        if(p == end || *p != ':') {
+            break;
+        }
+        p = skip_whitespace(p + 1, end);
+        if(key == "events") {
+            events = p;
+            if(have_manifest) {
+                break;
+            }
+        }
+        auto value = p;
+        if(scan_value(p, end) != Scan::ok) {
+            break;
+        }
+        if(key == "manifest_paths" && !have_manifest) {
+            paths = parse_manifest(value, p);
+            have_manifest = true;
+            if(events) {
+                break;
+            }
+        }
+        p = skip_whitespace(p, end);
+        if(p == end || *p != ',') {
+            break;
+        }
+        p = skip_whitespace(p + 1, end);
+    }
+    if(!have_root) {
+        root_dir = choose_root(paths);
+    }
+
+    if(!events || *events != '[') {
+        error_message = "No events in log";
+        return false;
+    }
+    auto first = skip_whitespace(events + 1, end);
+    if(first == end) {
+        is_truncated = true;
+        error_message = "Log ends part way through, 0 events recovered";
+        return false;
+    } else if(*first == ']') {
+        return true;
+    }
+
+    auto threads = std::clamp(QThread::idealThreadCount(), 1, MAX_THREADS);
+    auto chunk_count = std::clamp<qint64>((end - first) / MIN_CHUNK, 1, std::max<qint64>(threads * 4, (end - first) / MAX_CHUNK));
+    std::vector<EventChunk> chunks;
+    chunks.reserve(chunk_count);
+    auto start = first;
+    if(chunk_count > 1) {
+        auto limit = next_boundary(first + FIRST_CHUNK, first, end);
+        chunks.emplace_back(start, limit);
+        start = limit;
+    }
+    auto rest = start;
+    for(qint64 i=1; i<=chunk_count && start < end; i++) {
+        auto limit = i == chunk_count ? end : next_boundary(rest + (end - rest) * i / chunk_count, first, end);
+        if(limit > start) {
+            chunks.emplace_back(start, limit);
+            start = limit;
+        }
+    }
+
+    split_timer.reset();
+
+    auto root_path = root_dir.path();
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<bool> stopping{false};
+    std::mutex lock;
+    std::condition_variable finished;
+    std::condition_variable room;
+    size_t handed = 0;
+    std::vector<std::thread> workers;
+    auto worker_count = std::min<size_t>(threads, chunks.size());
+    auto window = worker_count * AHEAD;
+    for(size_t i=0; i<worker_count; i++) {
+        workers.emplace_back([&]() {
+            for(size_t c = next_chunk++; c < chunks.size() && !stopping; c = next_chunk++) {
+                {
+                    // Don't get too far ahead of the sink or decoded events pile up
+                    std::unique_lock<std::mutex> guard(lock);
+                    room.wait(guard, [&]() { return c < handed + window || stopping; });
+                }
+                decode_chunk(chunks[c], end, root_path, stopping, phases);
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    chunks[c].done = true;
+                }
+                finished.notify_all();
+            }
+        });
+    }
+
+    // Hand chunks over in file order, checking each one starts where the last really ended
+    auto expected = first;
+    bool array_end = false;
+    bool was_cancelled = false;
+    Scan result = Scan::ok;
+    auto release = [&](EventChunk& chunk) {
+        chunk.events.clear();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            handed++;
+        }
+        room.notify_all();
+    };
+    for(auto& chunk: chunks) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while(!finished.wait_for(guard, std::chrono::milliseconds(50), [&chunk]() { return chunk.done; })) {
+                if(cancelled && cancelled()) {
+                    was_cancelled = true;
+                    break;
+                }
+            }
+        }
+        if(was_cancelled || (cancelled && cancelled())) {
+            was_cancelled = true;
+            break;
+        }
+        if(chunk.start != expected) {
+            if(expected >= chunk.limit) {
+                release(chunk);
+                continue;
+            }
+            EventChunk redo(expected, chunk.limit);
+            decode_chunk(redo, end, root_path, stopping, phases);
+            chunk.events = std::move(redo.events);
+            chunk.stop = redo.stop;
+            chunk.result = redo.result;
+            chunk.array_end = redo.array_end;
+        }
+        if(!chunk.events.empty()) {
+            PhaseTimer timer(phases, "sink");
+            timer.add(static_cast<qint64>(chunk.events.size()));
+            event_count += chunk.events.size();
+            sink(chunk.events);
+        }
+        release(chunk);
+        if(progress) {
+            progress(chunk.stop - begin, end - begin);
+        }
+        expected = chunk.stop;
+        result = chunk.result;
+        array_end = chunk.array_end;
+        if(array_end || result != Scan::ok) {
+            break;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    room.notify_all();
+    for(auto& worker: workers) {
+        worker.join();
+    }
+
+    if(array_end) {
+        return true;
+    } else if(was_cancelled) {
+        error_message = "Cancelled";
+    } else if(result == Scan::invalid) {
+        error_message = QString("Invalid JSON after %1 events").arg(event_count);
+    } else {
+        is_truncated = true;
+        error_message = QString("Log ends part way through, %1 events recovered").arg(event_count);
+    }
+    return false;
+}
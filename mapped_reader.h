@@ -0,0 +1,60 @@
+#ifndef MAPPED_READER_H
+#define MAPPED_READER_H
+
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include "decompress.h"
+#include "event_reader.h"
+#include "phase_log.h"
+
+// Maps the whole log and decodes the events array on worker threads. The array is split
+// into chunks at element boundaries and each chunk is handed to the sink in file order
+// once everything before it is done, so event indexes are the same as a sequential read.
+// Anything that can't be mapped is streamed with EventReader instead, as are gzip and zstd
+// compressed logs which are decompressed on a thread of their own as they're read. Those
+// only get to manifest_paths at the end so their paths are left as written, rooted_late
+// says when they still need making relative to root().
+class MappedEventReader {
+public:
+    explicit MappedEventReader(QFile* file);
+
+    bool read(const EventSink& sink);
+
+    bool truncated() const;
+
+    QString error() const;
+
+    QDir root() const;
+
+    bool rooted_late() const;
+
+    // Paths are made relative to root rather than the one in the log, so a second read comes
+    // out the same as the first
+    void set_root(const QDir& root);
+
+    size_t events_read() const;
+
+    void set_progress(ProgressCallback callback);
+
+    void set_cancel(CancelCheck check);
+
+    void set_phase_log(PhaseLog* log);
+private:
+    bool read_mapped(const char* begin, const char* end, const EventSink& sink);
+    bool read_stream(QIODevice* device, const EventSink& sink);
+    bool read_compressed(Compression compression, const EventSink& sink);
+
+    QFile* file;
+    bool is_truncated = false;
+    QString error_message;
+    QDir root_dir;
+    bool have_root = false;
+    bool late_root = false;
+    size_t event_count = 0;
+    ProgressCallback progress;
+    CancelCheck cancelled;
+    PhaseLog* phases = nullptr;
+};
+
+#endif // MAPPED_READER_H
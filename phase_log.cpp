@@ -0,0 +1,164 @@
+#include "phase_log.h"
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+
+PhaseLog::PhaseLog() {
+    clock.start();
+}
+
+void PhaseLog::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    spans.clear();
+    counters.clear();
+    epoch = clock.nsecsElapsed();
+    current_generation++;
+}
+
+qint64 PhaseLog::now() const {
+    return clock.nsecsElapsed() - epoch.load();
+}
+
+int PhaseLog::generation() const {
+    return current_generation.load();
+}
+
+int PhaseLog::thread_index() {
+    auto id = QThread::currentThreadId();
+    auto found = std::find(threads.begin(), threads.end(), id);
+    if(found != threads.end()) {
+        return static_cast<int>(found - threads.begin());
+    }
+    auto thread = QThread::currentThread();
+    auto name = thread->objectName();
+    if(name.isEmpty()) {
+        auto app = QCoreApplication::instance();
+        name = app && app->thread() == thread ? QString("main") : QString("thread %1").arg(threads.size());
+    }
+    threads.push_back(id);
+    thread_names.push_back(name);
+    return static_cast<int>(threads.size() - 1);
+}
+
+void PhaseLog::record(const char* name, qint64 start, qint64 end, qint64 count, int generation) {
+    std::lock_guard<std::mutex> guard(lock);
+    // A cancelled load's threads can still be finishing off after the next one has started
+    if(generation != current_generation) {
+        return;
+    }
+    spans.push_back({name, start, end - start, count, thread_index()});
+}
+
+void PhaseLog::counter(const char* name, qint64 value) {
+    std::lock_guard<std::mutex> guard(lock);
+    counters.push_back({name, now(), value});
+}
+
+QString PhaseLog::summary() const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<std::pair<const char*, qint64>> totals;
+    for(const auto& span: spans) {
+        auto found = std::find_if(totals.begin(), totals.end(), [&](const auto& total) {
+            return qstrcmp(total.first, span.name) == 0;
+        });
+        if(found == totals.end()) {
+            totals.emplace_back(span.name, span.duration);
+        } else {
+            found->second += span.duration;
+        }
+    }
+    QStringList parts;
+    for(const auto& [name, total]: totals) {
+        parts << QString("%1 %2s").arg(name).arg(total / 1e9, 0, 'f', 2);
+    }
+    return parts.join(", ");
+}
+
+qint64 PhaseLog::total(const char* name) const {
+    std::lock_guard<std::mutex> guard(lock);
+    qint64 sum = 0;
+    for(const auto& span: spans) {
+        if(qstrcmp(span.name, name) == 0) {
+            sum += span.duration;
+        }
+    }
+    return sum;
+}
+
+bool PhaseLog::write_chrome_trace(const QString& path) const {
+    std::lock_guard<std::mutex> guard(lock);
+    // Timestamps in the trace event format are in microseconds
+    QJsonArray events;
+    for(size_t i=0; i<thread_names.size(); i++) {
+        QJsonObject event;
+        event["name"] = "thread_name";
+        event["ph"] = "M";
+        event["pid"] = 1;
+        event["tid"] = static_cast<int>(i);
+        event["args"] = QJsonObject{{"name", thread_names[i]}};
+        events.append(event);
+    }
+    for(const auto& span: spans) {
+        QJsonObject event;
+        event["name"] = span.name;
+        event["cat"] = "load";
+        event["ph"] = "X";
+        event["ts"] = span.start / 1e3;
+        event["dur"] = span.duration / 1e3;
+        event["pid"] = 1;
+        event["tid"] = span.thread;
+        if(span.count) {
+            event["args"] = QJsonObject{{"count", span.count}};
+        }
+        events.append(event);
+    }
+    for(const auto& counter: counters) {
+        QJsonObject event;
+        event["name"] = counter.name;
+        event["ph"] = "C";
+        event["ts"] = counter.time / 1e3;
+        event["pid"] = 1;
+        event["args"] = QJsonObject{{"value", counter.value}};
+        events.append(event);
+    }
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+PhaseTimer::PhaseTimer(PhaseLog* log, const char* name):
+    log(log),
+    name(name)
+{
+    if(log) {
+        // Generation first, if a clear comes in between the span's dropped either way
+        generation = log->generation();
+        start = log->now();
+    }
+}
+
+PhaseTimer::~PhaseTimer() {
+    if(log) {
+        log->record(name, start, log->now(), count, generation);
+    }
+}
+
+void PhaseTimer::add(qint64 n) {
+    count += n;
+}
+
+void PhaseTimer::discard() {
+    log = nullptr;
+}
@@ -0,0 +1,89 @@
+#ifndef PHASE_LOG_H
+#define PHASE_LOG_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Where the time in a load went. Phases are timed with PhaseTimer from whichever thread
+// they run on and kept as spans, so they can be totalled for the status bar or written out
+// in Chrome's trace event format to look at in chrome://tracing or Perfetto.
+class PhaseLog {
+public:
+    PhaseLog();
+
+    // Throws away everything recorded and restarts the clock
+    void clear();
+
+    // Nanoseconds since the last clear
+    qint64 now() const;
+
+    // Bumped by clear, spans timed in an older generation belong to a load that's gone
+    int generation() const;
+
+    // Names have to be string literals, or at least outlive the log. Dropped unless
+    // generation is still the current one.
+    void record(const char* name, qint64 start, qint64 end, qint64 count, int generation);
+
+    void counter(const char* name, qint64 value);
+
+    // Total time per phase in the order they first ran, like "decode 1.20s, layout 0.31s"
+    QString summary() const;
+
+    // Nanoseconds spent in one phase over every span of it
+    qint64 total(const char* name) const;
+
+    bool write_chrome_trace(const QString& path) const;
+private:
+    struct Span {
+        const char* name;
+        qint64 start;
+        qint64 duration;
+        qint64 count;
+        int thread;
+    };
+    struct Counter {
+        const char* name;
+        qint64 time;
+        qint64 value;
+    };
+
+    int thread_index();
+
+    mutable std::mutex lock;
+    // Never restarted so any thread can read it, clear moves the epoch instead
+    QElapsedTimer clock;
+    std::atomic<qint64> epoch{0};
+    std::atomic<int> current_generation{0};
+    std::vector<Span> spans;
+    std::vector<Counter> counters;
+    std::vector<Qt::HANDLE> threads;
+    std::vector<QString> thread_names;
+};
+
+// Records a span covering its own lifetime, does nothing if the log is null
+class PhaseTimer {
+public:
+    PhaseTimer(PhaseLog* log, const char* name);
+
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    // Items handled in this phase, shown with the span in the trace
+    void add(qint64 n);
+
+    // Nothing gets recorded, for when the phase turned out to have nothing to do
+    void discard();
+private:
+    PhaseLog* log;
+    const char* name;
+    int generation = 0;
+    qint64 start = 0;
+    qint64 count = 0;
+};
+
+#endif // PHASE_LOG_H
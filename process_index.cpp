@@ -0,0 +1,52 @@
+#include "process_index.h"
+#include <algorithm>
+
+void ProcessIndex::clear() {
+    open_by_pid.clear();
+    open_by_child.clear();
+}
+
+size_t ProcessIndex::add(const EventStore& events, size_t index) {
+    return add(events, index, index);
+}
+
+size_t ProcessIndex::add(const EventStore& events, size_t row, size_t node) {
+    if(events.kind(row) != EventKind::trace) {
+        return NO_PARENT;
+    }
+    size_t parent = NO_PARENT;
+    auto pid = events.pid(row);
+    if(pid) {
+        // So this trace is either a child of another trace or a continuation of a running thread
+        // Assuming each trace can only have one parent but can have multiple children - might be incorrect for tests that use wait syscall
+        auto by_pid = open_by_pid.find(*pid);
+        auto by_child = open_by_child.find(*pid);
+        if(by_pid != open_by_pid.end()) {
+            parent = by_pid->second;
+        }
+        if(by_child != open_by_child.end() && (parent == NO_PARENT || by_child->second > parent)) {
+            parent = by_child->second;
+        }
+    }
+    if(!events.is_end_node(row)) {
+        if(pid) {
+            open_by_pid[*pid] = node;
+        }
+        if(auto child = events.child(row)) {
+            open_by_child[*child] = node;
+        }
+    }
+    return parent;
+}
+
+std::vector<size_t> ProcessIndex::open_nodes() const {
+    std::vector<size_t> nodes;
+    nodes.reserve(open_by_pid.size() + open_by_child.size());
+    for(const auto& [pid, node]: open_by_pid) {
+        nodes.push_back(node);
+    }
+    for(const auto& [child, node]: open_by_child) {
+        nodes.push_back(node);
+    }
+    return nodes;
+}
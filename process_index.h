@@ -0,0 +1,33 @@
+#ifndef PROCESS_INDEX_H
+#define PROCESS_INDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "event_store.h"
+
+// Keeps the latest open (not an end node) trace for every pid and every child pid, so
+// finding the parent of a new trace is a couple of lookups rather than a walk back over
+// every earlier event. End nodes don't close out earlier traces in the original walk
+// either, so the parent chosen is exactly the same.
+class ProcessIndex {
+public:
+    static constexpr size_t NO_PARENT = EventStore::NO_PARENT;
+
+    void clear();
+
+    // Returns the parent of event index and then records it, events must be added in order
+    size_t add(const EventStore& events, size_t index);
+
+    // For when events only holds the latest batch, row is where the event is in events and
+    // node is its index over the whole trace
+    size_t add(const EventStore& events, size_t row, size_t node);
+
+    // Every node a later trace could still get as its parent
+    std::vector<size_t> open_nodes() const;
+private:
+    std::unordered_map<uint64_t, size_t> open_by_pid;
+    std::unordered_map<uint64_t, size_t> open_by_child;
+};
+
+#endif // PROCESS_INDEX_H
@@ -0,0 +1,252 @@
+#include "process_panel.h"
+#include <QColor>
+#include <QHeaderView>
+#include <QVBoxLayout>
+#include <algorithm>
+
+// Rows are fetched this many at a time as the view scrolls down to them, the roots and the
+// children of a process alike
+static constexpr uint32_t CHUNK = 1000;
+static constexpr int COLUMNS = 6;
+// The signals that make a trace bad on the timeline
+static constexpr uint32_t BAD_SIGNALS = 1u << static_cast<uint32_t>(Signal::sigsegv) | 1u << static_cast<uint32_t>(Signal::sigill);
+
+process_tree_model::process_tree_model(QObject* parent):
+    QAbstractItemModel(parent)
+{
+}
+
+void process_tree_model::clear() {
+    beginResetModel();
+    tree.reset();
+    fetched_children.clear();
+    fetched_roots = 0;
+    expanded.clear();
+    endResetModel();
+}
+
+void process_tree_model::set_tree(ProcessSnapshot snapshot) {
+    if(!snapshot) {
+        clear();
+        return;
+    }
+    if(!tree || snapshot->reshapes() != tree->reshapes()) {
+        beginResetModel();
+        tree = std::move(snapshot);
+        fetched_children.assign(tree->size(), 0);
+        fetched_roots = 0;
+        expanded.clear();
+        endResetModel();
+        return;
+    }
+    // Rows stay where they were, anything that had been fetched to the end gets the new
+    // processes on the end of it
+    auto previous = std::move(tree);
+    tree = std::move(snapshot);
+    fetched_children.resize(tree->size(), 0);
+    std::vector<uint32_t> parents{ProcessInfo::NO_PROCESS};
+    parents.insert(parents.end(), expanded.begin(), expanded.end());
+    for(auto process: parents) {
+        auto before = process == ProcessInfo::NO_PROCESS ? previous->roots().size() : previous->process(process).children.size();
+        if(fetched(process) == before && children(process).size() > before) {
+            fetch_chunk(process);
+        }
+    }
+    // The view only gives a row an arrow when rows are inserted under it, so rows that were
+    // leaves and now have children get their first chunk
+    std::vector<uint32_t> new_parents;
+    for(auto process: parents) {
+        const auto& rows = children(process);
+        for(uint32_t row=0; row<fetched(process); row++) {
+            auto child = rows[row];
+            if(child < previous->size() && previous->process(child).children.empty() && !children(child).empty()) {
+                new_parents.push_back(child);
+            }
+        }
+    }
+    for(auto process: new_parents) {
+        fetch_chunk(process);
+    }
+    // Counts and exit codes of the rows already there may have moved on too
+    for(auto process: parents) {
+        if(fetched(process) == 0) {
+            continue;
+        }
+        QModelIndex parent;
+        if(process != ProcessInfo::NO_PROCESS) {
+            parent = createIndex(static_cast<int>(tree->process(process).row), 0, static_cast<quintptr>(process));
+        }
+        emit dataChanged(index(0, 0, parent), index(static_cast<int>(fetched(process)) - 1, COLUMNS - 1, parent));
+    }
+}
+
+qint64 process_tree_model::first_node(const QModelIndex& index) const {
+    if(!tree || !index.isValid()) {
+        return -1;
+    }
+    const auto& process = tree->process(static_cast<uint32_t>(index.internalId()));
+    return process.events > 0 ? static_cast<qint64>(process.first) : -1;
+}
+
+uint32_t process_tree_model::process_of(const QModelIndex& parent) const {
+    return parent.isValid() ? static_cast<uint32_t>(parent.internalId()) : ProcessInfo::NO_PROCESS;
+}
+
+const std::vector<uint32_t>& process_tree_model::children(uint32_t process) const {
+    return process == ProcessInfo::NO_PROCESS ? tree->roots() : tree->process(process).children;
+}
+
+uint32_t& process_tree_model::fetched(uint32_t process) {
+    return process == ProcessInfo::NO_PROCESS ? fetched_roots : fetched_children[process];
+}
+
+uint32_t process_tree_model::fetched(uint32_t process) const {
+    return process == ProcessInfo::NO_PROCESS ? fetched_roots : fetched_children[process];
+}
+
+void process_tree_model::append(uint32_t process, uint32_t count) {
+    QModelIndex parent;
+    if(process != ProcessInfo::NO_PROCESS) {
+        parent = createIndex(static_cast<int>(tree->process(process).row), 0, static_cast<quintptr>(process));
+        if(fetched(process) == 0) {
+            expanded.push_back(process);
+        }
+    }
+    auto& rows = fetched(process);
+    beginInsertRows(parent, static_cast<int>(rows), static_cast<int>(rows + count) - 1);
+    rows += count;
+    endInsertRows();
+}
+
+void process_tree_model::fetch_chunk(uint32_t process) {
+    auto remaining = static_cast<uint32_t>(children(process).size()) - fetched(process);
+    append(process, std::min(remaining, CHUNK));
+}
+
+QModelIndex process_tree_model::index(int row, int column, const QModelIndex& parent) const {
+    if(!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+    auto process = children(process_of(parent))[static_cast<size_t>(row)];
+    return createIndex(row, column, static_cast<quintptr>(process));
+}
+
+QModelIndex process_tree_model::parent(const QModelIndex& child) const {
+    if(!tree || !child.isValid()) {
+        return QModelIndex();
+    }
+    auto parent = tree->process(static_cast<uint32_t>(child.internalId())).parent;
+    if(parent == ProcessInfo::NO_PROCESS) {
+        return QModelIndex();
+    }
+    return createIndex(static_cast<int>(tree->process(parent).row), 0, static_cast<quintptr>(parent));
+}
+
+int process_tree_model::rowCount(const QModelIndex& parent) const {
+    if(!tree || parent.column() > 0) {
+        return 0;
+    }
+    return static_cast<int>(fetched(process_of(parent)));
+}
+
+int process_tree_model::columnCount(const QModelIndex&) const {
+    return COLUMNS;
+}
+
+bool process_tree_model::hasChildren(const QModelIndex& parent) const {
+    // Before anything's fetched, so unexpanded processes still get an arrow
+    if(!tree || parent.column() > 0) {
+        return false;
+    }
+    return !children(process_of(parent)).empty();
+}
+
+bool process_tree_model::canFetchMore(const QModelIndex& parent) const {
+    if(!tree || parent.column() > 0) {
+        return false;
+    }
+    auto process = process_of(parent);
+    return fetched(process) < children(process).size();
+}
+
+void process_tree_model::fetchMore(const QModelIndex& parent) {
+    if(!canFetchMore(parent)) {
+        return;
+    }
+    // QTreeView asks for more under the last expanded parent once it's scrolled to the bottom
+    fetch_chunk(process_of(parent));
+}
+
+QVariant process_tree_model::data(const QModelIndex& index, int role) const {
+    if(!tree || !index.isValid()) {
+        return QVariant();
+    }
+    const auto& process = tree->process(static_cast<uint32_t>(index.internalId()));
+    if(role == Qt::TextAlignmentRole) {
+        if(index.column() >= 1 && index.column() <= 4) {
+            return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        return QVariant();
+    }
+    if(role == Qt::ForegroundRole) {
+        if((process.exit_code && *process.exit_code != 0) || (process.signal_mask & BAD_SIGNALS)) {
+            return QColor(Qt::red);
+        }
+        return QVariant();
+    }
+    if(role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch(index.column()) {
+    case 0:
+        return static_cast<qulonglong>(process.pid);
+    case 1:
+        return static_cast<qulonglong>(process.events);
+    case 2:
+        return process.events > 0 ? QVariant(static_cast<qulonglong>(process.first)) : QVariant();
+    case 3:
+        return process.events > 0 ? QVariant(static_cast<qulonglong>(process.last)) : QVariant();
+    case 4:
+        return process.exit_code ? QVariant(static_cast<qlonglong>(*process.exit_code)) : QVariant();
+    case 5:
+        return signal_names(process.signal_mask);
+    default:
+        return QVariant();
+    }
+}
+
+QVariant process_tree_model::headerData(int section, Qt::Orientation orientation, int role) const {
+    static const char* const names[COLUMNS] = {"Pid", "Events", "First", "Last", "Exit code", "Signals"};
+    if(orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= COLUMNS) {
+        return QVariant();
+    }
+    return QString(names[section]);
+}
+
+process_panel::process_panel(QWidget* parent):
+    QWidget(parent)
+{
+    model = new process_tree_model(this);
+    view = new QTreeView(this);
+    view->setUniformRowHeights(true);
+    view->setModel(model);
+    view->header()->setStretchLastSection(true);
+    auto layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(view);
+
+    connect(view->selectionModel(), &QItemSelectionModel::currentChanged, this, [this](const QModelIndex& current) {
+        auto node = model->first_node(current);
+        if(node >= 0) {
+            emit process_selected(node);
+        }
+    });
+}
+
+void process_panel::set_tree(ProcessSnapshot tree) {
+    model->set_tree(std::move(tree));
+}
+
+void process_panel::clear() {
+    model->clear();
+}
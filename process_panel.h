@@ -0,0 +1,71 @@
+#ifndef PROCESS_PANEL_H
+#define PROCESS_PANEL_H
+
+#include <QAbstractItemModel>
+#include <QTreeView>
+#include <QWidget>
+#include <cstdint>
+#include <vector>
+#include "process_worker.h"
+
+// The process tree for a QTreeView. Children only become rows once their parent is expanded
+// and they come in a chunk at a time as they're scrolled to, so a tree of tens of thousands
+// of processes costs nothing until it's looked at. A new snapshot of the same load
+// only appends to what's been fetched, unless the tree was reshaped.
+class process_tree_model: public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    explicit process_tree_model(QObject* parent = nullptr);
+
+    void set_tree(ProcessSnapshot snapshot);
+
+    void clear();
+
+    // First node of the process at index, -1 if it has no events
+    qint64 first_node(const QModelIndex& index) const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+private:
+    // Process the rows under parent are children of, NO_PROCESS for the roots
+    uint32_t process_of(const QModelIndex& parent) const;
+    const std::vector<uint32_t>& children(uint32_t process) const;
+    uint32_t& fetched(uint32_t process);
+    uint32_t fetched(uint32_t process) const;
+    void append(uint32_t process, uint32_t count);
+    void fetch_chunk(uint32_t process);
+
+    ProcessSnapshot tree;
+    // Rows fetched under each process and under the root
+    std::vector<uint32_t> fetched_children;
+    uint32_t fetched_roots = 0;
+    // Processes with any children fetched, in the order they were first fetched
+    std::vector<uint32_t> expanded;
+};
+
+// Every process in the log as a tree of who forked who, selecting one shows where it starts
+class process_panel: public QWidget
+{
+    Q_OBJECT
+public:
+    explicit process_panel(QWidget* parent = nullptr);
+
+    void set_tree(ProcessSnapshot tree);
+
+    void clear();
+signals:
+    void process_selected(qint64 first_node);
+private:
+    process_tree_model* model;
+    QTreeView* view;
+};
+
+#endif // PROCESS_PANEL_H
@@ -0,0 +1,123 @@
+#include "process_tree.h"
+#include <QStringList>
+#include <algorithm>
+
+void ProcessTree::clear() {
+    processes.clear();
+    by_pid.clear();
+    root_processes.clear();
+    reshape_count = 0;
+    node_count = 0;
+}
+
+uint32_t ProcessTree::find_or_add(uint32_t pid, uint32_t parent) {
+    auto it = by_pid.find(pid);
+    if(it != by_pid.end()) {
+        return it->second;
+    }
+    auto index = static_cast<uint32_t>(processes.size());
+    auto& siblings = parent == ProcessInfo::NO_PROCESS ? root_processes : processes[parent].children;
+    ProcessInfo process;
+    process.pid = pid;
+    process.parent = parent;
+    process.row = static_cast<uint32_t>(siblings.size());
+    siblings.push_back(index);
+    processes.push_back(std::move(process));
+    by_pid.emplace(pid, index);
+    return index;
+}
+
+bool ProcessTree::is_ancestor(uint32_t process, uint32_t of) const {
+    for(auto i = of; i != ProcessInfo::NO_PROCESS; i = processes[i].parent) {
+        if(i == process) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProcessTree::adopt(uint32_t parent, uint32_t child) {
+    auto& adopted = processes[child];
+    reshape_count++;
+    root_processes.erase(root_processes.begin() + adopted.row);
+    for(auto row = adopted.row; row < root_processes.size(); row++) {
+        processes[root_processes[row]].row = row;
+    }
+    adopted.parent = parent;
+    adopted.row = static_cast<uint32_t>(processes[parent].children.size());
+    processes[parent].children.push_back(child);
+}
+
+void ProcessTree::add(const EventStore& batch, size_t first_node) {
+    node_count = first_node;
+    for(size_t row=0; row<batch.size(); row++) {
+        auto kind = batch.kind(row);
+        if(kind == EventKind::marker) {
+            continue;
+        }
+        auto node = static_cast<uint32_t>(node_count++);
+        if(kind != EventKind::trace) {
+            continue;
+        }
+        auto pid = batch.pid(row);
+        if(!pid) {
+            continue;
+        }
+        auto index = find_or_add(static_cast<uint32_t>(*pid));
+        {
+            auto& process = processes[index];
+            process.events++;
+            process.first = std::min(process.first, node);
+            process.last = std::max(process.last, node);
+            if(auto ret = batch.ret(row)) {
+                process.exit_code = static_cast<int64_t>(*ret);
+            }
+            auto signal = batch.signal(row);
+            if(signal && *signal != Signal::unknown) {
+                process.signal_mask |= 1u << static_cast<uint32_t>(*signal);
+            }
+        }
+        auto child = batch.child(row);
+        if(child && *child != *pid) {
+            // The first trace to name a pid is its parent. Normally that's before the child
+            // has any events of its own, if not it's moved out of the roots unless that would
+            // make a loop.
+            auto forked = by_pid.find(static_cast<uint32_t>(*child));
+            if(forked == by_pid.end()) {
+                find_or_add(static_cast<uint32_t>(*child), index);
+            } else if(processes[forked->second].parent == ProcessInfo::NO_PROCESS && !is_ancestor(forked->second, index)) {
+                adopt(index, forked->second);
+            }
+        }
+    }
+}
+
+size_t ProcessTree::nodes() const {
+    return node_count;
+}
+
+size_t ProcessTree::size() const {
+    return processes.size();
+}
+
+const ProcessInfo& ProcessTree::process(uint32_t index) const {
+    return processes[index];
+}
+
+const std::vector<uint32_t>& ProcessTree::roots() const {
+    return root_processes;
+}
+
+uint64_t ProcessTree::reshapes() const {
+    return reshape_count;
+}
+
+QString signal_names(uint32_t mask) {
+    QStringList names;
+    for(size_t s=0; s<static_cast<size_t>(Signal::_length); s++) {
+        if(mask & (1u << s)) {
+            names << sig_to_str(static_cast<Signal>(s));
+        }
+    }
+    return names.join(", ");
+}
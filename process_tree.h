@@ -0,0 +1,67 @@
+#ifndef PROCESS_TREE_H
+#define PROCESS_TREE_H
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "event_store.h"
+
+// One pid and everything the log says about it. A pid that gets reused is still the one process.
+struct ProcessInfo {
+    static constexpr uint32_t NO_PROCESS = UINT32_MAX;
+
+    uint32_t pid = 0;
+    // Index of the process that forked this one
+    uint32_t parent = NO_PROCESS;
+    // Where it is in its parent's children, or in the roots
+    uint32_t row = 0;
+    uint64_t events = 0;
+    // First and last node of the process
+    uint32_t first = UINT32_MAX;
+    uint32_t last = 0;
+    // Return of the last end node
+    std::optional<int64_t> exit_code;
+    // A bit per Signal seen, unknown is left out
+    uint32_t signal_mask = 0;
+    std::vector<uint32_t> children;
+};
+
+// The fork tree of every process in a log, a child being the child of whichever trace named
+// it. Built a batch at a time with nodes numbered the way graphics_view numbers them.
+class ProcessTree {
+public:
+    void clear();
+
+    // Rows are nodes from first_node on, markers aren't nodes so they're skipped
+    void add(const EventStore& batch, size_t first_node);
+
+    // Nodes seen so far, which is where the next batch starts
+    size_t nodes() const;
+
+    size_t size() const;
+
+    const ProcessInfo& process(uint32_t index) const;
+
+    // Processes nothing else forked, in the order they showed up
+    const std::vector<uint32_t>& roots() const;
+
+    // Bumped whenever a process already in the roots gets a parent, which moves it and
+    // renumbers the roots after it. Otherwise processes and children are only ever appended.
+    uint64_t reshapes() const;
+private:
+    uint32_t find_or_add(uint32_t pid, uint32_t parent = ProcessInfo::NO_PROCESS);
+    bool is_ancestor(uint32_t process, uint32_t of) const;
+    void adopt(uint32_t parent, uint32_t child);
+
+    std::vector<ProcessInfo> processes;
+    std::unordered_map<uint32_t, uint32_t> by_pid;
+    std::vector<uint32_t> root_processes;
+    uint64_t reshape_count = 0;
+    size_t node_count = 0;
+};
+
+// Signal names of a ProcessInfo::signal_mask, comma separated
+QString signal_names(uint32_t mask);
+
+#endif // PROCESS_TREE_H
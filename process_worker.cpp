@@ -0,0 +1,34 @@
+#include "process_worker.h"
+
+static constexpr int PUBLISH_INTERVAL_MS = 500;
+
+process_worker::process_worker(QObject* parent):
+    QObject(parent)
+{
+    qRegisterMetaType<ProcessSnapshot>("ProcessSnapshot");
+    // Parented so it moves to the worker's thread along with it
+    publish_timer = new QTimer(this);
+    publish_timer->setSingleShot(true);
+    publish_timer->setInterval(PUBLISH_INTERVAL_MS);
+    connect(publish_timer, &QTimer::timeout, this, &process_worker::publish);
+}
+
+void process_worker::reset(int generation) {
+    current = generation;
+    tree.clear();
+    publish_timer->stop();
+}
+
+void process_worker::add(int generation, EventBatch events) {
+    if(generation != current) {
+        return;
+    }
+    tree.add(*events, tree.nodes());
+    if(!publish_timer->isActive()) {
+        publish_timer->start();
+    }
+}
+
+void process_worker::publish() {
+    emit updated(current, std::make_shared<const ProcessTree>(tree));
+}
@@ -0,0 +1,37 @@
+#ifndef PROCESS_WORKER_H
+#define PROCESS_WORKER_H
+
+#include <QObject>
+#include <QMetaType>
+#include <QTimer>
+#include <memory>
+#include "process_tree.h"
+#include "trace_loader.h"
+
+// A copy of the tree as it was, shared so queued connections don't copy it again
+using ProcessSnapshot = std::shared_ptr<const ProcessTree>;
+Q_DECLARE_METATYPE(ProcessSnapshot)
+
+// Builds the process tree from the same batches the view gets, snapshots go out at most a
+// couple of times a second while a log is loading like location_worker's do
+class process_worker: public QObject
+{
+    Q_OBJECT
+public:
+    explicit process_worker(QObject* parent = nullptr);
+public slots:
+    // Throws the tree away, batches from any other generation are ignored from now on
+    void reset(int generation);
+
+    void add(int generation, EventBatch events);
+signals:
+    void updated(int generation, ProcessSnapshot tree);
+private:
+    void publish();
+
+    ProcessTree tree;
+    QTimer* publish_timer;
+    int current = -1;
+};
+
+#endif // PROCESS_WORKER_H
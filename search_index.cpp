@@ -0,0 +1,134 @@
+#include "search_index.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+static char fold(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static uint32_t trigram(const char* p) {
+    return static_cast<uint8_t>(p[0]) | static_cast<uint8_t>(p[1]) << 8 | static_cast<uint32_t>(static_cast<uint8_t>(p[2])) << 16;
+}
+
+void SearchIndex::clear() {
+    *this = SearchIndex();
+}
+
+size_t SearchIndex::size() const {
+    return nodes;
+}
+
+void SearchIndex::add_term(std::string_view text, size_t node) {
+    if(text.empty()) {
+        return;
+    }
+    auto id = terms.intern(text);
+    if(id >= folded.size()) {
+        folded.resize(id + 1);
+        term_nodes.resize(id + 1);
+        auto& lower = folded[id];
+        lower.resize(text.size());
+        std::transform(text.begin(), text.end(), lower.begin(), fold);
+        std::vector<uint32_t> seen;
+        for(size_t i=0; i+3<=lower.size(); i++) {
+            auto t = trigram(lower.data() + i);
+            if(std::find(seen.begin(), seen.end(), t) == seen.end()) {
+                seen.push_back(t);
+                trigrams[t].push_back(id);
+            }
+        }
+    }
+    auto& list = term_nodes[id];
+    // A node can have the same term twice, like a description that's also its file:line
+    if(list.empty() || list.back() != node) {
+        list.push_back(static_cast<uint32_t>(node));
+    }
+}
+
+void SearchIndex::add(const EventStore& events, size_t row, size_t node) {
+    nodes = node + 1;
+    switch(events.kind(row)) {
+    case EventKind::trace: {
+        add_term(events.strings().bytes(events.description_id(row)), node);
+        if(events.has(row, EventStore::HAS_LOCATION)) {
+            std::string location(events.strings().bytes(events.file_id(row)));
+            location += ':';
+            location += std::to_string(*events.line(row));
+            add_term(location, node);
+        }
+        if(auto addr = events.addr(row)) {
+            char hex[24];
+            auto length = std::snprintf(hex, sizeof(hex), "0x%llx", static_cast<unsigned long long>(*addr));
+            add_term(std::string_view(hex, length), node);
+        }
+        break;
+    }
+    case EventKind::binary:
+        add_term(events.binary(row).path.toUtf8().toStdString(), node);
+        break;
+    case EventKind::config:
+        add_term(events.config(row).name.toUtf8().toStdString(), node);
+        break;
+    default:
+        break;
+    }
+}
+
+std::vector<uint32_t> SearchIndex::find(const QString& text) const {
+    auto utf8 = text.toUtf8();
+    std::string query(utf8.constData(), utf8.size());
+    std::transform(query.begin(), query.end(), query.begin(), fold);
+    std::vector<uint32_t> matches;
+    if(query.empty()) {
+        return matches;
+    }
+
+    // Terms holding every trigram of the query, or all of them if it's too short to have any
+    std::vector<uint32_t> candidates;
+    if(query.size() < 3) {
+        candidates.resize(folded.size());
+        for(uint32_t id=0; id<folded.size(); id++) {
+            candidates[id] = id;
+        }
+    } else {
+        std::vector<const std::vector<uint32_t>*> lists;
+        for(size_t i=0; i+3<=query.size(); i++) {
+            auto found = trigrams.find(trigram(query.data() + i));
+            if(found == trigrams.end()) {
+                return matches;
+            }
+            lists.push_back(&found->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](auto a, auto b) { return a->size() < b->size(); });
+        candidates = *lists.front();
+        for(size_t i=1; i<lists.size() && !candidates.empty(); i++) {
+            std::vector<uint32_t> both;
+            std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(both));
+            candidates.swap(both);
+        }
+    }
+
+    // Matching terms can share nodes so they're gathered in a bitmap, which also sorts them
+    std::vector<uint64_t> hits((nodes + 63) / 64);
+    bool any = false;
+    for(auto id: candidates) {
+        if(folded[id].find(query) == std::string::npos) {
+            continue;
+        }
+        for(auto node: term_nodes[id]) {
+            hits[node / 64] |= uint64_t(1) << (node % 64);
+            any = true;
+        }
+    }
+    if(!any) {
+        return matches;
+    }
+    for(size_t word=0; word<hits.size(); word++) {
+        for(auto bits=hits[word]; bits; bits &= bits - 1) {
+            matches.push_back(static_cast<uint32_t>(word * 64 + qCountTrailingZeroBits(bits)));
+        }
+    }
+    return matches;
+}
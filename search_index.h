@@ -0,0 +1,38 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "event_store.h"
+#include "string_pool.h"
+
+// Case insensitive substring search over the text of every node: descriptions, file:line,
+// addresses as 0x hex, binary paths and config names. Logs repeat the same few thousand of
+// these over and over, so the trigram index is over the distinct terms and each term keeps
+// the nodes it came from. A query only has to check the terms holding all of its trigrams.
+class SearchIndex {
+public:
+    void clear();
+
+    // Row in events, node over the whole trace. Nodes have to be added in order.
+    void add(const EventStore& events, size_t row, size_t node);
+
+    size_t size() const;
+
+    // Every node with a term containing text, in node order
+    std::vector<uint32_t> find(const QString& text) const;
+private:
+    void add_term(std::string_view text, size_t node);
+
+    StringPool terms;
+    // Terms lower cased, indexed by term id
+    std::vector<std::string> folded;
+    std::vector<std::vector<uint32_t>> term_nodes;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+    size_t nodes = 0;
+};
+
+#endif // SEARCH_INDEX_H
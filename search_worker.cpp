@@ -0,0 +1,32 @@
+#include "search_worker.h"
+
+search_worker::search_worker(QObject* parent):
+    QObject(parent)
+{
+    qRegisterMetaType<SearchResults>("SearchResults");
+}
+
+void search_worker::reset(int generation) {
+    current = generation;
+    index.clear();
+    next_node = 0;
+}
+
+void search_worker::add(int generation, EventBatch events) {
+    if(generation != current) {
+        return;
+    }
+    for(size_t row=0; row<events->size(); row++) {
+        if(events->kind(row) != EventKind::marker) {
+            index.add(*events, row, next_node++);
+        }
+    }
+}
+
+void search_worker::find(int generation, const QString& text, int request) {
+    if(generation != current) {
+        emit found(request, std::make_shared<const std::vector<uint32_t>>());
+        return;
+    }
+    emit found(request, std::make_shared<const std::vector<uint32_t>>(index.find(text)));
+}
@@ -0,0 +1,39 @@
+#ifndef SEARCH_WORKER_H
+#define SEARCH_WORKER_H
+
+#include <QObject>
+#include <QMetaType>
+#include <QString>
+#include <memory>
+#include <vector>
+#include "search_index.h"
+#include "trace_loader.h"
+
+// Matching nodes in order, shared so queued connections don't copy them
+using SearchResults = std::shared_ptr<const std::vector<uint32_t>>;
+Q_DECLARE_METATYPE(SearchResults)
+
+// Lives on its own thread and builds the search index from the same batches the view gets,
+// numbering nodes the same way. Queries are answered there too in the order they're asked,
+// against whatever has been indexed so far.
+class search_worker: public QObject
+{
+    Q_OBJECT
+public:
+    explicit search_worker(QObject* parent = nullptr);
+public slots:
+    // Throws the index away, batches from any other generation are ignored from now on
+    void reset(int generation);
+
+    void add(int generation, EventBatch events);
+
+    void find(int generation, const QString& text, int request);
+signals:
+    void found(int request, SearchResults nodes);
+private:
+    SearchIndex index;
+    int current = -1;
+    size_t next_node = 0;
+};
+
+#endif // SEARCH_WORKER_H
@@ -0,0 +1,80 @@
+#include "string_pool.h"
+
+StringPool::StringPool() {
+    intern(std::string_view());
+}
+
+StringPool::StringPool(const StringPool& other):
+    utf8(other.utf8),
+    strings(other.strings)
+{
+    // The keys have to point into our copy of the bytes not the others
+    ids.reserve(utf8.size());
+    for(size_t i=0; i<utf8.size(); i++) {
+        ids.emplace(utf8[i], static_cast<uint32_t>(i));
+    }
+}
+
+StringPool& StringPool::operator=(const StringPool& other) {
+    if(this != &other) {
+        StringPool copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+uint32_t StringPool::intern(std::string_view bytes) {
+    auto existing = ids.find(bytes);
+    if(existing != ids.end()) {
+        return existing->second;
+    }
+    auto id = static_cast<uint32_t>(strings.size());
+    utf8.emplace_back(bytes);
+    strings.push_back(QString::fromUtf8(utf8.back().data(), static_cast<int>(utf8.back().size())));
+    ids.emplace(utf8.back(), id);
+    return id;
+}
+
+uint32_t StringPool::intern(const QString& s) {
+    auto bytes = s.toUtf8();
+    return intern(std::string_view(bytes.constData(), static_cast<size_t>(bytes.size())));
+}
+
+std::optional<uint32_t> StringPool::find(std::string_view bytes) const {
+    auto existing = ids.find(bytes);
+    if(existing == ids.end()) {
+        return std::nullopt;
+    }
+    return existing->second;
+}
+
+const QString& StringPool::get(uint32_t id) const {
+    return strings[id];
+}
+
+std::string_view StringPool::bytes(uint32_t id) const {
+    return utf8[id];
+}
+
+size_t StringPool::size() const {
+    return strings.size();
+}
+
+void StringPool::replace(uint32_t id, std::string_view bytes) {
+    auto existing = ids.find(utf8[id]);
+    if(existing != ids.end() && existing->second == id) {
+        ids.erase(existing);
+    }
+    utf8[id] = std::string(bytes);
+    strings[id] = QString::fromUtf8(utf8[id].data(), static_cast<int>(utf8[id].size()));
+    ids.emplace(utf8[id], id);
+}
+
+std::vector<uint32_t> StringPool::merge(const StringPool& other) {
+    std::vector<uint32_t> mapping;
+    mapping.reserve(other.size());
+    for(const auto& s: other.utf8) {
+        mapping.push_back(intern(std::string_view(s)));
+    }
+    return mapping;
+}
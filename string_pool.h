@@ -0,0 +1,54 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <QString>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Deduplicates strings and hands out 32 bit ids for them. Lookups go by the raw UTF-8
+// bytes so the parser can intern straight from its input, a QString is only made the
+// first time a string is seen. Id 0 is always the empty string.
+class StringPool {
+public:
+    StringPool();
+
+    StringPool(const StringPool& other);
+
+    StringPool(StringPool&& other) = default;
+
+    StringPool& operator=(const StringPool& other);
+
+    StringPool& operator=(StringPool&& other) = default;
+
+    uint32_t intern(std::string_view utf8);
+
+    uint32_t intern(const QString& s);
+
+    // Id of a string that's already been interned, without adding it
+    std::optional<uint32_t> find(std::string_view utf8) const;
+
+    const QString& get(uint32_t id) const;
+
+    std::string_view bytes(uint32_t id) const;
+
+    size_t size() const;
+
+    // Interns everything in other, the result maps ids in other to ids in this pool
+    std::vector<uint32_t> merge(const StringPool& other);
+
+    // Changes the string behind an id. If the new one was already in the pool lookups
+    // still find the older id for it.
+    void replace(uint32_t id, std::string_view utf8);
+private:
+    // A deque so the string_views used as keys stay put as it grows
+    std::deque<std::string> utf8;
+    std::vector<QString> strings;
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+#endif // STRING_POOL_H
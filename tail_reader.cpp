@@ -0,0 +1,251 @@
+#include "tail_reader.h"
+#include <QDebug>
+#include <QFile>
+#include <algorithm>
+
+// Decoded events are handed over after every read so a big catch up doesn't pile up
+static constexpr qint64 READ_CHUNK = 4 << 20;
+
+TailReader::TailReader(const QString& path):
+    path(path)
+{
+}
+
+bool TailReader::complete() const {
+    return state == State::done;
+}
+
+qint64 TailReader::offset() const {
+    return file_offset - pending.size();
+}
+
+size_t TailReader::events_read() const {
+    return event_count;
+}
+
+QString TailReader::error() const {
+    return error_message;
+}
+
+QDir TailReader::root() const {
+    return root_dir;
+}
+
+bool TailReader::rooted_late() const {
+    return late_root;
+}
+
+bool TailReader::poll(const EventSink& sink) {
+    if(state == State::done) {
+        return true;
+    }
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)) {
+        error_message = QString("Couldn't open %1").arg(path);
+        return false;
+    }
+    auto size = file.size();
+    if(size < file_offset) {
+        error_message = "Log got shorter, it's probably been replaced";
+        return false;
+    }
+    if(!file.seek(file_offset)) {
+        error_message = file.errorString();
+        return false;
+    }
+    EventStore events;
+    while(file_offset < size && state != State::done) {
+        auto chunk = file.read(std::min(READ_CHUNK, size - file_offset));
+        if(chunk.isEmpty()) {
+            break;
+        }
+        file_offset += chunk.size();
+        pending.append(chunk);
+        bool failed = false;
+        if(state == State::start) {
+            pending.remove(0, find_events(failed));
+        }
+        if(state == State::events && !failed) {
+            pending.remove(0, decode_events(events, failed));
+        }
+        if(state == State::rest && !failed) {
+            pending.remove(0, find_manifest(failed));
+        }
+        if(!events.empty()) {
+            event_count += events.size();
+            sink(events);
+            events.clear();
+        }
+        if(failed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+qsizetype TailReader::find_events(bool& failed) {
+    auto begin = pending.constData();
+    auto end = begin + pending.size();
+    auto p = skip_whitespace(begin, end);
+    if(p == end) {
+        return 0;
+    } else if(*p != '{') {
+        error_message = "Not a tarpaulin event log";
+        failed = true;
+        return 0;
+    }
+    // Anything that runs off the end of what's been read so far just waits for more
+    p = skip_whitespace(p + 1, end);
+    while(p != end) {
+        if(*p != '"') {
+            break;
+        }
+        auto key_end = skip_string(p, end);
+        if(!key_end) {
+            return 0;
+        }
+        std::string_view key(p + 1, key_end - p - 2);
+        p = skip_whitespace(key_end, end);
+        if(p == end) {
+            return 0;
+        } else if(*p != ':') {
+            break;
+        }
+        p = skip_whitespace(p + 1, end);
+        if(p == end) {
+            return 0;
+        }
+        if(key == "events") {
+            if(*p != '[') {
+                break;
+            }
+            decoder.emplace(have_root ? root_dir.path() : QString());
+            state = State::events;
+            return p + 1 - begin;
+        }
+        auto value = p;
+        auto result = scan_value(p, end);
+        if(result == Scan::partial) {
+            return 0;
+        } else if(result == Scan::invalid) {
+            break;
+        }
+        if(key == "manifest_paths") {
+            root_dir = choose_root(parse_manifest(value, p));
+            have_root = true;
+        }
+        p = skip_whitespace(p, end);
+        if(p == end) {
+            return 0;
+        } else if(*p != ',') {
+            break;
+        }
+        p = skip_whitespace(p + 1, end);
+    }
+    if(p == end) {
+        return 0;
+    }
+    error_message = "No events in log";
+    failed = true;
+    return 0;
+}
+
+qsizetype TailReader::decode_events(EventStore& events, bool& failed) {
+    auto begin = pending.constData();
+    auto end = begin + pending.size();
+    auto p = begin;
+    auto used = begin;
+    while(true) {
+        p = skip_whitespace(p, end);
+        if(p == end) {
+            break;
+        }
+        if(*p == ']') {
+            state = State::rest;
+            used = p + 1;
+            break;
+        }
+        if(after_element) {
+            if(*p != ',') {
+                error_message = QString("Invalid JSON after %1 events").arg(event_count + events.size());
+                failed = true;
+                break;
+            }
+            after_element = false;
+            used = ++p;
+            continue;
+        }
+        auto value_end = p;
+        auto result = scan_value(value_end, end);
+        if(result == Scan::partial) {
+            break;
+        } else if(result == Scan::invalid) {
+            error_message = QString("Invalid JSON after %1 events").arg(event_count + events.size());
+            failed = true;
+            break;
+        }
+        if(!decoder->decode(p, value_end, events)) {
+            qDebug()<<"Skipping malformed event after"<<event_count + events.size()<<"events";
+        }
+        after_element = true;
+        p = value_end;
+        used = p;
+    }
+    return used - begin;
+}
+
+qsizetype TailReader::find_manifest(bool& failed) {
+    auto begin = pending.constData();
+    auto end = begin + pending.size();
+    auto p = begin;
+    auto used = begin;
+    // Each member after the events is only used up once it's all there
+    while(true) {
+        p = skip_whitespace(p, end);
+        if(p == end) {
+            break;
+        } else if(*p == '}') {
+            state = State::done;
+            used = p + 1;
+            break;
+        } else if(*p != ',') {
+            error_message = "Invalid JSON after the events";
+            failed = true;
+            break;
+        }
+        p = skip_whitespace(p + 1, end);
+        if(p == end) {
+            break;
+        }
+        auto key_end = skip_string(p, end);
+        if(!key_end) {
+            break;
+        }
+        std::string_view key(p + 1, key_end - p - 2);
+        p = skip_whitespace(key_end, end);
+        if(p == end) {
+            break;
+        } else if(*p != ':') {
+            error_message = "Invalid JSON after the events";
+            failed = true;
+            break;
+        }
+        auto value = skip_whitespace(p + 1, end);
+        p = value;
+        auto result = scan_value(p, end);
+        if(result == Scan::partial) {
+            break;
+        } else if(result == Scan::invalid) {
+            error_message = "Invalid JSON after the events";
+            failed = true;
+            break;
+        }
+        if(key == "manifest_paths" && !have_root) {
+            root_dir = choose_root(parse_manifest(value, p));
+            have_root = true;
+            late_root = true;
+        }
+        used = p;
+    }
+    return used - begin;
+}
@@ -0,0 +1,67 @@
+#ifndef TAIL_READER_H
+#define TAIL_READER_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QString>
+#include "event_reader.h"
+#include <optional>
+
+// Follows a log that's still being written. Every poll reads what's been added since the
+// last one and decodes the complete elements of the events array, only holding on to the
+// bytes of an element that's still being written, so nothing is ever read or decoded twice.
+// manifest_paths is written last so paths are kept as they're written until the log is
+// finished, they can be made relative to root() then.
+class TailReader {
+public:
+    explicit TailReader(const QString& path);
+
+    // Returns false if the file can't be followed any more, like when it's been replaced
+    // with something shorter. Returns true with no events when nothing new has been written.
+    bool poll(const EventSink& sink);
+
+    // The events array has been closed so there won't be any more events
+    bool complete() const;
+
+    // Bytes of the file that have been dealt with
+    qint64 offset() const;
+
+    size_t events_read() const;
+
+    QString error() const;
+
+    QDir root() const;
+
+    // manifest_paths only turned up after the events, so every path handed over is still as
+    // it was written and should go through EventStore::reroot_files
+    bool rooted_late() const;
+private:
+    enum class State {
+        start,
+        events,
+        // After the events array, looking for manifest_paths
+        rest,
+        done
+    };
+
+    // Each returns how much of pending it used up
+    qsizetype find_events(bool& failed);
+    qsizetype decode_events(EventStore& events, bool& failed);
+    qsizetype find_manifest(bool& failed);
+
+    QString path;
+    QDir root_dir;
+    bool have_root = false;
+    bool late_root = false;
+    // Made once the events array is found, in case manifest_paths came before it
+    std::optional<EventDecoder> decoder;
+    State state = State::start;
+    // Whether the next thing in the events array should be a comma or the closing bracket
+    bool after_element = false;
+    QByteArray pending;
+    qint64 file_offset = 0;
+    size_t event_count = 0;
+    QString error_message;
+};
+
+#endif // TAIL_READER_H
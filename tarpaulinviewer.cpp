@@ -2,86 +2,13 @@
 #include "./ui_tarpaulinviewer.h"
 #include <QPushButton>
 #include <QFileDialog>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonValueRef>
+#include <QMenuBar>
+#include <QStatusBar>
+#include <QSignalBlocker>
+#include <algorithm>
 #include <QDebug>
 #include "types.h"
 
-TraceEvent json_to_trace(const QJsonObject obj, const QDir& root) {
-    TraceEvent event;
-    auto pid = obj.find("pid");
-    if(pid != obj.end() && !pid->isNull()) {
-        event.pid = pid->toInt();
-    }
-    auto child = obj.find("child");
-    if(child != obj.end() && !child->isNull()) {
-        event.child = child->toInt();
-    }
-    auto signal = obj.find("signal");
-    if(signal != obj.end() && !signal->isNull()) {
-        event.signal = str_to_sig(signal->toString());
-    }
-    auto addr = obj.find("addr");
-    if(addr != obj.end() && !addr->isNull()) {
-        event.addr = (uint64_t)addr->toDouble();
-        auto location = obj.find("location");
-        if(location != obj.end() && !location->isNull()) {
-            auto loc = location->toObject();
-            // if we have a location we have a file and a line
-            auto file = root.relativeFilePath(loc.find("file")->toString());
-            auto line = (int)loc.find("line")->toDouble();
-            event.file = file;
-            event.line = line;
-        }
-    }
-    auto ret = obj.find("return_val");
-    if(ret != obj.end() && !ret->isNull()) {
-        event.ret = ret->toInt();
-    }
-    event.description = obj.find("description")->toString();
-    return event;
-}
-
-TestBinary json_to_bin(const QJsonObject obj, const QDir& root) {
-    TestBinary bin;
-    QString file = root.relativeFilePath(obj.find("path")->toString());
-    if(!file.isEmpty()) {
-        file = file.split("/").last();
-    }
-    bin.path = file;
-    bin.should_panic = obj.find("should_panic")->toBool();
-    auto ty = obj.find("ty");
-    if(ty != obj.end()) {
-        QString tyname = ty->toString();
-        RunType type = RunType::Tests;
-        if(tyname == "Doctests") {
-            type = RunType::Doctests;
-        } else if(tyname == "Benchmarks") {
-            type = RunType::Benchmarks;
-        } else if(tyname == "Examples") {
-            type = RunType::Examples;
-        } else if(tyname == "Lib") {
-            type = RunType::Lib;
-        } else if(tyname == "Bins") {
-            type = RunType::Bins;
-        } else if(tyname == "AllTargets") {
-            type = RunType::AllTargets;
-        }
-        bin.ty = type;
-    }
-    auto dir = obj.find("cargo_dir");
-    if(dir != obj.end()) {
-        bin.cargo_dir = dir->toString();
-    }
-    auto name = obj.find("pkg_name");
-    if(name != obj.end()) {
-        bin.pkg_name = name->toString();
-    }
-    return bin;
-}
-
 TarpaulinViewer::TarpaulinViewer(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::TarpaulinViewer)
@@ -89,67 +16,563 @@ TarpaulinViewer::TarpaulinViewer(QWidget *parent)
     ui->setupUi(this);
     scene = new QGraphicsScene(this);
     ui->graphicsView->setScene(scene);
+    ui->compareView->setScene(new QGraphicsScene(this));
+    ui->compareView->hide();
+
+    progress = new QProgressBar(this);
+    progress->setMaximumWidth(200);
+    progress->hide();
+    cancel = new QPushButton("Cancel", this);
+    cancel->hide();
+    // Which failures F and Shift+F jump between, with how many there are of each
+    failure_kinds = new QComboBox(this);
+    failure_kinds->setFocusPolicy(Qt::NoFocus);
+    update_failures();
+    // Enter or N jump to the next match, Shift+N back to the previous one
+    search_box = new QLineEdit(this);
+    search_box->setPlaceholderText("Search");
+    search_box->setClearButtonEnabled(true);
+    search_box->setMaximumWidth(250);
+    search_count = new QLabel(this);
+    statusBar()->addPermanentWidget(search_box);
+    statusBar()->addPermanentWidget(search_count);
+    statusBar()->addPermanentWidget(failure_kinds);
+    statusBar()->addPermanentWidget(progress);
+    statusBar()->addPermanentWidget(cancel);
+
+    loader_thread = new QThread(this);
+    loader_thread->setObjectName("loader");
+    loader = new trace_loader();
+    loader->set_phase_log(&phases);
+    loader->moveToThread(loader_thread);
+    connect(loader_thread, &QThread::finished, loader, &QObject::deleteLater);
+    connect(this, &TarpaulinViewer::request_load, loader, &trace_loader::load);
+    connect(this, &TarpaulinViewer::request_follow, loader, &trace_loader::follow);
+    connect(loader, &trace_loader::events_ready, this, &TarpaulinViewer::events_loaded);
+    connect(loader, &trace_loader::progress, this, &TarpaulinViewer::load_progress);
+    connect(loader, &trace_loader::finished, this, &TarpaulinViewer::load_finished);
+    connect(loader, &trace_loader::restarted, this, &TarpaulinViewer::load_restarted);
+    connect(loader, &trace_loader::root_found, this, &TarpaulinViewer::load_rooted);
+    loader_thread->start();
+
+    search_thread = new QThread(this);
+    search_thread->setObjectName("search");
+    searcher = new search_worker();
+    searcher->moveToThread(search_thread);
+    connect(search_thread, &QThread::finished, searcher, &QObject::deleteLater);
+    connect(loader, &trace_loader::events_ready, searcher, &search_worker::add);
+    connect(this, &TarpaulinViewer::reset_search, searcher, &search_worker::reset);
+    // Straight from the loader so it lands between the right batches
+    connect(loader, &trace_loader::restarted, searcher, &search_worker::reset);
+    connect(this, &TarpaulinViewer::request_search, searcher, &search_worker::find);
+    connect(searcher, &search_worker::found, this, &TarpaulinViewer::search_found);
+    search_thread->start();
+
+    // Source locations are counted on their own thread so a big log doesn't hold up search
+    location_thread = new QThread(this);
+    location_thread->setObjectName("locations");
+    location_counter = new location_worker();
+    location_counter->moveToThread(location_thread);
+    connect(location_thread, &QThread::finished, location_counter, &QObject::deleteLater);
+    connect(loader, &trace_loader::events_ready, location_counter, &location_worker::add);
+    connect(this, &TarpaulinViewer::reset_locations, location_counter, &location_worker::reset);
+    connect(loader, &trace_loader::restarted, location_counter, &location_worker::reset);
+    connect(loader, &trace_loader::root_found, location_counter, &location_worker::reroot);
+    connect(location_counter, &location_worker::updated, this, &TarpaulinViewer::locations_updated);
+    connect(this, &TarpaulinViewer::request_location, location_counter, &location_worker::find);
+    connect(location_counter, &location_worker::found, this, &TarpaulinViewer::location_found);
+    process_counter = new process_worker();
+    process_counter->moveToThread(location_thread);
+    connect(location_thread, &QThread::finished, process_counter, &QObject::deleteLater);
+    connect(loader, &trace_loader::events_ready, process_counter, &process_worker::add);
+    connect(this, &TarpaulinViewer::reset_processes, process_counter, &process_worker::reset);
+    connect(loader, &trace_loader::restarted, process_counter, &process_worker::reset);
+    connect(process_counter, &process_worker::updated, this, &TarpaulinViewer::processes_updated);
+    location_thread->start();
+
+    compare_thread = new QThread(this);
+    compare_thread->setObjectName("compare loader");
+    compare_loader = new trace_loader();
+    compare_loader->moveToThread(compare_thread);
+    connect(compare_thread, &QThread::finished, compare_loader, &QObject::deleteLater);
+    connect(this, &TarpaulinViewer::request_compare_load, compare_loader, &trace_loader::load);
+    connect(compare_loader, &trace_loader::events_ready, this, &TarpaulinViewer::compare_events_loaded);
+    connect(compare_loader, &trace_loader::finished, this, &TarpaulinViewer::compare_finished);
+    connect(compare_loader, &trace_loader::restarted, this, &TarpaulinViewer::compare_restarted);
+    connect(compare_loader, &trace_loader::root_found, this, &TarpaulinViewer::compare_rooted);
+    compare_thread->start();
+
+    // Both logs are fed to the differ as they load so only the diff itself waits for the end
+    diff_thread = new QThread(this);
+    diff_thread->setObjectName("diff");
+    differ = new diff_worker();
+    differ->moveToThread(diff_thread);
+    connect(diff_thread, &QThread::finished, differ, &QObject::deleteLater);
+    connect(loader, &trace_loader::events_ready, differ, &diff_worker::add_left);
+    connect(compare_loader, &trace_loader::events_ready, differ, &diff_worker::add_right);
+    connect(loader, &trace_loader::restarted, differ, &diff_worker::restart_left);
+    connect(compare_loader, &trace_loader::restarted, differ, &diff_worker::restart_right);
+    connect(loader, &trace_loader::root_found, differ, &diff_worker::reroot_left);
+    connect(compare_loader, &trace_loader::root_found, differ, &diff_worker::reroot_right);
+    connect(this, &TarpaulinViewer::reset_diff, differ, &diff_worker::reset);
+    connect(this, &TarpaulinViewer::request_diff, differ, &diff_worker::compare);
+    connect(differ, &diff_worker::compared, this, &TarpaulinViewer::diff_found);
+    diff_thread->start();
+
+    export_thread = new QThread(this);
+    export_thread->setObjectName("export");
+    exporter = new export_worker();
+    exporter->moveToThread(export_thread);
+    connect(export_thread, &QThread::finished, exporter, &QObject::deleteLater);
+    connect(this, &TarpaulinViewer::request_svg, exporter, &export_worker::write_svg);
+    connect(this, &TarpaulinViewer::request_png, exporter, &export_worker::write_png);
+    connect(exporter, &export_worker::finished, this, &TarpaulinViewer::export_finished);
+    export_thread->start();
+
+    // Selecting an event in either run selects the one it lines up with in the other
+    connect(ui->graphicsView, &graphics_view::node_selected, this, [this](qint64 node) {
+        show_matching(ui->graphicsView, ui->compareView, node);
+    });
+    connect(ui->compareView, &graphics_view::node_selected, this, [this](qint64 node) {
+        show_matching(ui->compareView, ui->graphicsView, node);
+    });
+
+    locations = new location_panel(this);
+    connect(locations, &location_panel::line_activated, this, &TarpaulinViewer::show_location);
+    locations_dock = new QDockWidget("Source locations", this);
+    locations_dock->setObjectName("locations");
+    locations_dock->setWidget(locations);
+    addDockWidget(Qt::RightDockWidgetArea, locations_dock);
+    locations_dock->hide();
+
+    processes = new process_panel(this);
+    connect(processes, &process_panel::process_selected, this, [this](qint64 node) {
+        ui->graphicsView->show_node(static_cast<size_t>(node));
+    });
+    processes_dock = new QDockWidget("Processes", this);
+    processes_dock->setObjectName("processes");
+    processes_dock->setWidget(processes);
+    addDockWidget(Qt::LeftDockWidgetArea, processes_dock);
+    processes_dock->hide();
+
+    ui->graphicsView->set_phase_log(&phases);
+    auto tools = menuBar()->addMenu("Tools");
+    tools->addAction(locations_dock->toggleViewAction());
+    tools->addAction(processes_dock->toggleViewAction());
+    tools->addAction("Compare two logs...", this, &TarpaulinViewer::compare_traces);
+    tools->addAction("Export SVG...", this, &TarpaulinViewer::export_svg);
+    tools->addAction("Export PNG tiles...", this, &TarpaulinViewer::export_png);
+    tools->addAction("Save load timings...", this, &TarpaulinViewer::save_timings);
 
     connect(ui->reset, &QPushButton::pressed, ui->graphicsView, &graphics_view::reset);
     connect(ui->load, &QPushButton::pressed, this, &TarpaulinViewer::load_traces);
+    connect(ui->follow, &QPushButton::pressed, this, &TarpaulinViewer::follow_traces);
+    connect(cancel, &QPushButton::pressed, this, &TarpaulinViewer::cancel_load);
+    connect(failure_kinds, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &TarpaulinViewer::failure_filter_changed);
+    connect(search_box, &QLineEdit::textChanged, this, [this]() { search(false); });
+    connect(search_box, &QLineEdit::returnPressed, this, [this]() { search(true); });
 }
 
 TarpaulinViewer::~TarpaulinViewer()
 {
+    loader->cancel();
+    compare_loader->cancel();
+    search_thread->quit();
+    search_thread->wait();
+    location_thread->quit();
+    location_thread->wait();
+    diff_thread->quit();
+    diff_thread->wait();
+    // An export that's running is left to finish rather than leave half a file behind
+    export_thread->quit();
+    export_thread->wait();
+    compare_thread->quit();
+    compare_thread->wait();
+    loader_thread->quit();
+    loader_thread->wait();
     delete ui;
 }
 
 void TarpaulinViewer::load_traces() {
-    auto trace_file = QFileDialog::getOpenFileName(this, "Load traces", QString(), "Traces (*.json)");
-    QFile input(trace_file);
-    input.open(QIODevice::ReadOnly | QIODevice::Text);
-    QByteArray data = input.readAll();
-    input.close();
-
-    QJsonParseError err;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &err);
-    if(doc.isNull()) {
-        qDebug() << "Parsing failed";
-    }
-    QJsonObject root = doc.object();
-    QDir root_path;
-    QJsonArray paths = root.value("manifest_paths").toArray();
-    for(const QJsonValue& root: paths) {
-        auto tmp = QDir(root.toString());
-        if(root_path == QDir::currentPath() || tmp.count() < root_path.count()) {
-            root_path = tmp;
-        }
+    auto trace_file = QFileDialog::getOpenFileName(this, "Load traces", QString(), "Traces (*.json *.json.gz *.json.zst);;All files (*)");
+    if(!trace_file.isEmpty()) {
+        start_load(trace_file, false);
+    }
+}
+
+void TarpaulinViewer::follow_traces() {
+    auto trace_file = QFileDialog::getOpenFileName(this, "Follow traces", QString(), "Traces (*.json)");
+    if(!trace_file.isEmpty()) {
+        start_load(trace_file, true);
+    }
+}
+
+void TarpaulinViewer::compare_traces() {
+    auto before = QFileDialog::getOpenFileName(this, "Compare traces from", QString(), "Traces (*.json *.json.gz *.json.zst);;All files (*)");
+    if(before.isEmpty()) {
+        return;
+    }
+    auto after = QFileDialog::getOpenFileName(this, "Compare traces to", QString(), "Traces (*.json *.json.gz *.json.zst);;All files (*)");
+    if(!after.isEmpty()) {
+        start_load(before, false, after);
+    }
+}
+
+void TarpaulinViewer::start_load(const QString& path, bool follow, const QString& compare_path) {
+    // Starting a new load cancels anything still running
+    generation = loader->next_generation();
+    following = follow;
+    phases.clear();
+    current_load = generation;
+    loaded_path = path;
+    if(compare_path.isEmpty()) {
+        compare_loader->cancel();
+        compare_generation = -1;
+    } else {
+        compare_generation = compare_loader->next_generation();
+    }
+    compare_loading = !compare_path.isEmpty();
+    left_loaded = false;
+    right_loaded = false;
+    // Queued ahead of the loads first batch so none of its batches are missed
+    emit reset_search(generation);
+    emit reset_locations(generation);
+    emit reset_processes(generation);
+    emit reset_diff(compare_loading ? generation : -1, compare_generation);
+    search_count->clear();
+    locations->clear();
+    processes->clear();
+    ui->graphicsView->begin_scene();
+    progress->setRange(0, 100);
+    progress->setValue(0);
+    progress->show();
+    cancel->show();
+    if(follow) {
+        statusBar()->showMessage(QString("Following %1").arg(path));
+        emit request_follow(path, generation);
+    } else {
+        statusBar()->showMessage(QString("Loading %1").arg(path));
+        emit request_load(path, generation);
     }
-    QJsonArray events = root.value("events").toArray();
-    std::vector<std::shared_ptr<Event>> parsed_events;
-    for(const QJsonValue& event: events) {
-        // Event is either: ConfigLaunch, BinaryLaunch, Trace
-        auto obj = event.toObject();
-        for(auto entry = obj.begin(); entry!=obj.end(); ++entry) {
-            if(entry.key() == "ConfigLaunch") {
-                auto conf = Config { entry.value().toString()};
-                parsed_events.push_back(std::make_shared<Event>(conf));
-            } else if(entry.key() == "BinaryLaunch") {
-                TestBinary bin = json_to_bin(entry.value().toObject(), root_path);
-                parsed_events.push_back(std::make_shared<Event>(bin));
-            } else if(entry.key() == "Trace") {
-                TraceEvent event = json_to_trace(entry.value().toObject(), root_path);
-                parsed_events.push_back(std::make_shared<Event>(event));
-            } else if(entry.key() == "Marker") {
-                Marker m{};
-                parsed_events.push_back(std::make_shared<Event>(m));
-            }
+    if(compare_loading) {
+        ui->compareView->begin_scene();
+        ui->compareView->show();
+        emit request_compare_load(compare_path, compare_generation);
+    } else {
+        ui->compareView->hide();
+    }
+}
+
+void TarpaulinViewer::cancel_load() {
+    loader->cancel();
+    if(compare_loading) {
+        compare_loader->cancel();
+        compare_loading = false;
+        compare_generation = -1;
+        ui->compareView->finish_scene();
+    }
+    auto was_following = following;
+    end_load();
+    statusBar()->showMessage(was_following ? "Stopped following" : "Load cancelled");
+}
+
+void TarpaulinViewer::events_loaded(int load, EventBatch events) {
+    if(load != generation) {
+        return;
+    }
+    // Stay at the end while following unless the view's been moved away from it
+    auto at_end = following && ui->graphicsView->showing_end();
+    ui->graphicsView->append_events(*events);
+    if(at_end) {
+        ui->graphicsView->scroll_to_end();
+    }
+    update_failures();
+}
+
+void TarpaulinViewer::load_progress(int load, qint64 done, qint64 total) {
+    if(load != generation) {
+        return;
+    }
+    if(total > 0) {
+        progress->setValue(static_cast<int>(done * 100 / total));
+    } else {
+        // Don't know how big it is so just show that something is happening
+        progress->setRange(0, 0);
+    }
+}
+
+void TarpaulinViewer::load_finished(int load, bool success, const QString& message) {
+    if(load != generation) {
+        return;
+    }
+    end_load();
+    if(!success) {
+        qDebug() << "Parsing failed" << message;
+    }
+    auto elapsed = phases.now() / 1e9;
+    statusBar()->showMessage(QString("%1 in %2s (%3)").arg(message).arg(elapsed, 0, 'f', 2).arg(phases.summary()));
+    left_loaded = success;
+    diff_when_loaded();
+}
+
+void TarpaulinViewer::load_restarted(int load) {
+    if(load != generation) {
+        return;
+    }
+    // The workers were told by the loader itself, only what's on screen is left
+    search_count->clear();
+    locations->clear();
+    processes->clear();
+    ui->graphicsView->begin_scene();
+    update_failures();
+    statusBar()->showMessage("Cached copy was damaged, loading the log again");
+}
+
+void TarpaulinViewer::load_rooted(int load, const QString& root) {
+    if(load != generation) {
+        return;
+    }
+    ui->graphicsView->reroot_files(QDir(root));
+}
+
+void TarpaulinViewer::compare_events_loaded(int load, EventBatch events) {
+    if(load != compare_generation || !compare_loading) {
+        return;
+    }
+    ui->compareView->append_events(*events);
+}
+
+void TarpaulinViewer::compare_finished(int load, bool success, const QString& message) {
+    if(load != compare_generation || !compare_loading) {
+        return;
+    }
+    compare_loading = false;
+    ui->compareView->finish_scene();
+    if(!success) {
+        qDebug() << "Parsing failed" << message;
+        statusBar()->showMessage(QString("Couldn't load the log to compare against: %1").arg(message));
+    }
+    right_loaded = success;
+    diff_when_loaded();
+}
+
+void TarpaulinViewer::compare_restarted(int load) {
+    if(load != compare_generation || !compare_loading) {
+        return;
+    }
+    ui->compareView->begin_scene();
+}
+
+void TarpaulinViewer::compare_rooted(int load, const QString& root) {
+    if(load != compare_generation || !compare_loading) {
+        return;
+    }
+    ui->compareView->reroot_files(QDir(root));
+}
+
+void TarpaulinViewer::diff_when_loaded() {
+    if(left_loaded && right_loaded) {
+        statusBar()->showMessage("Comparing...");
+        emit request_diff(current_load, compare_generation);
+    }
+}
+
+void TarpaulinViewer::diff_found(int left, int right, DiffResult diff) {
+    if(left != current_load || right != compare_generation) {
+        return;
+    }
+    // Missing events are red in the first run and new ones green in the second
+    ui->graphicsView->set_diff(diff, false, QColor(220, 0, 0));
+    ui->compareView->set_diff(diff, true, QColor(0, 170, 0));
+    statusBar()->showMessage(QString("%1 changed, %2 only before, %3 only after")
+                                 .arg(diff->left.changed)
+                                 .arg(diff->left.only_here)
+                                 .arg(diff->right.only_here));
+}
+
+void TarpaulinViewer::show_matching(graphics_view* from, graphics_view* to, qint64 node) {
+    auto side = from->diff_side();
+    if(!side || node < 0 || static_cast<size_t>(node) >= side->matches.size()) {
+        return;
+    }
+    // Events only in one run go to wherever the last event before them lined up
+    for(auto i=static_cast<size_t>(node) + 1; i-- > 0;) {
+        if(side->matches[i] != DiffSide::NO_MATCH) {
+            to->show_node(side->matches[i]);
+            return;
         }
     }
-    qDebug()<<parsed_events.size()<<" events found";
-    ui->graphicsView->create_scene(parsed_events);
+}
+
+void TarpaulinViewer::save_timings() {
+    auto path = QFileDialog::getSaveFileName(this, "Save load timings", QString(), "Chrome trace (*.json)");
+    if(path.isEmpty()) {
+        return;
+    }
+    if(phases.write_chrome_trace(path)) {
+        statusBar()->showMessage(QString("Timings saved to %1").arg(path));
+    } else {
+        statusBar()->showMessage(QString("Couldn't save timings to %1").arg(path));
+    }
+}
+
+void TarpaulinViewer::export_svg() {
+    if(loaded_path.isEmpty()) {
+        statusBar()->showMessage("Load a log to export first");
+        return;
+    }
+    auto path = QFileDialog::getSaveFileName(this, "Export SVG", QString(), "SVG (*.svg)");
+    if(!path.isEmpty()) {
+        statusBar()->showMessage(QString("Exporting to %1").arg(path));
+        emit request_svg(loaded_path, path);
+    }
+}
+
+void TarpaulinViewer::export_png() {
+    if(loaded_path.isEmpty()) {
+        statusBar()->showMessage("Load a log to export first");
+        return;
+    }
+    auto directory = QFileDialog::getExistingDirectory(this, "Export PNG tiles");
+    if(!directory.isEmpty()) {
+        // Tiles come out at the zoom the view's at
+        statusBar()->showMessage(QString("Exporting to %1").arg(directory));
+        emit request_png(loaded_path, directory, ui->graphicsView->transform().m11());
+    }
+}
+
+void TarpaulinViewer::export_finished(const QString& target, bool success, const QString& message) {
+    if(success) {
+        statusBar()->showMessage(QString("Exported to %1").arg(target));
+    } else {
+        statusBar()->showMessage(QString("Export to %1 failed: %2").arg(target, message));
+    }
+}
+
+void TarpaulinViewer::end_load() {
+    generation = -1;
+    following = false;
+    ui->graphicsView->finish_scene();
+    progress->hide();
+    cancel->hide();
+    update_failures();
+}
+
+void TarpaulinViewer::update_failures() {
+    const auto& failures = ui->graphicsView->failure_index();
+    QSignalBlocker blocker(failure_kinds);
+    auto current = failure_kinds->currentIndex();
+    failure_kinds->clear();
+    failure_kinds->addItem(QString("All failures (%1)").arg(failures.size()));
+    for(size_t i=0; i<FailureIndex::KINDS; i++) {
+        auto kind = static_cast<FailureKind>(i);
+        failure_kinds->addItem(QString("%1 (%2)").arg(failure_kind_name(kind)).arg(failures.count(kind)));
+    }
+    failure_kinds->setCurrentIndex(std::max(current, 0));
+}
+
+void TarpaulinViewer::failure_filter_changed(int index) {
+    if(index > 0) {
+        ui->graphicsView->set_failure_filter(static_cast<FailureKind>(index - 1));
+    } else {
+        ui->graphicsView->set_failure_filter(std::nullopt);
+    }
+}
+
+void TarpaulinViewer::search(bool jump) {
+    auto text = search_box->text();
+    search_request++;
+    jump_request = jump ? search_request : -1;
+    if(text.isEmpty()) {
+        ui->graphicsView->set_search_results(nullptr);
+        search_count->clear();
+        return;
+    }
+    // Searches run against whatever the latest load has indexed so far
+    emit request_search(current_load, text, search_request);
+}
+
+void TarpaulinViewer::search_found(int request, SearchResults nodes) {
+    if(request != search_request) {
+        return;
+    }
+    ui->graphicsView->set_search_results(nodes);
+    search_count->setText(QString("%1 matches").arg(nodes->size()));
+    if(request == jump_request) {
+        jump_request = -1;
+        ui->graphicsView->next_match();
+    }
+}
+
+void TarpaulinViewer::locations_updated(int load, LocationSnapshot stats) {
+    // Still wanted after the load finishes, the last snapshot can come in after it
+    if(load != current_load) {
+        return;
+    }
+    locations->set_stats(std::move(stats));
+}
+
+void TarpaulinViewer::processes_updated(int load, ProcessSnapshot tree) {
+    if(load != current_load) {
+        return;
+    }
+    processes->set_tree(std::move(tree));
+}
+
+void TarpaulinViewer::show_location(const QString& file, int line) {
+    // The lines events become the matches so N and Shift+N step through them
+    {
+        QSignalBlocker blocker(search_box);
+        search_box->clear();
+    }
+    search_request++;
+    jump_request = -1;
+    emit request_location(current_load, file, line, search_request);
+}
+
+void TarpaulinViewer::location_found(int request, const QString& file, int line, SearchResults nodes) {
+    if(request != search_request) {
+        return;
+    }
+    ui->graphicsView->set_search_results(nodes);
+    search_count->setText(QString("%1 events at %2:%3").arg(nodes->size()).arg(file).arg(line));
+    ui->graphicsView->first_match();
 }
 
 void TarpaulinViewer::keyReleaseEvent(QKeyEvent* event)
 {
+    // Typing a search shouldn't also move around the timeline
+    if(search_box->hasFocus()) {
+        if(event->key() == Qt::Key_Escape) {
+            ui->graphicsView->setFocus();
+        }
+        return;
+    }
     switch(event->key()) {
+    case Qt::Key_N: {
+        if(event->modifiers()==Qt::ShiftModifier) {
+            ui->graphicsView->previous_match();
+        } else {
+            ui->graphicsView->next_match();
+        }
+        break;
+    }
+    case Qt::Key_D: {
+        // Steps through whichever run has focus, the other follows along
+        auto view = ui->compareView->hasFocus() ? ui->compareView : ui->graphicsView;
+        if(event->modifiers()==Qt::ShiftModifier) {
+            view->previous_difference();
+        } else {
+            view->next_difference();
+        }
+        break;
+    }
     case Qt::Key_F: {
-        ui->graphicsView->next_failure();
+        if(event->modifiers()==Qt::ShiftModifier) {
+            ui->graphicsView->previous_failure();
+        } else {
+            ui->graphicsView->next_failure();
+        }
         break;
     }
     case Qt::Key_Left: {
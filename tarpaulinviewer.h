@@ -2,10 +2,26 @@
 #define TARPAULINVIEWER_H
 
 #include <QMainWindow>
+#include <QComboBox>
+#include <QDockWidget>
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QGraphicsItem>
 #include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QThread>
+#include "diff_worker.h"
+#include "export_worker.h"
+#include "location_panel.h"
+#include "location_worker.h"
+#include "phase_log.h"
+#include "process_panel.h"
+#include "process_worker.h"
+#include "search_worker.h"
+#include "trace_loader.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class TarpaulinViewer; }
@@ -20,11 +36,115 @@ public:
     ~TarpaulinViewer();
 public slots:
     void load_traces();
+
+    // Like load_traces but keeps adding events as the log is written
+    void follow_traces();
+
+    void cancel_load();
+
+    // Loads a log before and after a change one above the other and marks what differs
+    void compare_traces();
+
+    // Writes the last loads phase timings as a Chrome trace
+    void save_timings();
+
+    // Exports read the loaded log again from disk in the background
+    void export_svg();
+
+    void export_png();
+signals:
+    void request_load(const QString& path, int generation);
+
+    void request_follow(const QString& path, int generation);
+
+    void reset_search(int generation);
+
+    void reset_locations(int generation);
+
+    void reset_processes(int generation);
+
+    void request_search(int generation, const QString& text, int request);
+
+    void request_location(int generation, const QString& file, int line, int request);
+
+    void request_compare_load(const QString& path, int generation);
+
+    // -1 for both when not comparing
+    void reset_diff(int left, int right);
+
+    void request_diff(int left, int right);
+
+    void request_svg(const QString& log, const QString& path);
+
+    void request_png(const QString& log, const QString& directory, qreal scale);
 protected:
     void keyReleaseEvent(QKeyEvent* event) override;
 private:
     Ui::TarpaulinViewer *ui;
 
     QGraphicsScene *scene;
+
+    void start_load(const QString& path, bool follow, const QString& compare_path = QString());
+    void events_loaded(int generation, EventBatch events);
+    void load_progress(int generation, qint64 done, qint64 total);
+    void load_finished(int generation, bool success, const QString& message);
+    void load_restarted(int generation);
+    void load_rooted(int generation, const QString& root);
+    void end_load();
+    void update_failures();
+    void failure_filter_changed(int index);
+    void search(bool jump);
+    void search_found(int request, SearchResults nodes);
+    void locations_updated(int generation, LocationSnapshot stats);
+    void show_location(const QString& file, int line);
+    void location_found(int request, const QString& file, int line, SearchResults nodes);
+    void processes_updated(int generation, ProcessSnapshot tree);
+    void compare_events_loaded(int generation, EventBatch events);
+    void compare_finished(int generation, bool success, const QString& message);
+    void compare_restarted(int generation);
+    void compare_rooted(int generation, const QString& root);
+    void diff_when_loaded();
+    void diff_found(int left, int right, DiffResult diff);
+    void show_matching(graphics_view* from, graphics_view* to, qint64 node);
+    void export_finished(const QString& target, bool success, const QString& message);
+
+    QThread* loader_thread;
+    trace_loader* loader;
+    int generation = 0;
+    // Generation of the load on screen, generation goes back to -1 once it's finished
+    int current_load = -1;
+    bool following = false;
+    QProgressBar* progress;
+    QPushButton* cancel;
+    QComboBox* failure_kinds;
+    QLineEdit* search_box;
+    QLabel* search_count;
+    QThread* search_thread;
+    search_worker* searcher;
+    int search_request = 0;
+    // Jump to the first match once the results of this request come in
+    int jump_request = -1;
+    QDockWidget* locations_dock;
+    location_panel* locations;
+    QThread* location_thread;
+    location_worker* location_counter;
+    QDockWidget* processes_dock;
+    process_panel* processes;
+    // Shares the locations thread, it's a lot cheaper than counting locations
+    process_worker* process_counter;
+    // The log being compared against goes through its own loader into the lower view
+    QThread* compare_thread;
+    trace_loader* compare_loader;
+    int compare_generation = -1;
+    bool compare_loading = false;
+    bool left_loaded = false;
+    bool right_loaded = false;
+    QThread* diff_thread;
+    diff_worker* differ;
+    QThread* export_thread;
+    export_worker* exporter;
+    // Log in the main view, what gets exported
+    QString loaded_path;
+    PhaseLog phases;
 };
 #endif // TARPAULINVIEWER_H
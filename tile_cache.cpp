@@ -0,0 +1,80 @@
+#include "tile_cache.h"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+qreal TileKey::scale() const {
+    return std::ldexp(1.0, level);
+}
+
+QRectF TileKey::rect() const {
+    auto size = PIXELS / scale();
+    return QRectF(column * size, row * size, size, size);
+}
+
+bool TileKey::operator<(const TileKey& other) const {
+    return std::tie(level, column, row) < std::tie(other.level, other.column, other.row);
+}
+
+bool TileKey::operator==(const TileKey& other) const {
+    return level == other.level && column == other.column && row == other.row;
+}
+
+int tile_level(qreal scale) {
+    if(!(scale > 0.0)) {
+        return TileKey::MIN_LEVEL;
+    }
+    auto level = static_cast<int>(std::ceil(std::log2(scale)));
+    return std::clamp(level, TileKey::MIN_LEVEL, TileKey::MAX_LEVEL);
+}
+
+bool tiles_sharp_at(qreal scale) {
+    return scale <= std::ldexp(1.0, TileKey::MAX_LEVEL);
+}
+
+static size_t image_bytes(const QImage& image) {
+    return static_cast<size_t>(image.bytesPerLine()) * static_cast<size_t>(image.height());
+}
+
+TileCache::TileCache(size_t budget):
+    budget(budget)
+{
+}
+
+const QImage* TileCache::find(const TileKey& key) {
+    auto it = index.find(key);
+    if(it == index.end()) {
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->second;
+}
+
+void TileCache::insert(const TileKey& key, QImage image) {
+    auto it = index.find(key);
+    if(it != index.end()) {
+        used -= image_bytes(it->second->second);
+        entries.erase(it->second);
+        index.erase(it);
+    }
+    used += image_bytes(image);
+    entries.emplace_front(key, std::move(image));
+    index.emplace(key, entries.begin());
+    // The newest tile always stays even if it's bigger than the whole budget
+    while(used > budget && entries.size() > 1) {
+        auto& oldest = entries.back();
+        used -= image_bytes(oldest.second);
+        index.erase(oldest.first);
+        entries.pop_back();
+    }
+}
+
+void TileCache::clear() {
+    entries.clear();
+    index.clear();
+    used = 0;
+}
+
+size_t TileCache::bytes() const {
+    return used;
+}
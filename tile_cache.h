@@ -0,0 +1,63 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <QImage>
+#include <QMetaType>
+#include <QRectF>
+#include <cstdint>
+#include <list>
+#include <map>
+
+// A square of the timeline rendered at one of a fixed set of zoom levels. Level l is 2^l
+// pixels per scene unit so a tile covers the same bit of the scene however the view zooms.
+struct TileKey {
+    static constexpr int PIXELS = 256;
+    static constexpr int MIN_LEVEL = -40;
+    static constexpr int MAX_LEVEL = 6;
+
+    int level = 0;
+    int64_t column = 0;
+    int64_t row = 0;
+
+    qreal scale() const;
+
+    // The part of the scene it covers
+    QRectF rect() const;
+
+    bool operator<(const TileKey& other) const;
+
+    bool operator==(const TileKey& other) const;
+};
+Q_DECLARE_METATYPE(TileKey)
+
+// Level to draw a view at scale from, the closest one that's at least as sharp. Zoomed in
+// past MAX_LEVEL that's still MAX_LEVEL, see tiles_sharp_at.
+int tile_level(qreal scale);
+
+// Whether there's a level sharp enough for scale, past the top one tiles would be blown up
+bool tiles_sharp_at(qreal scale);
+
+// Rendered tiles, the least recently drawn ones are thrown away to stay under a budget in bytes
+class TileCache {
+public:
+    explicit TileCache(size_t budget);
+
+    // Counts as a use, null if the tile isn't cached
+    const QImage* find(const TileKey& key);
+
+    void insert(const TileKey& key, QImage image);
+
+    void clear();
+
+    size_t bytes() const;
+private:
+    using Entry = std::pair<TileKey, QImage>;
+
+    // Most recently used first
+    std::list<Entry> entries;
+    std::map<TileKey, std::list<Entry>::iterator> index;
+    size_t budget;
+    size_t used = 0;
+};
+
+#endif // TILE_CACHE_H
@@ -0,0 +1,136 @@
+#include "tile_renderer.h"
+#include <QFontDatabase>
+#include <QPainter>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include "label_cache.h"
+#include "timeline_painter.h"
+
+// Leaves a core for the GUI, more than this just fight over the same few visible tiles
+static constexpr int MAX_THREADS = 4;
+// Anything older has long been scrolled past
+static constexpr size_t MAX_QUEUED = 512;
+
+tile_renderer::tile_renderer(const EventStore& events, const TimelineLayout& layout):
+    events(events),
+    layout(layout),
+    text_in_tiles(QFontDatabase::supportsThreadedFontRendering())
+{
+    qRegisterMetaType<TileKey>("TileKey");
+}
+
+tile_renderer::~tile_renderer() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quitting = true;
+    }
+    wake.notify_all();
+    for(auto& thread: threads) {
+        thread.join();
+    }
+}
+
+void tile_renderer::start(const QFont& label_font, qreal pixel_ratio) {
+    std::lock_guard<std::mutex> guard(lock);
+    font = label_font;
+    ratio = pixel_ratio;
+    accepting = true;
+    // Threads only get made the first time there's something to draw
+    if(threads.empty()) {
+        auto count = std::clamp(QThread::idealThreadCount() - 1, 1, MAX_THREADS);
+        for(int i=0; i<count; i++) {
+            threads.emplace_back(&tile_renderer::run, this);
+        }
+    }
+}
+
+void tile_renderer::stop() {
+    std::unique_lock<std::mutex> guard(lock);
+    accepting = false;
+    queue.clear();
+    queued.clear();
+    current_version++;
+    idle.wait(guard, [this]() { return busy == 0; });
+}
+
+bool tile_renderer::running() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return accepting;
+}
+
+qreal tile_renderer::pixel_ratio() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return ratio;
+}
+
+bool tile_renderer::draws_text() const {
+    return text_in_tiles;
+}
+
+int tile_renderer::version() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return current_version;
+}
+
+void tile_renderer::request(const TileKey& key) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if(!accepting || !queued.insert(key).second) {
+            return;
+        }
+        queue.push_back(key);
+        if(queue.size() > MAX_QUEUED) {
+            queued.erase(queue.front());
+            queue.pop_front();
+        }
+    }
+    wake.notify_one();
+}
+
+void tile_renderer::run() {
+    LabelCache labels;
+    TimelinePainter painter(events, layout, labels);
+    // Every new load stops the renderer first, so a new version may be a different log
+    int labels_version = -1;
+    std::unique_lock<std::mutex> guard(lock);
+    while(true) {
+        wake.wait(guard, [this]() { return quitting || (accepting && !queue.empty()); });
+        if(quitting) {
+            return;
+        }
+        auto key = queue.back();
+        queue.pop_back();
+        queued.erase(key);
+        auto tile_font = font;
+        auto tile_ratio = ratio;
+        auto tile_version = current_version;
+        busy++;
+        guard.unlock();
+
+        labels.set_font(tile_font);
+        if(tile_version != labels_version) {
+            labels.forget_strings();
+            labels_version = tile_version;
+        }
+        auto pixels = static_cast<int>(std::ceil(TileKey::PIXELS * tile_ratio));
+        QImage image(pixels, pixels, QImage::Format_ARGB32_Premultiplied);
+        // The painter takes care of the ratio, it's drawn as if it were PIXELS square
+        image.setDevicePixelRatio(tile_ratio);
+        image.fill(Qt::transparent);
+        {
+            QPainter p(&image);
+            auto rect = key.rect();
+            p.scale(key.scale(), key.scale());
+            p.translate(-rect.topLeft());
+            painter.paint(&p, rect, key.scale(), text_in_tiles ? PaintLayers::all : PaintLayers::shapes);
+        }
+        emit rendered(key, std::move(image), tile_version);
+
+        guard.lock();
+        busy--;
+        if(busy == 0) {
+            idle.notify_all();
+        }
+    }
+}
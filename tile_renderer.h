@@ -0,0 +1,70 @@
+#ifndef TILE_RENDERER_H
+#define TILE_RENDERER_H
+
+#include <QFont>
+#include <QImage>
+#include <QObject>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "event_store.h"
+#include "tile_cache.h"
+#include "timeline_layout.h"
+
+// Renders timeline tiles into images on a few threads of its own. The newest request is
+// drawn first since that's normally what's just scrolled into view. Events and the layout
+// are read while drawing so stop has to be called before either changes. Where the platform
+// can't draw text off the GUI thread tiles leave it out and the timeline item draws it.
+class tile_renderer: public QObject
+{
+    Q_OBJECT
+public:
+    tile_renderer(const EventStore& events, const TimelineLayout& layout);
+    ~tile_renderer();
+
+    // Takes requests until stop, labels are drawn in font. Tiles have pixel_ratio device
+    // pixels to each of the views so they stay sharp on high DPI screens.
+    void start(const QFont& font, qreal pixel_ratio);
+
+    // Drops queued tiles and waits for the ones being drawn to finish
+    void stop();
+
+    bool running() const;
+
+    qreal pixel_ratio() const;
+
+    // Whether labels and counts are in the tiles
+    bool draws_text() const;
+
+    // Bumped by stop, tiles from an older version are out of date
+    int version() const;
+
+    // Queued unless it's already waiting
+    void request(const TileKey& key);
+signals:
+    // Emitted from a rendering thread
+    void rendered(TileKey key, QImage image, int version);
+private:
+    void run();
+
+    const EventStore& events;
+    const TimelineLayout& layout;
+    std::vector<std::thread> threads;
+    mutable std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<TileKey> queue;
+    std::set<TileKey> queued;
+    QFont font;
+    qreal ratio = 1.0;
+    const bool text_in_tiles;
+    int current_version = 0;
+    int busy = 0;
+    bool accepting = false;
+    bool quitting = false;
+};
+
+#endif // TILE_RENDERER_H
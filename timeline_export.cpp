@@ -0,0 +1,581 @@
+#include "timeline_export.h"
+#include "mapped_reader.h"
+#include <QDir>
+#include <QFile>
+#include <QFontInfo>
+#include <QImage>
+#include <QPainter>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <optional>
+#include <queue>
+
+static constexpr qreal MARGIN = TimelineLayout::MARGIN;
+static constexpr qreal TEXT_MARGIN = LabelCache::TEXT_MARGIN;
+// Same as the timeline, text any smaller isn't drawn into PNGs
+static constexpr qreal MIN_TEXT_PIXELS = 6.0;
+// Corners of closed processes are only thrown out every so often
+static constexpr size_t MIN_PRUNE = 4096;
+// Long edges sorted in memory at a time before they go out to disk, and read back per run
+static constexpr size_t RUN_EDGES = 1 << 18;
+static constexpr size_t READ_EDGES = 1 << 10;
+static const QColor FAILURE_TINT(255, 0, 0, 120);
+
+StreamingLayout::StreamingLayout(const QFont& font):
+    label_cache(font)
+{
+}
+
+LabelCache& StreamingLayout::labels() {
+    return label_cache;
+}
+
+bool StreamingLayout::measuring() const {
+    return is_measuring;
+}
+
+void StreamingLayout::finish_measuring() {
+    // Lanes are numbered in the order pids turn up so they come out the same second time round
+    is_measuring = false;
+    measured_width = placement.next_x();
+    placement.restart();
+    nodes = 0;
+    live_processes.clear();
+    open_corners.clear();
+    prune_at = 0;
+    previous = Corner{0.0, TimelineLayout::NO_LANE};
+}
+
+qreal StreamingLayout::lane_top(uint32_t lane) const {
+    // Every lane's shown in an export
+    if(lane != TimelineLayout::NO_LANE) {
+        return placement.lane_top(lane + 1, 0);
+    }
+    return placement.unlaned_top();
+}
+
+QRectF StreamingLayout::bounds() const {
+    auto lanes = placement.lane_count();
+    auto lanes_top = lanes == 0 ? 0.0 : lane_top(static_cast<uint32_t>(lanes - 1));
+    return placement.bounds(lanes_top, is_measuring ? placement.next_x() : measured_width);
+}
+
+void StreamingLayout::add(const EventStore& batch, const NodeCallback& node, const MarkerCallback& marker) {
+    for(size_t row=0; row<batch.size(); row++) {
+        if(batch.kind(row) == EventKind::marker) {
+            if(marker) {
+                marker(placement.marker_x());
+            }
+            continue;
+        }
+        PlacedNode placed;
+        placed.label = batch.label(row);
+        auto size = label_cache.size(placed.label);
+        auto pid = batch.pid(row);
+        auto laned = batch.kind(row) == EventKind::trace && pid;
+        if(laned) {
+            bool added = false;
+            placed.lane = placement.lane_for(*pid, added);
+        }
+        auto x = placement.place(size.width(), size.height());
+        placed.rect = QRectF(x, lane_top(placed.lane), size.width(), size.height());
+        placed.colour = batch.colour_index(row);
+        placed.bad = batch.is_bad(row);
+
+        // Edges go back to the parent graphics_view links it to
+        auto parent = live_processes.add(batch, row, nodes);
+        if(laned) {
+            std::optional<Corner> corner;
+            if(parent != ProcessIndex::NO_PARENT) {
+                auto found = open_corners.find(parent);
+                if(found != open_corners.end()) {
+                    corner = found->second;
+                }
+            } else if(nodes > 0) {
+                corner = previous;
+            }
+            if(corner) {
+                placed.has_edge = true;
+                placed.parent_right = corner->right;
+                placed.parent_lane = corner->lane;
+            }
+        }
+        Corner here{placed.rect.right(), placed.lane};
+        if(batch.kind(row) == EventKind::trace && !batch.is_end_node(row) && (pid || batch.child(row))) {
+            open_corners[nodes] = here;
+            if(open_corners.size() > prune_at) {
+                auto open = live_processes.open_nodes();
+                std::sort(open.begin(), open.end());
+                for(auto it=open_corners.begin(); it!=open_corners.end();) {
+                    if(std::binary_search(open.begin(), open.end(), it->first)) {
+                        ++it;
+                    } else {
+                        it = open_corners.erase(it);
+                    }
+                }
+                prune_at = std::max(MIN_PRUNE, open_corners.size() * 2);
+            }
+        }
+        previous = here;
+        nodes++;
+        if(node) {
+            node(placed);
+        }
+    }
+}
+
+// Reads with root if it's set and sets it otherwise, so every read after the first has
+// the same paths. late is set if the first read only got the root after its events.
+static bool read_log(const QString& path, const EventSink& sink, std::optional<QDir>& root, bool& late, QString& error) {
+    QFile input(path);
+    if(!input.open(QIODevice::ReadOnly)) {
+        error = QString("Couldn't open %1").arg(path);
+        return false;
+    }
+    MappedEventReader reader(&input);
+    if(root) {
+        reader.set_root(*root);
+    }
+    if(!reader.read(sink)) {
+        error = reader.error();
+        return false;
+    }
+    late = !root && reader.rooted_late();
+    root = reader.root();
+    return true;
+}
+
+static bool read_log(const QString& path, const EventSink& sink, std::optional<QDir>& root, QString& error) {
+    bool late = false;
+    return read_log(path, sink, root, late, error);
+}
+
+// Labels depend on the root and compressed logs only give it after their events, in which
+// case the measuring pass has to go again with it. restart throws away what it measured.
+static bool measure_log(const QString& path, const EventSink& sink, const std::function<void()>& restart, std::optional<QDir>& root, QString& error) {
+    bool late = false;
+    auto ok = read_log(path, sink, root, late, error);
+    if(ok && late) {
+        restart();
+        ok = read_log(path, sink, root, error);
+    }
+    return ok;
+}
+
+static bool measure(const QString& log, StreamingLayout& layout, std::optional<QDir>& root, QString& error) {
+    auto ok = measure_log(log, [&](EventStore& batch) {
+        layout.add(batch, nullptr, nullptr);
+    }, [&]() {
+        layout = StreamingLayout(layout.labels().font());
+    }, root, error);
+    layout.finish_measuring();
+    return ok;
+}
+
+static QString number(qreal value) {
+    return QString::number(value, 'f', 2);
+}
+
+bool export_svg(const QString& log, const QString& path, QString& error) {
+    StreamingLayout layout;
+    std::optional<QDir> root;
+    if(!measure(log, layout, root, error)) {
+        return false;
+    }
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = QString("Couldn't write %1").arg(path);
+        return false;
+    }
+    QTextStream svg(&file);
+    // Qt 5 would otherwise write the locale's encoding, labels are paths and can be anything
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    svg.setCodec("UTF-8");
+#else
+    svg.setEncoding(QStringConverter::Utf8);
+#endif
+    auto bounds = layout.bounds();
+    const auto& metrics = layout.labels().metrics();
+    svg << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << number(bounds.width())
+        << "\" height=\"" << number(bounds.height()) << "\" viewBox=\"" << number(bounds.left()) << " "
+        << number(bounds.top()) << " " << number(bounds.width()) << " " << number(bounds.height()) << "\">\n";
+    // Colours are classes so each node is only its geometry
+    svg << "<style>\n"
+        << "rect{stroke:#000;stroke-width:1}\n"
+        << "line{stroke:#000;stroke-width:1}\n"
+        << "text{font-family:'" << layout.labels().font().family() << "';font-size:" << QFontInfo(layout.labels().font()).pixelSize() << "px;white-space:pre}\n"
+        << ".bg{fill:#fff;stroke:none}\n"
+        << ".f{fill:#f00;fill-opacity:" << number(FAILURE_TINT.alphaF()) << ";stroke:none}\n"
+        << ".m{stroke-opacity:0.78;stroke-dasharray:4 2}\n";
+    const auto& colours = node_colours();
+    for(size_t i=0; i<colours.size(); i++) {
+        svg << ".c" << i << "{fill:" << colours[i].name() << "}\n";
+    }
+    svg << "</style>\n";
+    svg << "<rect class=\"bg\" x=\"" << number(bounds.left()) << "\" y=\"" << number(bounds.top())
+        << "\" width=\"" << number(bounds.width()) << "\" height=\"" << number(bounds.height()) << "\"/>\n";
+
+    auto node = [&](const PlacedNode& placed) {
+        const auto& r = placed.rect;
+        auto geometry = QString("x=\"%1\" y=\"%2\" width=\"%3\" height=\"%4\"")
+            .arg(number(r.left()), number(r.top()), number(r.width()), number(r.height()));
+        svg << "<rect class=\"c" << placed.colour << "\" " << geometry << "/>\n";
+        if(placed.bad) {
+            svg << "<rect class=\"f\" " << geometry << "/>\n";
+        }
+        if(placed.has_edge) {
+            svg << "<line x1=\"" << number(r.left()) << "\" y1=\"" << number(r.top()) << "\" x2=\""
+                << number(placed.parent_right) << "\" y2=\"" << number(layout.lane_top(placed.parent_lane)) << "\"/>\n";
+        }
+        auto baseline = r.top() + TEXT_MARGIN + metrics.ascent();
+        for(const auto& line: placed.label.split('\n')) {
+            if(!line.isEmpty()) {
+                svg << "<text x=\"" << number(r.left() + TEXT_MARGIN) << "\" y=\"" << number(baseline) << "\">"
+                    << line.toHtmlEscaped() << "</text>\n";
+            }
+            baseline += metrics.lineSpacing();
+        }
+    };
+    auto marker = [&](qreal x) {
+        svg << "<line class=\"m\" x1=\"" << number(x) << "\" y1=\"" << number(bounds.top()) << "\" x2=\""
+            << number(x) << "\" y2=\"" << number(bounds.bottom()) << "\"/>\n";
+    };
+    auto ok = read_log(log, [&](EventStore& batch) {
+        layout.add(batch, node, marker);
+    }, root, error);
+    svg << "</svg>\n";
+    svg.flush();
+    if(ok && file.error() != QFileDevice::NoError) {
+        error = QString("Couldn't write %1: %2").arg(path, file.errorString());
+        ok = false;
+    }
+    return ok;
+}
+
+namespace {
+
+// An edge reaching back past the start of its node's column, kept from measuring so the
+// columns it crosses before its node turns up can still draw it
+struct LongEdge {
+    qreal left;
+    uint32_t left_lane;
+    qreal right;
+    uint32_t right_lane;
+};
+
+// Long edges turn up in the order of their nodes but are needed in the order of their
+// parents. There can be one for nearly every event so they're sorted a run at a time onto
+// disk and merged back as they're wanted, only a run and a little of each run in memory.
+class EdgeSpill {
+public:
+    void add(const LongEdge& edge) {
+        run.push_back(edge);
+        if(run.size() >= RUN_EDGES) {
+            write_run();
+        }
+    }
+
+    // Call once every edge is in, before peek
+    bool finish() {
+        write_run();
+        run.clear();
+        run.shrink_to_fit();
+        if(!ok) {
+            return false;
+        }
+        for(size_t i=0; i<runs.size(); i++) {
+            if(!refill(runs[i])) {
+                return false;
+            }
+            queue.emplace(runs[i].buffer.front().left, i);
+        }
+        return true;
+    }
+
+    // Edge with the leftmost parent not yet taken, null once there are none
+    const LongEdge* peek() const {
+        if(queue.empty()) {
+            return nullptr;
+        }
+        const auto& from = runs[queue.top().second];
+        return &from.buffer[from.next];
+    }
+
+    bool pop() {
+        auto index = queue.top().second;
+        queue.pop();
+        auto& from = runs[index];
+        from.next++;
+        if(from.next == from.buffer.size() && !refill(from)) {
+            return false;
+        }
+        if(from.next < from.buffer.size()) {
+            queue.emplace(from.buffer[from.next].left, index);
+        }
+        return true;
+    }
+
+    QString error() const {
+        return QString("Couldn't write long edges to %1: %2").arg(file.fileName(), file.errorString());
+    }
+private:
+    struct Run {
+        qint64 offset;
+        size_t remaining;
+        std::vector<LongEdge> buffer;
+        size_t next = 0;
+    };
+
+    void write_run() {
+        if(run.empty() || !ok) {
+            return;
+        }
+        if(!file.isOpen() && !file.open()) {
+            ok = false;
+            return;
+        }
+        std::sort(run.begin(), run.end(), [](const LongEdge& a, const LongEdge& b) {
+            return a.left < b.left;
+        });
+        auto bytes = static_cast<qint64>(run.size() * sizeof(LongEdge));
+        runs.push_back(Run{file.pos(), run.size(), {}});
+        ok = file.write(reinterpret_cast<const char*>(run.data()), bytes) == bytes;
+        run.clear();
+    }
+
+    bool refill(Run& from) {
+        from.buffer.resize(std::min(from.remaining, READ_EDGES));
+        from.next = 0;
+        if(from.buffer.empty()) {
+            return true;
+        }
+        auto bytes = static_cast<qint64>(from.buffer.size() * sizeof(LongEdge));
+        if(!file.seek(from.offset) || file.read(reinterpret_cast<char*>(from.buffer.data()), bytes) != bytes) {
+            ok = false;
+            from.buffer.clear();
+            return false;
+        }
+        from.offset += bytes;
+        from.remaining -= from.buffer.size();
+        return true;
+    }
+
+    QTemporaryFile file;
+    bool ok = true;
+    std::vector<LongEdge> run;
+    std::vector<Run> runs;
+    // Left end of each run's next edge and which run it is, smallest first
+    std::priority_queue<std::pair<qreal, size_t>, std::vector<std::pair<qreal, size_t>>, std::greater<>> queue;
+};
+
+// Everything drawn into the column of tiles being built up
+class TileColumn {
+public:
+    TileColumn(StreamingLayout& layout, const QString& directory, qreal scale, int tile, EdgeSpill& long_edges):
+        layout(layout),
+        directory(directory),
+        scale(scale),
+        tile(tile),
+        bounds(layout.bounds()),
+        width(tile / scale),
+        long_edges(long_edges),
+        brushes(node_colours().begin(), node_colours().end())
+    {
+        legible = layout.labels().metrics().height() * scale >= MIN_TEXT_PIXELS;
+        columns = static_cast<int64_t>(std::ceil(bounds.width() * scale / tile));
+        rows = static_cast<int64_t>(std::ceil(bounds.height() * scale / tile));
+    }
+
+    void add(const PlacedNode& placed) {
+        while(placed.rect.left() >= right() && column < columns) {
+            flush();
+        }
+        nodes.push_back(placed);
+        if(!legible) {
+            nodes.back().label.clear();
+        }
+        if(placed.has_edge) {
+            edges.emplace_back(placed.rect.topLeft(), QPointF(placed.parent_right, layout.lane_top(placed.parent_lane)));
+        }
+    }
+
+    void add_marker(qreal x) {
+        markers.push_back(x);
+    }
+
+    // Writes out every column that's left
+    bool finish() {
+        while(column < columns && ok) {
+            flush();
+        }
+        return ok;
+    }
+
+    QString error;
+private:
+    qreal left() const {
+        return bounds.left() + column * width;
+    }
+
+    qreal right() const {
+        return left() + width;
+    }
+
+    void flush() {
+        // Long edges start being drawn in the column their parent's in and stop once the
+        // column their node's in is reached, where it draws them itself. Only the ones
+        // crossing this column are ever held.
+        for(auto edge = long_edges.peek(); edge && edge->left <= right(); edge = long_edges.peek()) {
+            active.push_back(*edge);
+            if(!long_edges.pop()) {
+                error = long_edges.error();
+                ok = false;
+                break;
+            }
+        }
+        active.erase(std::remove_if(active.begin(), active.end(), [&](const LongEdge& edge) {
+            return edge.right < right();
+        }), active.end());
+        for(const auto& edge: active) {
+            edges.emplace_back(QPointF(edge.right, layout.lane_top(edge.right_lane)), QPointF(edge.left, layout.lane_top(edge.left_lane)));
+        }
+
+        for(int64_t row=0; row<rows && ok; row++) {
+            write_tile(row);
+        }
+
+        // Anything reaching into the next column is drawn again there
+        auto next = right();
+        nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [&](const PlacedNode& placed) {
+            return placed.rect.right() < next;
+        }), nodes.end());
+        markers.erase(std::remove_if(markers.begin(), markers.end(), [&](qreal x) {
+            return x < next;
+        }), markers.end());
+        edges.clear();
+        column++;
+    }
+
+    void write_tile(int64_t row) {
+        auto top = bounds.top() + row * width;
+        auto pixels_wide = static_cast<int>(std::min<qreal>(tile, std::ceil((bounds.right() - left()) * scale)));
+        auto pixels_high = static_cast<int>(std::min<qreal>(tile, std::ceil((bounds.bottom() - top) * scale)));
+        QImage image(std::max(pixels_wide, 1), std::max(pixels_high, 1), QImage::Format_RGB32);
+        image.fill(Qt::white);
+        {
+            QPainter painter(&image);
+            painter.scale(scale, scale);
+            painter.translate(-left(), -top);
+            painter.setPen(QPen());
+            for(const auto& placed: nodes) {
+                painter.setBrush(brushes[placed.colour]);
+                painter.drawRect(placed.rect);
+            }
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(FAILURE_TINT);
+            for(const auto& placed: nodes) {
+                if(placed.bad) {
+                    painter.drawRect(placed.rect);
+                }
+            }
+            painter.setPen(QPen());
+            painter.drawLines(edges.data(), static_cast<int>(edges.size()));
+            if(legible) {
+                painter.setFont(layout.labels().font());
+                painter.setPen(Qt::black);
+                for(const auto& placed: nodes) {
+                    layout.labels().draw(&painter, placed.rect, placed.label);
+                }
+            }
+            QPen marker_pen;
+            marker_pen.setStyle(Qt::DashLine);
+            marker_pen.setColor(QColor(0, 0, 0, 200));
+            painter.setPen(marker_pen);
+            for(auto x: markers) {
+                painter.drawLine(QPointF(x, bounds.top()), QPointF(x, bounds.bottom()));
+            }
+        }
+        auto path = QDir(directory).filePath(QString("%1_%2.png").arg(column).arg(row));
+        if(!image.save(path, "PNG")) {
+            error = QString("Couldn't write %1").arg(path);
+            ok = false;
+        }
+    }
+
+    StreamingLayout& layout;
+    QString directory;
+    qreal scale;
+    int tile;
+    QRectF bounds;
+    // Width of a column in the scene
+    qreal width;
+    EdgeSpill& long_edges;
+    std::vector<LongEdge> active;
+    std::vector<QBrush> brushes;
+    bool legible = false;
+    int64_t columns = 0;
+    int64_t rows = 0;
+    int64_t column = 0;
+    std::vector<PlacedNode> nodes;
+    std::vector<QLineF> edges;
+    std::vector<qreal> markers;
+    bool ok = true;
+};
+
+}
+
+bool export_png_tiles(const QString& log, const QString& directory, qreal scale, int tile, QString& error) {
+    if(!(scale > 0.0) || tile <= 0) {
+        error = "The scale and tile size have to be positive";
+        return false;
+    }
+    if(!QDir().mkpath(directory)) {
+        error = QString("Couldn't create %1").arg(directory);
+        return false;
+    }
+    // Column edges only depend on x which measuring already gets right
+    StreamingLayout layout;
+    std::optional<EdgeSpill> long_edges(std::in_place);
+    std::optional<QDir> root;
+    auto width = tile / scale;
+    auto ok = measure_log(log, [&](EventStore& batch) {
+        layout.add(batch, [&](const PlacedNode& placed) {
+            auto column_left = std::floor(placed.rect.left() / width) * width;
+            if(placed.has_edge && placed.parent_right < column_left) {
+                long_edges->add({placed.parent_right, placed.parent_lane, placed.rect.left(), placed.lane});
+            }
+        }, nullptr);
+    }, [&]() {
+        layout = StreamingLayout(layout.labels().font());
+        long_edges.emplace();
+    }, root, error);
+    layout.finish_measuring();
+    if(!ok) {
+        return false;
+    }
+    if(!long_edges->finish()) {
+        error = long_edges->error();
+        return false;
+    }
+
+    TileColumn columns(layout, directory, scale, tile, *long_edges);
+    ok = read_log(log, [&](EventStore& batch) {
+        layout.add(batch, [&](const PlacedNode& placed) {
+            columns.add(placed);
+        }, [&](qreal x) {
+            columns.add_marker(x);
+        });
+    }, root, error);
+    if(!ok) {
+        return false;
+    }
+    if(!columns.finish()) {
+        error = columns.error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef TIMELINE_EXPORT_H
+#define TIMELINE_EXPORT_H
+
+#include <QFont>
+#include <QRectF>
+#include <QString>
+#include <functional>
+#include <unordered_map>
+#include "event_store.h"
+#include "label_cache.h"
+#include "process_index.h"
+#include "timeline_layout.h"
+
+// A node where the timeline puts it with every lane shown. The edge goes from the top left
+// of rect back to the top right of its parent.
+struct PlacedNode {
+    QRectF rect;
+    uint32_t lane = TimelineLayout::NO_LANE;
+    size_t colour = 0;
+    bool bad = false;
+    QString label;
+    bool has_edge = false;
+    qreal parent_right = 0.0;
+    uint32_t parent_lane = TimelineLayout::NO_LANE;
+};
+
+// Places nodes with TimelineLayout's placement but one at a time, forgetting each as soon
+// as it's handed on, so only the pids and the processes still open are kept. How far apart
+// lanes are depends on the tallest label in the whole log so a log is gone over twice: every
+// batch is measured first, then after finish_measuring the same batches in the same order
+// are placed. Nodes and markers are passed on in both, but y is only right when placing.
+class StreamingLayout {
+public:
+    using NodeCallback = std::function<void(const PlacedNode& node)>;
+    using MarkerCallback = std::function<void(qreal x)>;
+
+    explicit StreamingLayout(const QFont& font = QFont());
+
+    void add(const EventStore& batch, const NodeCallback& node, const MarkerCallback& marker);
+
+    // Goes back to the first node for placing
+    void finish_measuring();
+
+    bool measuring() const;
+
+    qreal lane_top(uint32_t lane) const;
+
+    // The whole timeline once it's all been measured
+    QRectF bounds() const;
+
+    LabelCache& labels();
+private:
+    struct Corner {
+        qreal right;
+        uint32_t lane;
+    };
+
+    LabelCache label_cache;
+    bool is_measuring = true;
+    TimelineLayout::Placement placement;
+    qreal measured_width = 0.0;
+    size_t nodes = 0;
+    ProcessIndex live_processes;
+    // Top right corners of the nodes live_processes could still hand back as parents
+    std::unordered_map<size_t, Corner> open_corners;
+    size_t prune_at = 0;
+    Corner previous{0.0, TimelineLayout::NO_LANE};
+};
+
+// Writes the timeline as an SVG, a node at a time as the log's read for the second time
+bool export_svg(const QString& log, const QString& path, QString& error);
+
+// Writes the timeline at scale pixels per scene unit as PNGs of tile pixels square, named
+// <column>_<row>.png. One column of tiles is drawn at a time so memory doesn't grow with the
+// length of the log.
+bool export_png_tiles(const QString& log, const QString& directory, qreal scale, int tile, QString& error);
+
+#endif // TIMELINE_EXPORT_H
@@ -0,0 +1,151 @@
+#include "timeline_item.h"
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+
+// Coarser levels are looked through for a blurry stand in while a tile's being drawn
+static constexpr int STAND_IN_LEVELS = 4;
+
+static int64_t floor_div(int64_t a, int64_t b) {
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+timeline_item::timeline_item(const EventStore& events, const TimelineLayout& layout, LabelCache& labels):
+    layout(layout),
+    painter(events, layout, labels)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF timeline_item::boundingRect() const {
+    return bounds;
+}
+
+void timeline_item::layout_changed() {
+    auto new_bounds = layout.bounds();
+    if(new_bounds != bounds) {
+        prepareGeometryChange();
+        bounds = new_bounds;
+    }
+    update();
+}
+
+void timeline_item::set_diff(const DiffSide* side, QColor only_here) {
+    diff = side;
+    only_here_colour = only_here;
+    update();
+}
+
+QColor timeline_item::diff_colour(DiffStatus status) const {
+    return status == DiffStatus::changed ? QColor(255, 140, 0) : only_here_colour;
+}
+
+void timeline_item::set_tiles(TileCache* cache, tile_renderer* renderer) {
+    tiles = cache;
+    tile_source = renderer;
+    update();
+}
+
+void timeline_item::paint(QPainter* target, const QStyleOptionGraphicsItem* option, QWidget*) {
+    auto exposed = option->exposedRect;
+    auto scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(target->worldTransform());
+    auto ratio = target->device() ? target->device()->devicePixelRatioF() : 1.0;
+    if(tiles && tile_source && tile_source->running() && tiles_sharp_at(scale) && tile_source->pixel_ratio() == ratio) {
+        paint_tiles(target, exposed, scale);
+        if(!tile_source->draws_text()) {
+            painter.paint(target, exposed, scale, PaintLayers::text);
+        }
+    } else {
+        painter.paint(target, exposed, scale);
+    }
+    // Differences change without the layout changing so they stay out of the tiles
+    if(diff) {
+        paint_differences(target, exposed.left() - TimelineLayout::MARGIN, exposed.right() + TimelineLayout::MARGIN, scale);
+    }
+}
+
+void timeline_item::paint_tiles(QPainter* target, const QRectF& area, qreal scale) {
+    // Tiles past the end of the timeline would only ever be blank
+    auto exposed = area.intersected(bounds);
+    if(exposed.isEmpty()) {
+        return;
+    }
+    auto level = tile_level(scale);
+    auto size = TileKey::PIXELS / std::ldexp(1.0, level);
+    auto first_column = static_cast<int64_t>(std::floor(exposed.left() / size));
+    auto last_column = static_cast<int64_t>(std::floor(exposed.right() / size));
+    auto first_row = static_cast<int64_t>(std::floor(exposed.top() / size));
+    auto last_row = static_cast<int64_t>(std::floor(exposed.bottom() / size));
+    // Text is left to paint if the tiles don't have it
+    auto layers = tile_source->draws_text() ? PaintLayers::all : PaintLayers::shapes;
+    target->save();
+    target->setRenderHint(QPainter::SmoothPixmapTransform);
+    for(auto row=first_row; row<=last_row; row++) {
+        for(auto column=first_column; column<=last_column; column++) {
+            TileKey key{level, column, row};
+            if(auto image = tiles->find(key)) {
+                target->drawImage(key.rect(), *image);
+                continue;
+            }
+            tile_source->request(key);
+            // A coarser tile scaled up does until this one's drawn, with nothing cached the
+            // tile's drawn here so there's never a gap
+            if(!paint_stand_in(target, key)) {
+                target->save();
+                target->setClipRect(key.rect());
+                painter.paint(target, key.rect().intersected(exposed), scale, layers);
+                target->restore();
+            }
+        }
+    }
+    target->restore();
+}
+
+bool timeline_item::paint_stand_in(QPainter* target, const TileKey& key) {
+    auto rect = key.rect();
+    for(int up=1; up<=STAND_IN_LEVELS && key.level - up >= TileKey::MIN_LEVEL; up++) {
+        auto span = int64_t(1) << up;
+        TileKey coarse{key.level - up, floor_div(key.column, span), floor_div(key.row, span)};
+        if(auto image = tiles->find(coarse)) {
+            // The part of the coarse tile this one covers, in the coarse tile's pixels
+            auto pixels = image->width() / static_cast<qreal>(span);
+            QRectF source((key.column - coarse.column * span) * pixels, (key.row - coarse.row * span) * pixels, pixels, pixels);
+            target->drawImage(rect, *image, source);
+            return true;
+        }
+    }
+    return false;
+}
+
+void timeline_item::paint_differences(QPainter* painter, qreal left, qreal right, qreal scale) {
+    // Outlined where nodes are drawn, a line through the lane where they're too small to see.
+    // Only one difference is drawn per pixel column, the rest would be drawn over it anyway.
+    const auto& nodes = diff->differences;
+    auto range = layout.visible(left, right);
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), range.first);
+    auto outline = layout.spacing() * scale >= TimelinePainter::MIN_NODE_PIXELS;
+    painter->setBrush(Qt::NoBrush);
+    while(it != nodes.end() && *it < range.second) {
+        auto node = *it;
+        auto lane = layout.lane(node);
+        auto x = layout.rect(node).left();
+        if(lane != TimelineLayout::NO_LANE && (outline ? layout.lane_mode(lane) == LaneMode::shown : layout.node_visible(node))) {
+            QPen pen(diff_colour(diff->status[node]), 2.0);
+            pen.setCosmetic(true);
+            painter->setPen(pen);
+            auto rect = layout.rect(node);
+            if(outline) {
+                painter->drawRect(rect);
+            } else {
+                painter->drawLine(QPointF(rect.center().x(), rect.top()), QPointF(rect.center().x(), rect.bottom()));
+            }
+        }
+        if(outline) {
+            ++it;
+        } else {
+            auto next = layout.node_from(x + 1.0 / scale);
+            it = std::lower_bound(it + 1, nodes.end(), static_cast<uint32_t>(std::min<size_t>(next, UINT32_MAX)));
+        }
+    }
+}
+
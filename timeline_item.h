@@ -0,0 +1,52 @@
+#ifndef TIMELINE_ITEM_H
+#define TIMELINE_ITEM_H
+
+#include <QGraphicsItem>
+#include "event_store.h"
+#include "label_cache.h"
+#include "tile_cache.h"
+#include "tile_renderer.h"
+#include "timeline_layout.h"
+#include "timeline_painter.h"
+#include "trace_diff.h"
+
+// The whole timeline as a single item. Nothing is stored per event, paint looks up the
+// nodes that overlap the exposed part of the scene and draws just those. Zoomed out far
+// enough that nodes would be a few pixels wide each lane is drawn from its summary instead,
+// as are collapsed lanes at any zoom. Once tiles are set it's drawn from those instead, tiles
+// that aren't cached yet are asked for and filled in when they've been rendered. Zoomed in
+// past the sharpest tiles, or on a screen they weren't rendered for, it's painted directly.
+class timeline_item: public QGraphicsItem
+{
+public:
+    timeline_item(const EventStore& events, const TimelineLayout& layout, LabelCache& labels);
+
+    QRectF boundingRect() const override;
+
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+    // Has to be called whenever the layout grows
+    void layout_changed();
+
+    // Marks nodes that differ from another run, changed ones in orange and ones only in this
+    // run in only_here. Null stops marking them.
+    void set_diff(const DiffSide* side, QColor only_here);
+
+    // Tiles are only drawn from while renderer is running, null goes back to painting directly
+    void set_tiles(TileCache* cache, tile_renderer* renderer);
+private:
+    void paint_tiles(QPainter* target, const QRectF& exposed, qreal scale);
+    bool paint_stand_in(QPainter* target, const TileKey& key);
+    void paint_differences(QPainter* painter, qreal left, qreal right, qreal scale);
+    QColor diff_colour(DiffStatus status) const;
+
+    const TimelineLayout& layout;
+    TimelinePainter painter;
+    QRectF bounds;
+    const DiffSide* diff = nullptr;
+    QColor only_here_colour;
+    TileCache* tiles = nullptr;
+    tile_renderer* tile_source = nullptr;
+};
+
+#endif // TIMELINE_ITEM_H
@@ -0,0 +1,451 @@
+#include "timeline_layout.h"
+#include <cmath>
+#include <limits>
+
+static void merge(SummaryBlock& into, const SummaryBlock& from) {
+    into.left = std::min(into.left, from.left);
+    into.right = std::max(into.right, from.right);
+    into.first = std::min(into.first, from.first);
+    into.count += from.count;
+    into.bad += from.bad;
+}
+
+void LaneSummary::add(size_t node, qreal left, qreal right, bool bad) {
+    SummaryBlock block{left, right, static_cast<uint32_t>(node), 1, bad ? 1u : 0u};
+    size_t capacity = FANOUT;
+    for(auto& level: blocks) {
+        if(level.back().count < capacity) {
+            merge(level.back(), block);
+        } else {
+            level.push_back(block);
+        }
+        capacity *= FANOUT;
+    }
+    if(blocks.empty()) {
+        blocks.push_back({block});
+    } else if(blocks.back().size() > 1) {
+        // The top level always covers everything with a single block
+        auto top = blocks.back().front();
+        for(size_t i=1; i<blocks.back().size(); i++) {
+            merge(top, blocks.back()[i]);
+        }
+        blocks.push_back({top});
+    }
+}
+
+size_t LaneSummary::levels() const {
+    return blocks.size();
+}
+
+const std::vector<SummaryBlock>& LaneSummary::level(size_t l) const {
+    return blocks[l];
+}
+
+size_t LaneSummary::level_for(qreal min_width) const {
+    if(blocks.empty()) {
+        return 0;
+    }
+    auto span = blocks.back().front().right - blocks.back().front().left;
+    for(size_t l=0; l<blocks.size(); l++) {
+        if(span / blocks[l].size() >= min_width) {
+            return l;
+        }
+    }
+    return blocks.size() - 1;
+}
+
+uint32_t TimelineLayout::Placement::lane_for(uint64_t pid, bool& added) {
+    auto lane = pid_lanes.emplace(pid, static_cast<uint32_t>(pid_lanes.size()));
+    added = lane.second;
+    return lane.first->second;
+}
+
+size_t TimelineLayout::Placement::lane_count() const {
+    return pid_lanes.size();
+}
+
+qreal TimelineLayout::Placement::place(qreal width, qreal height) {
+    auto left = x;
+    tallest = std::max(tallest, height + MARGIN*2.0);
+    x += width + MARGIN;
+    return left;
+}
+
+void TimelineLayout::Placement::restart() {
+    x = MARGIN;
+}
+
+qreal TimelineLayout::Placement::next_x() const {
+    return x;
+}
+
+qreal TimelineLayout::Placement::marker_x() const {
+    return x - MARGIN/2.0;
+}
+
+qreal TimelineLayout::Placement::lane_height() const {
+    return tallest;
+}
+
+qreal TimelineLayout::Placement::lane_top(uint32_t shown, uint32_t collapsed) const {
+    // The stack's bottom stays where lane 0 ends when it's shown, whatever's hidden
+    return tallest - (shown * tallest + collapsed * COLLAPSED_HEIGHT);
+}
+
+qreal TimelineLayout::Placement::unlaned_top() const {
+    return 3.0*MARGIN + tallest;
+}
+
+QRectF TimelineLayout::Placement::bounds(qreal lanes_top, qreal right) const {
+    auto bottom = 3.0*MARGIN + 2.0*tallest;
+    return QRectF(0.0, lanes_top - MARGIN, right + MARGIN, bottom - lanes_top + MARGIN);
+}
+
+void TimelineLayout::clear() {
+    *this = TimelineLayout();
+}
+
+void TimelineLayout::add(qreal width, qreal height, std::optional<uint64_t> pid, uint32_t edge_to, bool bad) {
+    auto node = xs.size();
+    uint32_t lane = NO_LANE;
+    if(pid) {
+        bool added = false;
+        lane = placement.lane_for(*pid, added);
+        if(added) {
+            summaries.emplace_back();
+            lane_nodes.emplace_back();
+            lane_pids.push_back(*pid);
+            lane_parents.push_back(NO_LANE);
+            // New processes are hidden while something's soloed unless they're part of it
+            lane_modes.push_back(soloing ? LaneMode::hidden : LaneMode::shown);
+            lane_passes_mode.push_back(false);
+            shown_upto.push_back(0);
+            collapsed_upto.push_back(0);
+            summary_stale.push_back(false);
+        }
+        // Parents always have an earlier lane so following them can't loop
+        if(lane_parents[lane] == NO_LANE && edge_to != NO_EDGE && lanes[edge_to] < lane) {
+            auto parent = lanes[edge_to];
+            lane_parents[lane] = parent;
+            if(lane_passes_mode[parent] && lane_nodes[lane].empty()) {
+                lane_modes[lane] = lane_modes[parent];
+                lane_passes_mode[lane] = true;
+            }
+        }
+        if(lane_nodes[lane].empty()) {
+            shown_upto[lane] = (lane > 0 ? shown_upto[lane - 1] : 0) + (lane_modes[lane] == LaneMode::shown);
+            collapsed_upto[lane] = (lane > 0 ? collapsed_upto[lane - 1] : 0) + (lane_modes[lane] == LaneMode::collapsed);
+        }
+    }
+    auto x = placement.place(width, height);
+    xs.push_back(x);
+    widths.push_back(width);
+    heights.push_back(height);
+    lanes.push_back(lane);
+    edges.push_back(edge_to);
+    bad_nodes.push_back(bad);
+    add_edge_reach(node, edge_to != NO_EDGE ? xs[edge_to] + widths[edge_to] : std::numeric_limits<qreal>::infinity());
+    if(lane == NO_LANE) {
+        unlaned_summary.add(node, x, x + width, bad);
+        unlaned_nodes.push_back(static_cast<uint32_t>(node));
+    } else {
+        // Nothing looks at a hidden lane's summary, it's caught up when the lane's shown
+        if(lane_modes[lane] == LaneMode::hidden) {
+            summary_stale[lane] = true;
+        } else {
+            summaries[lane].add(node, x, x + width, bad);
+        }
+        lane_nodes[lane].push_back(static_cast<uint32_t>(node));
+    }
+}
+
+void TimelineLayout::add_edge_reach(size_t node, qreal reach) {
+    auto block = node;
+    for(size_t level=0; ; level++) {
+        block /= EDGE_FANOUT;
+        if(level == edge_reach.size()) {
+            if(level == 0) {
+                edge_reach.emplace_back();
+            } else {
+                // The level under has just outgrown its single block
+                const auto& under = edge_reach[level - 1];
+                edge_reach.push_back({*std::min_element(under.begin(), under.end())});
+            }
+        }
+        auto& blocks = edge_reach[level];
+        if(block == blocks.size()) {
+            blocks.push_back(reach);
+        } else {
+            blocks[block] = std::min(blocks[block], reach);
+        }
+        if(blocks.size() == 1) {
+            break;
+        }
+    }
+}
+
+void TimelineLayout::add_marker(size_t node) {
+    marker_nodes.push_back(node);
+}
+
+void TimelineLayout::finish() {
+    finished = true;
+}
+
+size_t TimelineLayout::size() const {
+    return xs.size();
+}
+
+size_t TimelineLayout::lane_count() const {
+    return placement.lane_count();
+}
+
+qreal TimelineLayout::lane_height() const {
+    return placement.lane_height();
+}
+
+uint32_t TimelineLayout::lane(size_t node) const {
+    return lanes[node];
+}
+
+uint32_t TimelineLayout::edge(size_t node) const {
+    return edges[node];
+}
+
+qreal TimelineLayout::lane_y(size_t node) const {
+    return lane_top(lanes[node]);
+}
+
+qreal TimelineLayout::lane_top(uint32_t lane) const {
+    if(lane != NO_LANE) {
+        return placement.lane_top(shown_upto[lane], collapsed_upto[lane]);
+    }
+    return placement.unlaned_top();
+}
+
+qreal TimelineLayout::row_height(uint32_t lane) const {
+    if(lane == NO_LANE) {
+        return lane_height();
+    }
+    switch(lane_modes[lane]) {
+    case LaneMode::shown:
+        return lane_height();
+    case LaneMode::collapsed:
+        return COLLAPSED_HEIGHT;
+    default:
+        return 0.0;
+    }
+}
+
+uint64_t TimelineLayout::lane_pid(uint32_t lane) const {
+    return lane_pids[lane];
+}
+
+uint32_t TimelineLayout::lane_parent(uint32_t lane) const {
+    return lane_parents[lane];
+}
+
+LaneMode TimelineLayout::lane_mode(uint32_t lane) const {
+    return lane_modes[lane];
+}
+
+std::vector<uint32_t> TimelineLayout::subtree_of(uint32_t lane) const {
+    std::vector<std::vector<uint32_t>> children(lane_parents.size());
+    for(uint32_t l=0; l<lane_parents.size(); l++) {
+        if(lane_parents[l] != NO_LANE) {
+            children[lane_parents[l]].push_back(l);
+        }
+    }
+    std::vector<uint32_t> subtree{lane};
+    for(size_t i=0; i<subtree.size(); i++) {
+        for(auto child: children[subtree[i]]) {
+            subtree.push_back(child);
+        }
+    }
+    return subtree;
+}
+
+void TimelineLayout::set_lane_mode(uint32_t lane, LaneMode mode, bool subtree) {
+    if(subtree) {
+        for(auto l: subtree_of(lane)) {
+            lane_modes[l] = mode;
+            lane_passes_mode[l] = true;
+        }
+    } else {
+        lane_modes[lane] = mode;
+        lane_passes_mode[lane] = false;
+    }
+    update_rows();
+}
+
+void TimelineLayout::solo(uint32_t lane, bool subtree) {
+    soloing = true;
+    std::fill(lane_modes.begin(), lane_modes.end(), LaneMode::hidden);
+    std::fill(lane_passes_mode.begin(), lane_passes_mode.end(), false);
+    set_lane_mode(lane, LaneMode::shown, subtree);
+}
+
+void TimelineLayout::show_all() {
+    soloing = false;
+    std::fill(lane_modes.begin(), lane_modes.end(), LaneMode::shown);
+    std::fill(lane_passes_mode.begin(), lane_passes_mode.end(), false);
+    update_rows();
+}
+
+void TimelineLayout::update_rows() {
+    uint32_t shown = 0;
+    uint32_t collapsed = 0;
+    for(size_t lane=0; lane<lane_modes.size(); lane++) {
+        shown += lane_modes[lane] == LaneMode::shown;
+        collapsed += lane_modes[lane] == LaneMode::collapsed;
+        shown_upto[lane] = shown;
+        collapsed_upto[lane] = collapsed;
+        if(summary_stale[lane] && lane_modes[lane] != LaneMode::hidden) {
+            summaries[lane] = LaneSummary();
+            for(auto node: lane_nodes[lane]) {
+                summaries[lane].add(node, xs[node], xs[node] + widths[node], bad_nodes[node]);
+            }
+            summary_stale[lane] = false;
+        }
+    }
+}
+
+// Lanes are stacked upwards so both their tops and bottoms only go down with the index,
+// this finds the first lane the predicate is false for
+template<typename P>
+static size_t first_lane_where_not(size_t count, P&& pred) {
+    size_t low = 0;
+    size_t high = count;
+    while(low < high) {
+        auto mid = low + (high - low) / 2;
+        if(pred(mid)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+std::optional<uint32_t> TimelineLayout::lane_at(qreal y) const {
+    auto lane = first_lane_where_not(lane_modes.size(), [&](size_t l) {
+        return lane_top(static_cast<uint32_t>(l)) > y;
+    });
+    for(; lane<lane_modes.size(); lane++) {
+        auto height = row_height(static_cast<uint32_t>(lane));
+        if(y < lane_top(static_cast<uint32_t>(lane)) + height) {
+            return static_cast<uint32_t>(lane);
+        } else if(height > 0.0) {
+            break;
+        }
+    }
+    return std::nullopt;
+}
+
+bool TimelineLayout::node_visible(size_t node) const {
+    return lanes[node] == NO_LANE || lane_modes[lanes[node]] != LaneMode::hidden;
+}
+
+qreal TimelineLayout::spacing() const {
+    if(xs.empty()) {
+        return 0.0;
+    }
+    return (placement.next_x() - MARGIN) / xs.size();
+}
+
+const LaneSummary& TimelineLayout::summary(uint32_t lane) const {
+    if(lane == NO_LANE) {
+        return unlaned_summary;
+    }
+    return summaries[lane];
+}
+
+QRectF TimelineLayout::rect(size_t node) const {
+    auto lane = lanes[node];
+    if(lane != NO_LANE && lane_modes[lane] != LaneMode::shown) {
+        auto height = row_height(lane);
+        return QRectF(xs[node], lane_top(lane) + height/4.0, widths[node], height/2.0);
+    }
+    return QRectF(xs[node], lane_y(node), widths[node], heights[node]);
+}
+
+QRectF TimelineLayout::bounds() const {
+    auto lanes_top = lane_modes.empty() ? 0.0 : lane_top(static_cast<uint32_t>(lane_modes.size() - 1));
+    return placement.bounds(lanes_top, placement.next_x());
+}
+
+std::pair<size_t, size_t> TimelineLayout::visible(qreal left, qreal right) const {
+    // Nodes don't overlap so their right hand edges are sorted as well
+    auto first = std::upper_bound(xs.begin(), xs.end(), left) - xs.begin();
+    if(first > 0 && xs[first - 1] + widths[first - 1] >= left) {
+        --first;
+    }
+    auto last = std::upper_bound(xs.begin() + first, xs.end(), right) - xs.begin();
+    return {static_cast<size_t>(first), static_cast<size_t>(last)};
+}
+
+size_t TimelineLayout::node_from(qreal x) const {
+    return std::lower_bound(xs.begin(), xs.end(), x) - xs.begin();
+}
+
+void TimelineLayout::lane_nodes_in(const std::vector<uint32_t>& nodes, qreal left, qreal right, std::vector<size_t>& found) const {
+    auto first = std::lower_bound(nodes.begin(), nodes.end(), left, [this](uint32_t node, qreal x) {
+        return xs[node] + widths[node] < x;
+    });
+    for(auto it=first; it!=nodes.end() && xs[*it] <= right; ++it) {
+        found.push_back(*it);
+    }
+}
+
+std::vector<size_t> TimelineLayout::nodes_in(const QRectF& area) const {
+    std::vector<size_t> found;
+    // A lane covers y from its top down to just short of the lane under it, hidden lanes
+    // don't cover anything
+    auto first_lane = first_lane_where_not(lane_nodes.size(), [&](size_t lane) {
+        return lane_top(static_cast<uint32_t>(lane)) > area.bottom();
+    });
+    auto end_lane = first_lane_where_not(lane_nodes.size(), [&](size_t lane) {
+        return lane_top(static_cast<uint32_t>(lane)) + row_height(static_cast<uint32_t>(lane)) > area.top();
+    });
+    for(auto lane=first_lane; lane<end_lane; lane++) {
+        if(lane_modes[lane] != LaneMode::hidden) {
+            lane_nodes_in(lane_nodes[lane], area.left(), area.right(), found);
+        }
+    }
+    auto unlaned_top = lane_top(NO_LANE);
+    if(area.bottom() >= unlaned_top && area.top() < unlaned_top + lane_height()) {
+        lane_nodes_in(unlaned_nodes, area.left(), area.right(), found);
+    }
+    return found;
+}
+
+std::optional<size_t> TimelineLayout::node_at(const QPointF& pos) const {
+    for(auto node: nodes_in(QRectF(pos, QSizeF(0.0, 0.0)))) {
+        if(rect(node).contains(pos)) {
+            return node;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<qreal> TimelineLayout::marker_positions(qreal left, qreal right) const {
+    std::vector<qreal> positions;
+    // A marker sits in the gap before its node so only the ones around the visible nodes matter
+    auto range = visible(left, right);
+    auto first = std::lower_bound(marker_nodes.begin(), marker_nodes.end(), range.first);
+    for(auto it=first; it!=marker_nodes.end() && *it <= range.second; ++it) {
+        auto node = *it;
+        qreal x;
+        if(node < xs.size()) {
+            x = xs[node] - MARGIN/2.0;
+        } else if(finished) {
+            x = placement.marker_x();
+        } else {
+            continue;
+        }
+        if(x >= left && x <= right) {
+            positions.push_back(x);
+        }
+    }
+    return positions;
+}
@@ -0,0 +1,254 @@
+#ifndef TIMELINE_LAYOUT_H
+#define TIMELINE_LAYOUT_H
+
+#include <QRectF>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+struct SummaryBlock {
+    qreal left;
+    qreal right;
+    uint32_t first;
+    uint32_t count;
+    uint32_t bad;
+};
+
+// Consecutive nodes of a lane grouped into blocks, each level's blocks hold FANOUT times
+// as many nodes as the level below like the levels of a mipmap. Kept up to date as nodes
+// are added so zooming out never has to look at individual nodes.
+class LaneSummary {
+public:
+    static constexpr uint32_t FANOUT = 8;
+
+    void add(size_t node, qreal left, qreal right, bool bad);
+
+    size_t levels() const;
+
+    const std::vector<SummaryBlock>& level(size_t l) const;
+
+    // Finest level whose blocks are at least min_width wide on average, or the top level
+    // if none are
+    size_t level_for(qreal min_width) const;
+private:
+    std::vector<std::vector<SummaryBlock>> blocks;
+};
+
+enum class LaneMode: uint8_t {
+    shown,
+    // Only drawn as a thin strip of summary blocks
+    collapsed,
+    // Takes up no space and isn't drawn or hit-tested at all
+    hidden
+};
+
+// Where every node goes on the timeline, kept in plain arrays indexed by node so nothing
+// has to exist in the scene until it's on screen. Nodes are placed left to right in index
+// order and never overlap on x, so the nodes in a range of x are found by binary search.
+class TimelineLayout {
+public:
+    static constexpr qreal MARGIN = 10.0;
+    // Configs, binaries and traces without a pid go in a row under the lanes
+    static constexpr uint32_t NO_LANE = UINT32_MAX;
+    static constexpr uint32_t NO_EDGE = UINT32_MAX;
+    static constexpr qreal COLLAPSED_HEIGHT = MARGIN*2.0;
+
+    // Where nodes go along x, which lane each pid gets and how tall lanes are. The export
+    // places nodes without keeping them using one of these too so the two can't drift apart.
+    class Placement {
+    public:
+        // Lane for pid, added is set the first time pid turns up
+        uint32_t lane_for(uint64_t pid, bool& added);
+
+        size_t lane_count() const;
+
+        // x of a node this size, the next one goes after it. Lanes grow to fit it.
+        qreal place(qreal width, qreal height);
+
+        // Back to the left to place the same nodes again, lanes and their height are kept
+        void restart();
+
+        qreal next_x() const;
+
+        // Between the last node and the next one
+        qreal marker_x() const;
+
+        qreal lane_height() const;
+
+        // Top of a lane given how many shown and collapsed lanes there are from lane 0 up to
+        // and including it
+        qreal lane_top(uint32_t shown, uint32_t collapsed) const;
+
+        qreal unlaned_top() const;
+
+        // From lanes_top down to the bottom of the row under the lanes, right is where the
+        // last node ends
+        QRectF bounds(qreal lanes_top, qreal right) const;
+    private:
+        std::map<uint64_t, uint32_t> pid_lanes;
+        qreal x = MARGIN;
+        qreal tallest = MARGIN*2.0 + 50.0;
+    };
+
+    void clear();
+
+    // Places the next node, edge_to is the node its edge goes back to if it has one
+    void add(qreal width, qreal height, std::optional<uint64_t> pid, uint32_t edge_to, bool bad);
+
+    // A marker goes just before node, or at the end if node never turns up
+    void add_marker(size_t node);
+
+    // Markers still waiting for their node are put at the end of the timeline
+    void finish();
+
+    size_t size() const;
+
+    size_t lane_count() const;
+
+    qreal lane_height() const;
+
+    uint32_t lane(size_t node) const;
+
+    uint32_t edge(size_t node) const;
+
+    qreal lane_y(size_t node) const;
+
+    // Top of a lane, NO_LANE gives the row under the lanes
+    qreal lane_top(uint32_t lane) const;
+
+    // Average distance between the starts of neighbouring nodes
+    qreal spacing() const;
+
+    // Height of a lane's row, 0 if it's hidden
+    qreal row_height(uint32_t lane) const;
+
+    // Summary of a lane, or of the row under the lanes for NO_LANE
+    const LaneSummary& summary(uint32_t lane) const;
+
+    uint64_t lane_pid(uint32_t lane) const;
+
+    // Lane of the process that forked this one, or NO_LANE
+    uint32_t lane_parent(uint32_t lane) const;
+
+    LaneMode lane_mode(uint32_t lane) const;
+
+    // Lanes only move on y when their modes change so this is just a pass over the lanes,
+    // nodes keep their x. With subtree set lanes forked from it later on get the same mode.
+    void set_lane_mode(uint32_t lane, LaneMode mode, bool subtree);
+
+    // Hides everything except lane, and its descendants if subtree is set
+    void solo(uint32_t lane, bool subtree);
+
+    void show_all();
+
+    // Lane whose row y is in
+    std::optional<uint32_t> lane_at(qreal y) const;
+
+    // False if the node's lane is hidden
+    bool node_visible(size_t node) const;
+
+    QRectF rect(size_t node) const;
+
+    // Everything that's been placed, markers included
+    QRectF bounds() const;
+
+    // Nodes overlapping [left, right] on x as a half open range of indexes
+    std::pair<size_t, size_t> visible(qreal left, qreal right) const;
+
+    // First node starting at or after x
+    size_t node_from(qreal x) const;
+
+    // Nodes in the lanes rect crosses that overlap it on x, a lane at a time
+    std::vector<size_t> nodes_in(const QRectF& area) const;
+
+    std::optional<size_t> node_at(const QPointF& pos) const;
+
+    // Calls f(node, parent) for every edge that crosses [left, right] on x
+    template<typename F>
+    void for_each_edge(qreal left, qreal right, F&& f) const {
+        auto range = visible(left, right);
+        for(auto i=range.first; i<range.second; i++) {
+            if(edges[i] != NO_EDGE) {
+                f(i, static_cast<size_t>(edges[i]));
+            }
+        }
+        // Edges from further right only matter if they reach back far enough, the reach tree
+        // only leads down to blocks that have one
+        if(!edge_reach.empty()) {
+            size_t span = 1;
+            for(size_t level=0; level<edge_reach.size(); level++) {
+                span *= EDGE_FANOUT;
+            }
+            edges_reaching(edge_reach.size() - 1, 0, span, range.second, right, f);
+        }
+    }
+
+    // x of the placed markers between left and right
+    std::vector<qreal> marker_positions(qreal left, qreal right) const;
+private:
+    static constexpr size_t EDGE_FANOUT = 8;
+
+    // Edges of nodes from on in block of level that reach back to right or before it, span is
+    // how many nodes a block of level covers
+    template<typename F>
+    void edges_reaching(size_t level, size_t block, size_t span, size_t from, qreal right, F& f) const {
+        auto first = block * span;
+        if(edge_reach[level][block] > right || first + span <= from) {
+            return;
+        }
+        if(level == 0) {
+            auto end = std::min(size(), first + span);
+            for(auto i=std::max(from, first); i<end; i++) {
+                if(edges[i] != NO_EDGE && xs[edges[i]] + widths[edges[i]] <= right) {
+                    f(i, static_cast<size_t>(edges[i]));
+                }
+            }
+            return;
+        }
+        auto end = std::min(edge_reach[level - 1].size(), (block + 1) * EDGE_FANOUT);
+        for(auto child=block * EDGE_FANOUT; child<end; child++) {
+            edges_reaching(level - 1, child, span / EDGE_FANOUT, from, right, f);
+        }
+    }
+
+    void add_edge_reach(size_t node, qreal reach);
+    void lane_nodes_in(const std::vector<uint32_t>& nodes, qreal left, qreal right, std::vector<size_t>& found) const;
+    void update_rows();
+    std::vector<uint32_t> subtree_of(uint32_t lane) const;
+
+    std::vector<qreal> xs;
+    std::vector<qreal> widths;
+    std::vector<qreal> heights;
+    std::vector<uint32_t> lanes;
+    std::vector<uint32_t> edges;
+    std::vector<bool> bad_nodes;
+    // Leftmost x any edge in each block of nodes reaches back to. The first level has blocks
+    // of EDGE_FANOUT nodes, each level above has blocks of EDGE_FANOUT of the ones under it
+    // and the top is a single block.
+    std::vector<std::vector<qreal>> edge_reach;
+    std::vector<size_t> marker_nodes;
+    std::vector<LaneSummary> summaries;
+    // Lanes that had nodes added while hidden, their summaries are rebuilt once shown
+    std::vector<bool> summary_stale;
+    LaneSummary unlaned_summary;
+    // Nodes of each lane in order, this is the spatial index for hit-testing
+    std::vector<std::vector<uint32_t>> lane_nodes;
+    std::vector<uint32_t> unlaned_nodes;
+    Placement placement;
+    std::vector<uint64_t> lane_pids;
+    std::vector<uint32_t> lane_parents;
+    std::vector<LaneMode> lane_modes;
+    // Lanes forked from one of these get its mode
+    std::vector<bool> lane_passes_mode;
+    bool soloing = false;
+    // Lanes are stacked upwards from lane 0, these count the shown and collapsed lanes
+    // from lane 0 up to and including each lane so its top is found without a walk
+    std::vector<uint32_t> shown_upto;
+    std::vector<uint32_t> collapsed_upto;
+    bool finished = false;
+};
+
+#endif // TIMELINE_LAYOUT_H
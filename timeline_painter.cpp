@@ -0,0 +1,167 @@
+#include "timeline_painter.h"
+#include <algorithm>
+
+static constexpr qreal TEXT_MARGIN = LabelCache::TEXT_MARGIN;
+// Text any smaller than this isn't worth drawing
+static constexpr qreal MIN_TEXT_PIXELS = 6.0;
+static const QColor FAILURE_TINT(255, 0, 0, 120);
+
+TimelinePainter::TimelinePainter(const EventStore& events, const TimelineLayout& layout, LabelCache& labels):
+    events(events),
+    layout(layout),
+    labels(labels)
+{
+    for(const auto& colour: node_colours()) {
+        brushes.emplace_back(colour);
+    }
+    colour_rects.resize(brushes.size());
+}
+
+void TimelinePainter::paint(QPainter* painter, const QRectF& exposed, qreal scale, PaintLayers layers) {
+    auto left = exposed.left() - TimelineLayout::MARGIN;
+    auto right = exposed.right() + TimelineLayout::MARGIN;
+    auto legible = labels.metrics().height() * scale >= MIN_TEXT_PIXELS;
+    if(layout.spacing() * scale >= MIN_NODE_PIXELS) {
+        paint_nodes(painter, QRectF(left, exposed.top(), right - left, exposed.height()), scale, legible, layers);
+    } else {
+        paint_summary(painter, left, right, scale, legible, layers);
+    }
+    if(layers == PaintLayers::text) {
+        return;
+    }
+
+    auto bounds = layout.bounds();
+    QPen marker_pen;
+    marker_pen.setStyle(Qt::DashLine);
+    marker_pen.setColor(QColor(0, 0, 0, 200));
+    painter->setPen(marker_pen);
+    for(auto x: layout.marker_positions(left, right)) {
+        painter->drawLine(QPointF(x, bounds.top()), QPointF(x, bounds.bottom()));
+    }
+}
+
+void TimelinePainter::paint_nodes(QPainter* painter, const QRectF& area, qreal scale, bool legible, PaintLayers layers) {
+    auto nodes = layout.nodes_in(area);
+    // Collapsed lanes come back from nodes_in too but only get their summary drawn
+    auto shown = [this](size_t node) {
+        auto lane = layout.lane(node);
+        return lane == TimelineLayout::NO_LANE || layout.lane_mode(lane) == LaneMode::shown;
+    };
+    auto draw_labels = [&]() {
+        painter->setFont(labels.font());
+        painter->setPen(Qt::black);
+        for(auto i: nodes) {
+            if(shown(i)) {
+                labels.draw(painter, layout.rect(i), events, i);
+            }
+        }
+    };
+    if(layers == PaintLayers::text) {
+        if(legible) {
+            draw_labels();
+        }
+        return;
+    }
+    // Rects are gathered per colour so each colour is one drawRects, failures get tinted
+    // over the top afterwards
+    for(auto& rects: colour_rects) {
+        rects.clear();
+    }
+    bad_rects.clear();
+    edge_lines.clear();
+    for(auto i: nodes) {
+        if(layout.lane(i) == TimelineLayout::NO_LANE || !shown(i)) {
+            continue;
+        }
+        auto rect = layout.rect(i);
+        colour_rects[events.colour_index(i)].push_back(rect);
+        if(events.is_bad(i)) {
+            bad_rects.push_back(rect);
+        }
+    }
+    painter->setPen(QPen());
+    for(size_t colour=0; colour<colour_rects.size(); colour++) {
+        const auto& rects = colour_rects[colour];
+        if(!rects.empty()) {
+            painter->setBrush(brushes[colour]);
+            painter->drawRects(rects.data(), static_cast<int>(rects.size()));
+        }
+    }
+    if(!bad_rects.empty()) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(FAILURE_TINT);
+        painter->drawRects(bad_rects.data(), static_cast<int>(bad_rects.size()));
+        painter->setPen(QPen());
+    }
+    layout.for_each_edge(area.left(), area.right(), [&](size_t node, size_t parent) {
+        if(layout.node_visible(node) && layout.node_visible(parent)) {
+            edge_lines.emplace_back(layout.rect(node).topLeft(), layout.rect(parent).topRight());
+        }
+    });
+    painter->drawLines(edge_lines.data(), static_cast<int>(edge_lines.size()));
+    for(uint32_t lane=0; lane<layout.lane_count(); lane++) {
+        if(layout.lane_mode(lane) == LaneMode::collapsed) {
+            paint_lane_summary(painter, lane, area.left(), area.right(), scale, false, layers);
+        }
+    }
+
+    if(legible && layers == PaintLayers::all) {
+        draw_labels();
+    }
+}
+
+void TimelinePainter::paint_lane_summary(QPainter* painter, uint32_t lane, qreal left, qreal right, qreal scale, bool legible, PaintLayers layers) {
+    const auto& summary = layout.summary(lane);
+    if(summary.levels() == 0) {
+        return;
+    }
+    const auto& blocks = summary.level(summary.level_for(MIN_NODE_PIXELS / scale));
+    auto top = layout.lane_top(lane);
+    auto height = layout.lane_height() - 2.0*TimelineLayout::MARGIN;
+    if(lane != TimelineLayout::NO_LANE && layout.lane_mode(lane) == LaneMode::collapsed) {
+        top += layout.row_height(lane) / 4.0;
+        height = layout.row_height(lane) / 2.0;
+        legible = false;
+    }
+    // Blocks in a level don't overlap so they're sorted by both ends
+    auto first = std::lower_bound(blocks.begin(), blocks.end(), left, [](const SummaryBlock& block, qreal x) {
+        return block.right < x;
+    });
+    auto last = first;
+    while(last != blocks.end() && last->left <= right) {
+        ++last;
+    }
+    if(layers != PaintLayers::text) {
+        summary_rects.clear();
+        bad_rects.clear();
+        for(auto it=first; it!=last; ++it) {
+            QRectF rect(it->left, top, it->right - it->left, height);
+            (it->bad > 0 ? bad_rects : summary_rects).push_back(rect);
+        }
+        painter->setPen(QPen());
+        painter->setBrush(QColor(200, 200, 200));
+        painter->drawRects(summary_rects.data(), static_cast<int>(summary_rects.size()));
+        painter->setBrush(QColor(255, 0, 0, 90));
+        painter->drawRects(bad_rects.data(), static_cast<int>(bad_rects.size()));
+    }
+    if(legible && layers != PaintLayers::shapes) {
+        painter->setPen(Qt::black);
+        for(auto it=first; it!=last; ++it) {
+            QRectF rect(it->left, top, it->right - it->left, height);
+            auto text = QString::number(it->count);
+            if(labels.metrics().horizontalAdvance(text) + 2.0*TEXT_MARGIN <= rect.width()) {
+                painter->drawText(rect.adjusted(TEXT_MARGIN, TEXT_MARGIN, -TEXT_MARGIN, -TEXT_MARGIN), Qt::AlignLeft | Qt::AlignTop, text);
+            }
+        }
+    }
+}
+
+void TimelinePainter::paint_summary(QPainter* painter, qreal left, qreal right, qreal scale, bool legible, PaintLayers layers) {
+    painter->setFont(labels.font());
+    for(uint32_t lane=0; lane<layout.lane_count(); lane++) {
+        if(layout.lane_mode(lane) != LaneMode::hidden) {
+            paint_lane_summary(painter, lane, left, right, scale, legible, layers);
+        }
+    }
+    paint_lane_summary(painter, TimelineLayout::NO_LANE, left, right, scale, legible, layers);
+}
@@ -0,0 +1,46 @@
+#ifndef TIMELINE_PAINTER_H
+#define TIMELINE_PAINTER_H
+
+#include <QBrush>
+#include <QPainter>
+#include <vector>
+#include "event_store.h"
+#include "label_cache.h"
+#include "timeline_layout.h"
+
+// What paint draws. Text can be left to the GUI thread where fonts can't be drawn on others.
+enum class PaintLayers {
+    all,
+    shapes,
+    text
+};
+
+// Draws part of the timeline straight from the layout. The timeline item paints with one and
+// every tile rendering thread has its own, they keep buffers between paints so can't be shared.
+class TimelinePainter {
+public:
+    // Below this many pixels between nodes lanes are drawn as summary blocks
+    static constexpr qreal MIN_NODE_PIXELS = 4.0;
+
+    TimelinePainter(const EventStore& events, const TimelineLayout& layout, LabelCache& labels);
+
+    // Draws what's in exposed at scale pixels per scene unit
+    void paint(QPainter* painter, const QRectF& exposed, qreal scale, PaintLayers layers = PaintLayers::all);
+private:
+    void paint_nodes(QPainter* painter, const QRectF& area, qreal scale, bool legible, PaintLayers layers);
+    void paint_summary(QPainter* painter, qreal left, qreal right, qreal scale, bool legible, PaintLayers layers);
+    void paint_lane_summary(QPainter* painter, uint32_t lane, qreal left, qreal right, qreal scale, bool legible, PaintLayers layers);
+
+    const EventStore& events;
+    const TimelineLayout& layout;
+    LabelCache& labels;
+    // One brush per node colour, indexed by EventStore::colour_index
+    std::vector<QBrush> brushes;
+    // Reused between paints so drawing doesn't allocate once they've grown
+    std::vector<std::vector<QRectF>> colour_rects;
+    std::vector<QRectF> bad_rects;
+    std::vector<QRectF> summary_rects;
+    std::vector<QLineF> edge_lines;
+};
+
+#endif // TIMELINE_PAINTER_H
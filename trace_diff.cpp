@@ -0,0 +1,474 @@
+#include "trace_diff.h"
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+static constexpr int MAX_THREADS = 16;
+// Stretches this short get a full Myers diff, up to MAX_EDITS edits
+static constexpr size_t SMALL_RANGE = 4096;
+static constexpr size_t MAX_EDITS = 512;
+// Roughly how much work a Myers diff of a long stretch is allowed before giving up on it
+static constexpr size_t MYERS_BUDGET = size_t(1) << 23;
+// Diffing a group gives up after this much work per event, so two runs that have little in
+// common don't take forever to say so. Hashing for anchors costs more per event than a step
+// of Myers.
+static constexpr size_t WORK_PER_EVENT = 32;
+static constexpr size_t ANCHOR_WORK = 8;
+// How many times long stretches get split around unique events before pairing off the rest
+static constexpr int MAX_DEPTH = 8;
+static constexpr uint32_t UNMATCHED = UINT32_MAX;
+
+static uint64_t mix(uint64_t h, uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    h *= 0xff51afd7ed558ccdull;
+    return h ^ (h >> 33);
+}
+
+static uint64_t hash_bytes(std::string_view bytes) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for(auto c: bytes) {
+        h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+void RunSignatures::clear() {
+    *this = RunSignatures();
+}
+
+size_t RunSignatures::size() const {
+    return node_signatures.size();
+}
+
+uint64_t RunSignatures::signature(size_t node) const {
+    auto file = node_files[node];
+    return file == 0 ? node_signatures[node] : mix(node_signatures[node], file_hashes[file]);
+}
+
+const std::vector<uint32_t>& RunSignatures::groups() const {
+    return node_groups;
+}
+
+const std::vector<uint64_t>& RunSignatures::group_keys() const {
+    return keys;
+}
+
+void RunSignatures::reroot_files(const QDir& root) {
+    for(uint32_t id=1; id<files.size(); id++) {
+        auto relative = root.relativeFilePath(files.get(id)).toUtf8();
+        file_hashes[id] = hash_bytes(std::string_view(relative.constData(), static_cast<size_t>(relative.size()))) | 1;
+    }
+}
+
+uint32_t RunSignatures::group(uint64_t process) {
+    auto key = mix(launch, process);
+    auto id = group_ids.find(key);
+    if(id == group_ids.end()) {
+        id = group_ids.emplace(key, static_cast<uint32_t>(keys.size())).first;
+        keys.push_back(key);
+    }
+    return id->second;
+}
+
+void RunSignatures::add(const EventStore& batch) {
+    // Hashed once per string rather than once per event. Batches from a snapshot share all
+    // of its strings so only the ones the batch uses are kept.
+    std::unordered_map<uint32_t, uint64_t> string_hashes;
+    auto hash_string = [&](uint32_t id) {
+        auto found = string_hashes.find(id);
+        if(found == string_hashes.end()) {
+            found = string_hashes.emplace(id, hash_bytes(batch.strings().bytes(id))).first;
+        }
+        return found->second;
+    };
+    std::unordered_map<uint32_t, uint32_t> file_ids;
+    auto file_id = [&](uint32_t id) {
+        auto found = file_ids.find(id);
+        if(found == file_ids.end()) {
+            auto bytes = batch.strings().bytes(id);
+            auto file = files.intern(bytes);
+            if(file >= file_hashes.size()) {
+                file_hashes.push_back(hash_bytes(bytes) | 1);
+            }
+            found = file_ids.emplace(id, file).first;
+        }
+        return found->second;
+    };
+    for(size_t row=0; row<batch.size(); row++) {
+        auto kind = batch.kind(row);
+        if(kind == EventKind::marker) {
+            continue;
+        }
+        auto signature = mix(0, static_cast<uint64_t>(kind));
+        uint32_t file = 0;
+        uint64_t process = 0;
+        if(kind == EventKind::config) {
+            auto name = batch.config(row).name.toUtf8();
+            signature = mix(signature, hash_bytes(std::string_view(name.constData(), static_cast<size_t>(name.size()))));
+        } else if(kind == EventKind::binary) {
+            auto path = batch.binary(row).path.toUtf8();
+            auto binary = hash_bytes(std::string_view(path.constData(), static_cast<size_t>(path.size())));
+            signature = mix(signature, binary);
+            // Processes are numbered afresh for every launch
+            launch = mix(binary, launches[binary]++);
+            processes.clear();
+            roots = 0;
+        } else {
+            signature = mix(signature, hash_string(batch.description_id(row)));
+            if(batch.has(row, EventStore::HAS_LOCATION)) {
+                signature = mix(mix(signature, 0x300), static_cast<uint64_t>(*batch.line(row)));
+                file = file_id(batch.file_id(row));
+            }
+            if(auto signal = batch.signal(row)) {
+                signature = mix(signature, 0x100 + static_cast<uint64_t>(*signal));
+            }
+            if(auto ret = batch.ret(row)) {
+                signature = mix(mix(signature, 0x200), *ret);
+            }
+            if(auto pid = batch.pid(row)) {
+                auto found = processes.find(*pid);
+                if(found == processes.end()) {
+                    found = processes.emplace(*pid, Process{mix(1, roots++), 0}).first;
+                }
+                process = found->second.key;
+                // A child is known by its parent and how many children the parent had before it
+                if(auto child = batch.child(row)) {
+                    processes[*child] = Process{mix(process, found->second.children++), 0};
+                }
+            }
+        }
+        node_signatures.push_back(signature);
+        node_files.push_back(file);
+        node_groups.push_back(group(process));
+    }
+}
+
+namespace {
+// Nodes of every group in node order, a group's nodes are nodes[offsets[g]..offsets[g + 1])
+struct GroupNodes {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> nodes;
+};
+
+GroupNodes group_nodes(const RunSignatures& run) {
+    GroupNodes out;
+    out.offsets.assign(run.group_keys().size() + 1, 0);
+    for(auto group: run.groups()) {
+        out.offsets[group + 1]++;
+    }
+    for(size_t g=1; g<out.offsets.size(); g++) {
+        out.offsets[g] += out.offsets[g - 1];
+    }
+    out.nodes.resize(run.size());
+    auto next = out.offsets;
+    for(size_t node=0; node<run.size(); node++) {
+        out.nodes[next[run.groups()[node]]++] = static_cast<uint32_t>(node);
+    }
+    return out;
+}
+
+// Matches up two sequences of signatures, both matches are increasing on both sides
+class Aligner {
+public:
+    Aligner(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b):
+        a(a),
+        b(b),
+        a_match(a.size(), UNMATCHED),
+        b_match(b.size(), UNMATCHED),
+        work_left((a.size() + b.size()) * WORK_PER_EVENT)
+    {
+    }
+
+    void run() {
+        align(0, a.size(), 0, b.size(), 0);
+    }
+
+    const std::vector<uint64_t>& a;
+    const std::vector<uint64_t>& b;
+    std::vector<uint32_t> a_match;
+    std::vector<uint32_t> b_match;
+private:
+    size_t work_left;
+
+    void match(size_t i, size_t j) {
+        a_match[i] = static_cast<uint32_t>(j);
+        b_match[j] = static_cast<uint32_t>(i);
+    }
+
+    void align(size_t a0, size_t a1, size_t b0, size_t b1, int depth) {
+        while(a0 < a1 && b0 < b1 && a[a0] == b[b0]) {
+            match(a0++, b0++);
+        }
+        while(a0 < a1 && b0 < b1 && a[a1 - 1] == b[b1 - 1]) {
+            match(--a1, --b1);
+        }
+        if(a0 == a1 || b0 == b1) {
+            return;
+        }
+        auto size = (a1 - a0) + (b1 - b0);
+        if(size <= SMALL_RANGE && myers(a0, a1, b0, b1, MAX_EDITS)) {
+            return;
+        }
+        if(depth < MAX_DEPTH && anchor(a0, a1, b0, b1, depth)) {
+            return;
+        }
+        // Repetitive stretches with nothing unique in them, like a loop that ran a different
+        // number of times, can still be cheap for Myers
+        myers(a0, a1, b0, b1, std::min(MAX_EDITS, MYERS_BUDGET / size));
+    }
+
+    // Gives up without matching anything if it takes more than max_d edits
+    bool myers(size_t a0, size_t a1, size_t b0, size_t b1, size_t max_d) {
+        auto n = static_cast<int64_t>(a1 - a0);
+        auto m = static_cast<int64_t>(b1 - b0);
+        auto limit = std::min<int64_t>(static_cast<int64_t>(max_d), n + m);
+        if(limit <= 0) {
+            return false;
+        }
+        // v[k] is the furthest x on diagonal k, trace keeps v[-d..d] as it was before step d
+        std::vector<int64_t> v(2 * limit + 3, 0);
+        auto offset = limit + 1;
+        std::vector<std::vector<int64_t>> trace;
+        for(int64_t d=0; d<=limit; d++) {
+            trace.emplace_back(v.begin() + (offset - d - 1), v.begin() + (offset + d + 2));
+            for(int64_t k=-d; k<=d; k+=2) {
+                if(work_left == 0) {
+                    return false;
+                }
+                work_left--;
+                int64_t x;
+                if(k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) {
+                    x = v[offset + k + 1];
+                } else {
+                    x = v[offset + k - 1] + 1;
+                }
+                auto y = x - k;
+                auto start = x;
+                while(x < n && y < m && a[a0 + x] == b[b0 + y]) {
+                    x++;
+                    y++;
+                }
+                work_left -= std::min<size_t>(work_left, static_cast<size_t>(x - start));
+                v[offset + k] = x;
+                if(x >= n && y >= m) {
+                    backtrack(trace, a0, b0, n, m, d);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void backtrack(const std::vector<std::vector<int64_t>>& trace, size_t a0, size_t b0, int64_t x, int64_t y, int64_t edits) {
+        for(auto d=edits; d>0; d--) {
+            // trace[d] starts at diagonal -d-1
+            const auto& before = trace[d];
+            auto at = [&](int64_t k) {
+                return before[k + d + 1];
+            };
+            auto k = x - y;
+            int64_t previous_k;
+            if(k == -d || (k != d && at(k - 1) < at(k + 1))) {
+                previous_k = k + 1;
+            } else {
+                previous_k = k - 1;
+            }
+            auto previous_x = at(previous_k);
+            auto previous_y = previous_x - previous_k;
+            while(x > previous_x && y > previous_y) {
+                x--;
+                y--;
+                match(a0 + x, b0 + y);
+            }
+            x = previous_x;
+            y = previous_y;
+        }
+        while(x > 0 && y > 0) {
+            x--;
+            y--;
+            match(a0 + x, b0 + y);
+        }
+    }
+
+    // Splits the stretch around the longest run of in order events that appear exactly once
+    // on both sides, like patience diff
+    bool anchor(size_t a0, size_t a1, size_t b0, size_t b1, int depth) {
+        auto cost = ((a1 - a0) + (b1 - b0)) * ANCHOR_WORK;
+        if(cost > work_left) {
+            return false;
+        }
+        work_left -= cost;
+        struct Count {
+            uint32_t a_count = 0;
+            uint32_t b_count = 0;
+            size_t a_pos = 0;
+            size_t b_pos = 0;
+        };
+        std::unordered_map<uint64_t, Count> counts;
+        counts.reserve(a1 - a0);
+        for(auto i=a0; i<a1; i++) {
+            auto& count = counts[a[i]];
+            count.a_count++;
+            count.a_pos = i;
+        }
+        for(auto j=b0; j<b1; j++) {
+            auto found = counts.find(b[j]);
+            if(found != counts.end()) {
+                found->second.b_count++;
+                found->second.b_pos = j;
+            }
+        }
+        std::vector<std::pair<size_t, size_t>> unique;
+        for(auto i=a0; i<a1; i++) {
+            const auto& count = counts[a[i]];
+            if(count.a_count == 1 && count.b_count == 1) {
+                unique.emplace_back(i, count.b_pos);
+            }
+        }
+        counts = std::unordered_map<uint64_t, Count>();
+        if(unique.empty()) {
+            return false;
+        }
+        // Longest increasing run of b positions, patience sorting with links back
+        std::vector<size_t> tails;
+        std::vector<size_t> previous(unique.size(), SIZE_MAX);
+        for(size_t u=0; u<unique.size(); u++) {
+            auto it = std::lower_bound(tails.begin(), tails.end(), unique[u].second, [&](size_t t, size_t pos) {
+                return unique[t].second < pos;
+            });
+            if(it != tails.begin()) {
+                previous[u] = *(it - 1);
+            }
+            if(it == tails.end()) {
+                tails.push_back(u);
+            } else {
+                *it = u;
+            }
+        }
+        std::vector<size_t> anchors;
+        for(auto u=tails.back(); u!=SIZE_MAX; u=previous[u]) {
+            anchors.push_back(u);
+        }
+        std::reverse(anchors.begin(), anchors.end());
+        auto i = a0;
+        auto j = b0;
+        for(auto u: anchors) {
+            align(i, unique[u].first, j, unique[u].second, depth + 1);
+            match(unique[u].first, unique[u].second);
+            i = unique[u].first + 1;
+            j = unique[u].second + 1;
+        }
+        align(i, a1, j, b1, depth + 1);
+        return true;
+    }
+};
+
+void start_side(DiffSide& side, size_t nodes) {
+    side.status.assign(nodes, DiffStatus::only_here);
+    side.matches.assign(nodes, DiffSide::NO_MATCH);
+}
+
+void finish_side(DiffSide& side) {
+    for(size_t node=0; node<side.status.size(); node++) {
+        if(side.status[node] != DiffStatus::same) {
+            side.differences.push_back(static_cast<uint32_t>(node));
+            if(side.status[node] == DiffStatus::changed) {
+                side.changed++;
+            } else {
+                side.only_here++;
+            }
+        }
+    }
+}
+
+// Groups are independent and their nodes never overlap so each can be written from any thread
+void diff_group(const RunSignatures& left, const uint32_t* left_nodes, size_t left_size, const RunSignatures& right, const uint32_t* right_nodes, size_t right_size, TraceDiff& diff) {
+    std::vector<uint64_t> a(left_size);
+    std::vector<uint64_t> b(right_size);
+    for(size_t i=0; i<left_size; i++) {
+        a[i] = left.signature(left_nodes[i]);
+    }
+    for(size_t j=0; j<right_size; j++) {
+        b[j] = right.signature(right_nodes[j]);
+    }
+    Aligner aligner(a, b);
+    aligner.run();
+    auto pair = [&](size_t i, size_t j, DiffStatus status) {
+        diff.left.status[left_nodes[i]] = status;
+        diff.left.matches[left_nodes[i]] = right_nodes[j];
+        diff.right.status[right_nodes[j]] = status;
+        diff.right.matches[right_nodes[j]] = left_nodes[i];
+    };
+    // Unmatched events between the same two matches are paired off in order as changed
+    size_t i = 0;
+    size_t j = 0;
+    while(i < left_size || j < right_size) {
+        auto next_i = i;
+        while(next_i < left_size && aligner.a_match[next_i] == UNMATCHED) {
+            next_i++;
+        }
+        auto next_j = next_i < left_size ? static_cast<size_t>(aligner.a_match[next_i]) : right_size;
+        for(size_t k=0; i + k < next_i && j + k < next_j; k++) {
+            pair(i + k, j + k, DiffStatus::changed);
+        }
+        if(next_i == left_size) {
+            break;
+        }
+        pair(next_i, next_j, DiffStatus::same);
+        i = next_i + 1;
+        j = next_j + 1;
+    }
+}
+}
+
+TraceDiff diff_runs(const RunSignatures& left, const RunSignatures& right) {
+    TraceDiff diff;
+    start_side(diff.left, left.size());
+    start_side(diff.right, right.size());
+    auto left_groups = group_nodes(left);
+    auto right_groups = group_nodes(right);
+
+    // Groups only in one run are left as only_here
+    std::unordered_map<uint64_t, uint32_t> right_ids;
+    for(size_t g=0; g<right.group_keys().size(); g++) {
+        right_ids.emplace(right.group_keys()[g], static_cast<uint32_t>(g));
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> work;
+    for(size_t g=0; g<left.group_keys().size(); g++) {
+        auto found = right_ids.find(left.group_keys()[g]);
+        if(found != right_ids.end()) {
+            work.emplace_back(static_cast<uint32_t>(g), found->second);
+        }
+    }
+    auto size = [&](const std::pair<uint32_t, uint32_t>& w) {
+        return left_groups.offsets[w.first + 1] - left_groups.offsets[w.first] + right_groups.offsets[w.second + 1] - right_groups.offsets[w.second];
+    };
+    // Biggest first so one huge group doesn't start last and hold everything up
+    std::sort(work.begin(), work.end(), [&](const auto& x, const auto& y) {
+        return size(x) > size(y);
+    });
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for(auto w = next++; w < work.size(); w = next++) {
+            auto [l, r] = work[w];
+            auto l_begin = left_groups.offsets[l];
+            auto r_begin = right_groups.offsets[r];
+            diff_group(left, left_groups.nodes.data() + l_begin, left_groups.offsets[l + 1] - l_begin,
+                       right, right_groups.nodes.data() + r_begin, right_groups.offsets[r + 1] - r_begin, diff);
+        }
+    };
+    auto threads = std::min<size_t>(std::clamp(QThread::idealThreadCount(), 1, MAX_THREADS), std::max<size_t>(work.size(), 1));
+    std::vector<std::thread> workers;
+    for(size_t t=1; t<threads; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for(auto& thread: workers) {
+        thread.join();
+    }
+    finish_side(diff.left);
+    finish_side(diff.right);
+    return diff;
+}
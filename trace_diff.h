@@ -0,0 +1,90 @@
+#ifndef TRACE_DIFF_H
+#define TRACE_DIFF_H
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "event_store.h"
+
+// What a node has on the other side of a diff
+enum class DiffStatus: uint8_t {
+    same,
+    // Lined up with a different event in the other run
+    changed,
+    // Nothing in the other run lines up with it
+    only_here
+};
+
+// Events of one run boiled down to what's compared. Each node gets a hash of its description,
+// location, signal and return value, and a group for the process it ran in, which is the
+// binary, which launch of it, and where the process sits in the fork tree. Pids differ from
+// run to run so they're never compared directly. Built up a batch at a time. Files are only
+// hashed in when a signature is asked for so they can still be rerooted after the fact.
+class RunSignatures {
+public:
+    void clear();
+
+    void add(const EventStore& batch);
+
+    size_t size() const;
+
+    uint64_t signature(size_t node) const;
+
+    // Per node
+    const std::vector<uint32_t>& groups() const;
+
+    // Per group, the same group in another run has the same key
+    const std::vector<uint64_t>& group_keys() const;
+
+    // For paths that were added as the log had them before its root was known
+    void reroot_files(const QDir& root);
+private:
+    struct Process {
+        uint64_t key;
+        uint32_t children;
+    };
+
+    uint32_t group(uint64_t process);
+
+    // Everything but the file, which is an id in files
+    std::vector<uint64_t> node_signatures;
+    std::vector<uint32_t> node_files;
+    StringPool files;
+    std::vector<uint64_t> file_hashes{0};
+    std::vector<uint32_t> node_groups;
+    std::vector<uint64_t> keys;
+    std::unordered_map<uint64_t, uint32_t> group_ids;
+    // Which launch of which binary events are in at the moment
+    std::unordered_map<uint64_t, uint32_t> launches;
+    uint64_t launch = 0;
+    std::unordered_map<uint64_t, Process> processes;
+    uint32_t roots = 0;
+};
+
+// One run's side of a diff, indexed by node
+struct DiffSide {
+    std::vector<DiffStatus> status;
+    // The node it lines up with in the other run, NO_MATCH if it's only here
+    std::vector<uint32_t> matches;
+    // Every node that isn't the same, in order
+    std::vector<uint32_t> differences;
+    size_t changed = 0;
+    size_t only_here = 0;
+
+    static constexpr uint32_t NO_MATCH = UINT32_MAX;
+};
+
+struct TraceDiff {
+    DiffSide left;
+    DiffSide right;
+};
+
+// Lines up the two runs a process group at a time, on as many threads as there are cores.
+// Within a group common ends are trimmed, short stretches get a proper Myers diff and
+// long ones are split around events that appear once on each side, so it stays close to
+// linear however big the logs are. Whatever's left between matches is paired off in order
+// as changed events, the rest are only on one side.
+TraceDiff diff_runs(const RunSignatures& left, const RunSignatures& right);
+
+#endif // TRACE_DIFF_H
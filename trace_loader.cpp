@@ -0,0 +1,205 @@
+#include "trace_loader.h"
+#include "event_cache.h"
+#include "mapped_reader.h"
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDebug>
+
+// A small first batch gets something on screen quickly, after that bigger batches keep
+// the number of round trips through the event loop down
+static constexpr size_t FIRST_BATCH = 2000;
+static constexpr size_t BATCH = 50000;
+// How long to wait after a change for more writes before reading them
+static constexpr int SETTLE_MS = 50;
+static constexpr int FALLBACK_POLL_MS = 1000;
+
+trace_loader::trace_loader(QObject* parent):
+    QObject(parent)
+{
+    qRegisterMetaType<EventBatch>("EventBatch");
+}
+
+int trace_loader::next_generation() {
+    return ++latest;
+}
+
+void trace_loader::cancel() {
+    latest++;
+}
+
+void trace_loader::set_phase_log(PhaseLog* log) {
+    phases = log;
+}
+
+void trace_loader::load(const QString& path, int generation) {
+    auto cancelled = [this, generation]() {
+        return latest.load(std::memory_order_relaxed) != generation;
+    };
+    stop_following();
+    if(cancelled()) {
+        return;
+    }
+    QFile input(path);
+    if(!input.open(QIODevice::ReadOnly)) {
+        emit finished(generation, false, QString("Couldn't open %1").arg(path));
+        return;
+    }
+    EventStore batch;
+    size_t batch_size = FIRST_BATCH;
+    int percent = -1;
+    auto report = [&](qint64 done, qint64 total) {
+        auto now = total > 0 ? static_cast<int>(done * 100 / total) : 0;
+        if(now != percent) {
+            percent = now;
+            emit progress(generation, done, total);
+        }
+    };
+
+    EventCache cache(path);
+    size_t cached_events = 0;
+    auto cached = EventCache::Result::missing;
+    {
+        PhaseTimer timer(phases, "cache read");
+        cached = cache.read([&](EventStore& events) {
+            cached_events += events.size();
+            timer.add(static_cast<qint64>(events.size()));
+            emit events_ready(generation, std::make_shared<const EventStore>(std::move(events)));
+        }, cancelled, report);
+    }
+    if(cached == EventCache::Result::read) {
+        qDebug()<<cached_events<<" events read from"<<cache.path();
+        emit finished(generation, true, QString("Loaded %1 events from cache").arg(cached_events));
+        return;
+    }
+    if(cached == EventCache::Result::cancelled || cancelled()) {
+        return;
+    }
+    if(cached == EventCache::Result::damaged) {
+        // Whatever was shown from the snapshot is dropped and the log's parsed from the start
+        emit restarted(generation);
+        percent = -1;
+    }
+
+    auto caching = cache.begin_write();
+    MappedEventReader reader(&input);
+    reader.set_cancel(cancelled);
+    reader.set_progress(report);
+    reader.set_phase_log(phases);
+    auto send = [&]() {
+        auto events = std::make_shared<const EventStore>(std::move(batch));
+        if(caching) {
+            PhaseTimer timer(phases, "cache write");
+            cache.write(*events);
+        }
+        emit events_ready(generation, events);
+        batch.clear();
+    };
+    auto result = reader.read([&](EventStore& events) {
+        if(batch.empty()) {
+            batch = std::move(events);
+        } else {
+            batch.append(events);
+        }
+        if(batch.size() >= batch_size) {
+            send();
+            batch_size = BATCH;
+        }
+    });
+    if(!batch.empty()) {
+        send();
+    }
+    // Compressed logs only get to their manifest after the events, everything so far has
+    // its paths as they were written
+    if(reader.rooted_late()) {
+        emit root_found(generation, reader.root().path());
+    }
+    // Only complete logs are worth keeping, a truncated one is probably still being written
+    if(caching && result && !reader.truncated() && !cancelled()) {
+        PhaseTimer timer(phases, "cache write");
+        if(reader.rooted_late()) {
+            cache.reroot_files(reader.root());
+        }
+        cache.commit();
+    }
+    qDebug()<<reader.events_read()<<" events found";
+    emit finished(generation, result, reader.error());
+}
+
+void trace_loader::follow(const QString& path, int generation) {
+    stop_following();
+    if(latest.load(std::memory_order_relaxed) != generation) {
+        return;
+    }
+    tail = std::make_unique<TailReader>(path);
+    tail_generation = generation;
+    watcher = new QFileSystemWatcher(QStringList{path}, this);
+    settle = new QTimer(this);
+    settle->setSingleShot(true);
+    settle->setInterval(SETTLE_MS);
+    fallback = new QTimer(this);
+    fallback->setInterval(FALLBACK_POLL_MS);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, [this, path]() {
+        // Some writers replace the file which drops it from the watcher
+        if(watcher && !watcher->files().contains(path)) {
+            watcher->addPath(path);
+        }
+        if(settle && !settle->isActive()) {
+            settle->start();
+        }
+    });
+    connect(settle, &QTimer::timeout, this, &trace_loader::poll_tail);
+    connect(fallback, &QTimer::timeout, this, &trace_loader::poll_tail);
+    fallback->start();
+    poll_tail();
+}
+
+void trace_loader::poll_tail() {
+    if(!tail) {
+        return;
+    }
+    auto generation = tail_generation;
+    if(latest.load(std::memory_order_relaxed) != generation) {
+        stop_following();
+        return;
+    }
+    PhaseTimer timer(phases, "tail");
+    bool read_any = false;
+    auto ok = tail->poll([&](EventStore& events) {
+        read_any = true;
+        timer.add(static_cast<qint64>(events.size()));
+        emit events_ready(generation, std::make_shared<const EventStore>(std::move(events)));
+    });
+    // Most polls find nothing new, only the ones that did are worth a span
+    if(!read_any) {
+        timer.discard();
+    }
+    if(!ok) {
+        emit finished(generation, false, tail->error());
+        stop_following();
+    } else if(tail->complete()) {
+        if(tail->rooted_late()) {
+            emit root_found(generation, tail->root().path());
+        }
+        qDebug()<<tail->events_read()<<" events found";
+        emit finished(generation, true, QString("Log finished, %1 events").arg(tail->events_read()));
+        stop_following();
+    } else {
+        emit progress(generation, tail->offset(), 0);
+    }
+}
+
+void trace_loader::stop_following() {
+    // Timers and the watcher can still have queued signals so they're deleted later
+    for(QObject* object: {static_cast<QObject*>(watcher), static_cast<QObject*>(settle), static_cast<QObject*>(fallback)}) {
+        if(object) {
+            object->disconnect(this);
+            object->deleteLater();
+        }
+    }
+    watcher = nullptr;
+    settle = nullptr;
+    fallback = nullptr;
+    tail.reset();
+    tail_generation = -1;
+}
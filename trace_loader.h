@@ -0,0 +1,74 @@
+#ifndef TRACE_LOADER_H
+#define TRACE_LOADER_H
+
+#include <QObject>
+#include <QMetaType>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include "event_store.h"
+#include "phase_log.h"
+#include "tail_reader.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Shared so queued connections don't copy the columns
+using EventBatch = std::shared_ptr<const EventStore>;
+Q_DECLARE_METATYPE(EventBatch)
+
+// Lives on a worker thread and reads logs there, handing events back in batches so the
+// view can start drawing before the whole log is in. Every load gets a generation number
+// and starting a new one or calling cancel stops whatever load is running.
+class trace_loader: public QObject
+{
+    Q_OBJECT
+public:
+    explicit trace_loader(QObject* parent = nullptr);
+
+    // Both of these are safe to call from any thread
+    int next_generation();
+
+    void cancel();
+
+    // Loads time their phases into log, set before the loader thread starts
+    void set_phase_log(PhaseLog* log);
+public slots:
+    void load(const QString& path, int generation);
+
+    // Reads a log that's still being written and keeps reading whatever's added to it until
+    // the events array is closed or the load is cancelled
+    void follow(const QString& path, int generation);
+signals:
+    void events_ready(int generation, EventBatch events);
+
+    void progress(int generation, qint64 done, qint64 total);
+
+    // Every batch of the generation so far has to be thrown away, the same generation then
+    // starts again from its first event. Sent in order with events_ready so a receiver on
+    // another thread gets it after the batches it replaces.
+    void restarted(int generation);
+
+    // The project root only turned up after the batches so far were sent, their paths are
+    // as the log has them and should be made relative to root. Sent in order with
+    // events_ready like restarted.
+    void root_found(int generation, const QString& root);
+
+    void finished(int generation, bool success, const QString& message);
+private:
+    void poll_tail();
+    void stop_following();
+
+    std::atomic<int> latest{0};
+    PhaseLog* phases = nullptr;
+
+    std::unique_ptr<TailReader> tail;
+    int tail_generation = -1;
+    QFileSystemWatcher* watcher = nullptr;
+    // Change notifications can come thick and fast so they're gathered up into one read
+    QTimer* settle = nullptr;
+    // Change notifications aren't guaranteed everywhere so there's a slow poll as well
+    QTimer* fallback = nullptr;
+};
+
+#endif // TRACE_LOADER_H
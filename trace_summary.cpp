@@ -0,0 +1,207 @@
+#include "trace_summary.h"
+#include "mapped_reader.h"
+#include "phase_log.h"
+#include "timeline_export.h"
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <cstring>
+
+void TraceSummary::add(const EventStore& batch) {
+    for(size_t row=0; row<batch.size(); row++) {
+        auto kind = batch.kind(row);
+        kinds[static_cast<size_t>(kind)]++;
+        if(kind == EventKind::marker) {
+            continue;
+        }
+        auto node = nodes++;
+        if(live_processes.add(batch, row, node) != ProcessIndex::NO_PARENT) {
+            linked++;
+        }
+        // The failure index already knows when a binary first goes wrong
+        auto panics = failures.count(FailureKind::unexpected_panic);
+        failures.add(batch, row, node);
+        if(current_binary && failures.count(FailureKind::unexpected_panic) > panics) {
+            current_binary->unexpected_panics++;
+        }
+        if(kind == EventKind::binary) {
+            auto bin = batch.binary(row);
+            current_binary = &binaries[bin.path];
+            current_binary->launches++;
+            current_binary->should_panic = bin.should_panic;
+        } else if(kind == EventKind::trace) {
+            auto pid = batch.pid(row);
+            if(pid) {
+                pids.insert(*pid);
+            }
+            auto bad = batch.is_bad(row);
+            bad_traces += bad;
+            if(current_binary) {
+                current_binary->traces++;
+                current_binary->bad_traces += bad;
+                if(pid) {
+                    current_binary->pids.insert(*pid);
+                }
+            }
+        }
+    }
+}
+
+QJsonObject TraceSummary::to_json() const {
+    QJsonObject kind_counts;
+    kind_counts["config"] = static_cast<qint64>(kinds[static_cast<size_t>(EventKind::config)]);
+    kind_counts["binary"] = static_cast<qint64>(kinds[static_cast<size_t>(EventKind::binary)]);
+    kind_counts["trace"] = static_cast<qint64>(kinds[static_cast<size_t>(EventKind::trace)]);
+    kind_counts["marker"] = static_cast<qint64>(kinds[static_cast<size_t>(EventKind::marker)]);
+
+    QJsonObject failure_counts;
+    failure_counts["total"] = static_cast<qint64>(failures.size());
+    failure_counts["bad_traces"] = static_cast<qint64>(bad_traces);
+    failure_counts["nonzero_return"] = static_cast<qint64>(failures.count(FailureKind::nonzero_return));
+    failure_counts["sigsegv"] = static_cast<qint64>(failures.count(FailureKind::sigsegv));
+    failure_counts["sigill"] = static_cast<qint64>(failures.count(FailureKind::sigill));
+    failure_counts["unexpected_panic"] = static_cast<qint64>(failures.count(FailureKind::unexpected_panic));
+
+    QJsonArray binary_list;
+    for(const auto& [path, stats]: binaries) {
+        QJsonObject bin;
+        bin["path"] = path;
+        bin["launches"] = static_cast<qint64>(stats.launches);
+        bin["traces"] = static_cast<qint64>(stats.traces);
+        bin["bad_traces"] = static_cast<qint64>(stats.bad_traces);
+        bin["pids"] = static_cast<qint64>(stats.pids.size());
+        bin["should_panic"] = stats.should_panic;
+        bin["unexpected_panics"] = static_cast<qint64>(stats.unexpected_panics);
+        binary_list.append(bin);
+    }
+
+    QJsonObject summary;
+    summary["events"] = static_cast<qint64>(nodes + kinds[static_cast<size_t>(EventKind::marker)]);
+    summary["kinds"] = kind_counts;
+    summary["pids"] = static_cast<qint64>(pids.size());
+    summary["linked_traces"] = static_cast<qint64>(linked);
+    summary["failures"] = failure_counts;
+    summary["binaries"] = binary_list;
+    return summary;
+}
+
+static QJsonObject summarise(const QString& path, PhaseLog* phases) {
+    QJsonObject result;
+    result["file"] = path;
+    QFile input(path);
+    if(!input.open(QIODevice::ReadOnly)) {
+        result["ok"] = false;
+        result["error"] = QString("Couldn't open %1").arg(path);
+        return result;
+    }
+    TraceSummary summary;
+    MappedEventReader reader(&input);
+    reader.set_phase_log(phases);
+    auto ok = reader.read([&](EventStore& events) {
+        PhaseTimer timer(phases, "summarise");
+        timer.add(static_cast<qint64>(events.size()));
+        summary.add(events);
+    });
+    auto counts = summary.to_json();
+    for(auto it=counts.begin(); it!=counts.end(); ++it) {
+        result[it.key()] = it.value();
+    }
+    result["ok"] = ok;
+    result["truncated"] = reader.truncated();
+    if(!reader.error().isEmpty()) {
+        result["error"] = reader.error();
+    }
+    return result;
+}
+
+// Also matches the --option=value form
+static bool has_option(int argc, char* argv[], const char* option) {
+    auto length = std::strlen(option);
+    for(int i=1; i<argc; i++) {
+        if(std::strncmp(argv[i], option, length) == 0 && (argv[i][length] == '\0' || argv[i][length] == '=')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int run_export(const QCommandLineParser& parser, const QStringList& logs) {
+    QTextStream err(stderr);
+    if(logs.size() != 1) {
+        err << "Exports take exactly one log\n";
+        return 1;
+    }
+    int code = 0;
+    QString error;
+    if(parser.isSet("svg") && !export_svg(logs.front(), parser.value("svg"), error)) {
+        err << "SVG export failed: " << error << "\n";
+        code = 1;
+    }
+    if(parser.isSet("png")) {
+        bool scale_ok = false;
+        bool tile_ok = false;
+        auto scale = parser.value("scale").toDouble(&scale_ok);
+        auto tile = parser.value("tile").toInt(&tile_ok);
+        if(!scale_ok || !tile_ok) {
+            err << "--scale and --tile have to be numbers\n";
+            code = 1;
+        } else if(!export_png_tiles(logs.front(), parser.value("png"), scale, tile, error)) {
+            err << "PNG export failed: " << error << "\n";
+            code = 1;
+        }
+    }
+    return code;
+}
+
+bool wants_cli(int argc, char* argv[]) {
+    // Timings on their own are for a headless load, so they get a summary too
+    return has_option(argc, argv, "--summary") || has_option(argc, argv, "--timings") || cli_draws(argc, argv);
+}
+
+bool cli_draws(int argc, char* argv[]) {
+    return has_option(argc, argv, "--svg") || has_option(argc, argv, "--png");
+}
+
+int run_cli(const QStringList& arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Reads tarpaulin event logs without the GUI");
+    parser.addHelpOption();
+    parser.addOption({"summary", "Print a JSON summary of each log, one per line."});
+    parser.addOption({"timings", "Write phase timings as a Chrome trace to <file>.", "file"});
+    parser.addOption({"svg", "Export the timeline of a log as an SVG to <file>.", "file"});
+    parser.addOption({"png", "Export the timeline of a log as PNG tiles into <directory>.", "directory"});
+    parser.addOption({"scale", "Pixels per timeline unit for --png, 1 is the viewer unzoomed.", "scale", "1"});
+    parser.addOption({"tile", "Width and height of each --png tile in pixels.", "pixels", "1024"});
+    parser.addPositionalArgument("logs", "Tarpaulin event logs to read.", "logs...");
+    parser.process(arguments);
+
+    auto logs = parser.positionalArguments();
+    if(logs.isEmpty()) {
+        parser.showHelp(1);
+    }
+    int code = 0;
+    if(parser.isSet("svg") || parser.isSet("png")) {
+        code = run_export(parser, logs);
+        if(!parser.isSet("summary")) {
+            return code;
+        }
+    }
+    QTextStream out(stdout);
+    PhaseLog phases;
+    auto timings = parser.value("timings");
+    for(const auto& log: logs) {
+        auto summary = summarise(log, timings.isEmpty() ? nullptr : &phases);
+        if(!summary["ok"].toBool()) {
+            code = 1;
+        }
+        out << QJsonDocument(summary).toJson(QJsonDocument::Compact) << "\n";
+        out.flush();
+    }
+    if(!timings.isEmpty() && !phases.write_chrome_trace(timings)) {
+        QTextStream(stderr) << "Couldn't write timings to " << timings << "\n";
+        code = 1;
+    }
+    return code;
+}
@@ -0,0 +1,51 @@
+#ifndef TRACE_SUMMARY_H
+#define TRACE_SUMMARY_H
+
+#include <QJsonObject>
+#include <QString>
+#include <array>
+#include <map>
+#include <set>
+#include "event_store.h"
+#include "failure_index.h"
+#include "process_index.h"
+
+// Counts for a whole trace built up a batch at a time, so nothing but the running totals
+// and the live process index is kept however big the log is. Nodes are numbered the same
+// way as on the timeline and linked with the same ProcessIndex.
+class TraceSummary {
+public:
+    void add(const EventStore& batch);
+
+    QJsonObject to_json() const;
+private:
+    struct BinaryStats {
+        size_t launches = 0;
+        size_t traces = 0;
+        size_t bad_traces = 0;
+        size_t unexpected_panics = 0;
+        bool should_panic = false;
+        std::set<uint64_t> pids;
+    };
+
+    std::array<size_t, 4> kinds{};
+    size_t nodes = 0;
+    size_t linked = 0;
+    size_t bad_traces = 0;
+    std::set<uint64_t> pids;
+    ProcessIndex live_processes;
+    FailureIndex failures;
+    std::map<QString, BinaryStats> binaries;
+    BinaryStats* current_binary = nullptr;
+};
+
+// Runs the command line tools, returns the exit code
+int run_cli(const QStringList& arguments);
+
+// True if the arguments ask for something that doesn't need the GUI
+bool wants_cli(int argc, char* argv[]);
+
+// True if the command line tools will be drawing, which needs fonts if not a display
+bool cli_draws(int argc, char* argv[]);
+
+#endif // TRACE_SUMMARY_H
@@ -3,7 +3,7 @@
 #include <QDebug>
 
 
-Signal str_to_sig(const QString& s) {
+Signal str_to_sig(std::string_view s) {
     if(s=="SIGHUP") {
         return Signal::sighup;
     } else if(s=="SIGINT") {
@@ -89,73 +89,66 @@ QString sig_to_str(Signal s) {
     return "UNKNOWN";
 }
 
-std::optional<uint64_t> get_pid(std::shared_ptr<Event> event) {
-    if(event) {
-        if(auto trace = std::get_if<TraceEvent>(event.get())) {
-            return trace->pid;
-        }
-    }
-    return std::nullopt;
-}
+float generate_hue(int ind, int length, float min_colour, float max_colour) {
+    auto index = static_cast<float>(ind);
+    auto total =  static_cast<float>(length);
 
-std::optional<uint64_t> get_child(std::shared_ptr<Event> event) {
-    if(event) {
-        if(auto trace = std::get_if<TraceEvent>(event.get())) {
-            return trace->child;
-        }
-    }
-    return std::nullopt;
+    return static_cast<int>((index/total) * (max_colour - min_colour) + min_colour);
 }
 
-bool is_end_node(std::shared_ptr<Event> event) {
-    if(event) {
-        if(auto trace = std::get_if<TraceEvent>(event.get())) {
-            return trace->ret.has_value();
-        }
-    }
-    return true;
+static constexpr int TRACE_COLOURS = static_cast<int>(Signal::_length) + 3;
+static constexpr int BINARY_COLOURS = static_cast<int>(RunType::_length) + 1;
 
+static QColor trace_colour_at(int index) {
+    auto total_traces = static_cast<int>(Signal::_length) + 2;
+    int hue = generate_hue(index, total_traces, 55.0, 355.0);
+    return QColor::fromHsv(hue, 127, 255);
 }
 
-float generate_hue(int ind, int length, float min_colour, float max_colour) {
-    auto index = static_cast<float>(ind);
-    auto total =  static_cast<float>(length);
+static QColor binary_colour_at(int index) {
+    auto total_traces = static_cast<int>(RunType::_length) + 1;
+    int hue = generate_hue(index, total_traces, 0, 55.0);
+    return QColor::fromHsv(hue, 127, 255);
+}
 
-    return static_cast<int>((index/total) * (max_colour - min_colour) + min_colour);
+size_t trace_colour_index(std::optional<Signal> signal, bool has_return) {
+    auto index = 0;
+    auto total_traces = static_cast<int>(Signal::_length) + 2;
+    if (signal) {
+        index = static_cast<int>(signal.value()) + 1;
+    } else if(has_return) {
+        index = total_traces;
+    }
+    return static_cast<size_t>(index);
 }
 
+size_t binary_colour_index(std::optional<RunType> ty) {
+    auto index = static_cast<int>(RunType::_length);
+    if (ty) {
+        index = static_cast<int>(ty.value());
+    }
+    return static_cast<size_t>(TRACE_COLOURS + index);
+}
 
-QColor get_node_colour(std::shared_ptr<Event> event) {
-    auto result = QColor();
-    if(event) {
-        if(auto trace = std::get_if<TraceEvent>(event.get())) {
-            auto index = 0;
-            auto total_traces = static_cast<int>(Signal::_length) + 2;
-            if (auto signal = trace->signal) {
-                index = static_cast<int>(signal.value()) + 1;
-            } else if(trace->ret) {
-                index = total_traces;
-            }
-            int hue = generate_hue(index, total_traces, 55.0, 355.0);
-            result = QColor::fromHsv(hue, 127, 255);
-        } else if (auto bin = std::get_if<TestBinary>(event.get())) {
-            auto index = static_cast<int>(RunType::_length);
-            auto total_traces =  index + 1;
-            if (auto signal = bin->ty) {
-                index = static_cast<int>(signal.value());
-            }
-            int hue = generate_hue(index, total_traces, 0, 55.0);
-            result = QColor::fromHsv(hue, 127, 255);
+const std::vector<QColor>& node_colours() {
+    static const std::vector<QColor> colours = []() {
+        std::vector<QColor> all;
+        for(int i=0; i<TRACE_COLOURS; i++) {
+            all.push_back(trace_colour_at(i));
         }
-    }
-    return result;
+        for(int i=0; i<BINARY_COLOURS; i++) {
+            all.push_back(binary_colour_at(i));
+        }
+        all.push_back(QColor());
+        return all;
+    }();
+    return colours;
 }
 
+QColor trace_colour(std::optional<Signal> signal, bool has_return) {
+    return node_colours()[trace_colour_index(signal, has_return)];
+}
 
-bool is_marker(std::shared_ptr<Event> event) {
-    if(event) {
-        return event->index() == 3;
-    } else {
-        return false;
-    }
+QColor binary_colour(std::optional<RunType> ty) {
+    return node_colours()[binary_colour_index(ty)];
 }
@@ -2,9 +2,10 @@
 #define TYPES_H
 
 #include <QString>
-#include <memory>
 #include <optional>
+#include <string_view>
 #include <variant>
+#include <vector>
 #include <QDebug>
 #include <QColor>
 
@@ -32,7 +33,7 @@ enum class Signal {
     _length
 };
 
-Signal str_to_sig(const QString& s);
+Signal str_to_sig(std::string_view s);
 
 QString sig_to_str(Signal s);
 
@@ -123,15 +124,17 @@ struct TraceEvent {
 
 using Event = std::variant<Config, TestBinary, TraceEvent, Marker>;
 
+QColor trace_colour(std::optional<Signal> signal, bool has_return);
 
-std::optional<uint64_t> get_child(std::shared_ptr<Event> event);
+QColor binary_colour(std::optional<RunType> ty);
 
-std::optional<uint64_t> get_pid(std::shared_ptr<Event> event);
+// Where trace_colour and binary_colour are in node_colours, so painting can pick from brushes
+// made once instead of making a colour per event
+size_t trace_colour_index(std::optional<Signal> signal, bool has_return);
 
-QColor get_node_colour(std::shared_ptr<Event> event);
+size_t binary_colour_index(std::optional<RunType> ty);
 
-bool is_end_node(std::shared_ptr<Event> event);
-
-bool is_marker(std::shared_ptr<Event> event);
+// Every colour a node can be, the last one is the default for configs and markers
+const std::vector<QColor>& node_colours();
 
 #endif // TYPES_H